@@ -0,0 +1,674 @@
+/*
+ *  BaseFrota: serviço da Base que atende vários robôs ao mesmo tempo, um laço de eventos cuida das conexões
+ *  e a decodificação, busca do modelo e inferência de cada quadro rodam no pool de threads global.
+ *  Com --simula mede a vazão em função da quantidade de robôs, usando robôs simulados no próprio processo.
+ */
+
+/* -------- Includes -------- */
+#include "Raspberry.hpp"
+#include "ImageProcessing.hpp"
+#include "MNIST.hpp"
+#include "ControleAutomatico.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+#include "EventLoop.hpp"
+#include "Escalonador.hpp"
+#include "Configuracao.hpp"
+
+#include <csignal>
+#include <condition_variable>
+#include <mutex>
+#include <fcntl.h>
+
+/* -------- Defines -------- */
+#define FROTA_PORTA_BASE        6000
+#define FROTA_SEGUNDOS          10.0
+#define FROTA_AQUECIMENTO       1.0
+#define FROTA_TIMEOUT_SIMULADO  30      // [s] Tolerância do robô simulado à espera do comando
+
+/* -------- Tipos -------- */
+// Dados somente leitura compartilhados por todos os robôs
+typedef struct
+{
+    float escalas[NUM_ESCALAS];
+    Mat_<Raspberry::Flt> modelos[NUM_ESCALAS];
+    std::unique_ptr<ImageProcessing::TemplateMatching::BuscaAdaptativa> busca;
+    torch::jit::script::Module module;
+} Recursos;
+
+// Etapas da recepção não bloqueante de uma mensagem do Protocolo: o cabeçalho e depois o corpo
+typedef enum
+{
+    CABECALHO = 0,
+    CORPO,
+} Recepcao;
+
+/*
+ * Conexão e estado de controle de um robô. Enquanto o quadro é processado no pool o laço de eventos
+ * não toca no robô, o protocolo é sincronizado (um comando por quadro) então não há outro quadro chegando.
+ */
+typedef struct
+{
+    int id;
+    std::unique_ptr<Client> client;
+    int fd;
+    bool conectado;
+
+    // Recepção
+    Recepcao recepcao;
+    size_t recebidos;
+    Raspberry::Byte cabecalho[PROTOCOLO_CABECALHO];
+    Protocolo::Cabecalho recebido;
+    std::vector<Raspberry::Byte> corpo;     // Corpo da mensagem, no QUADRO a identificação seguida do jpeg
+    Protocolo::Quadro quadro;
+    std::vector<Raspberry::Deteccao> deteccoes; // Feitas na Pi, com --deteccao ela envia DETECCOES no lugar do QUADRO
+    double chegada;
+
+    // Transmissão
+    Raspberry::Byte saida[PROTOCOLO_CABECALHO + PROTOCOLO_COMANDO];
+    size_t enviados;
+
+    // Controle automático próprio
+    std::unique_ptr<ControleAutomatico::Controlador> controlador;
+    Raspberry::Comando comando;
+    int numPredito;
+    Raspberry::FindPos alvo;
+    bool comAlvo;
+    Raspberry::FindPos corrBuf[NUM_ESCALAS];
+
+    // Estatísticas
+    uint64_t quadros;
+    uint64_t escalasAvaliadas;
+    double latenciaSoma;
+} Robo;
+
+/* -------- Variáveis Globais -------- */
+static std::atomic<bool> executando{true};
+
+/* -------- Callbacks -------- */
+void sinal_callback(int sinal)
+{
+    (void)sinal;
+    executando = false;
+}
+
+/* -------- Frota -------- */
+class Frota
+{
+    private:
+        Recursos& recursos;
+        EventLoop loop;
+        std::vector<std::unique_ptr<Robo>> robos;
+        size_t conectados = 0;
+
+        // Quadros submetidos ao pool global e ainda não respondidos
+        int emProcessamento = 0;
+        std::mutex mutexProcessamento;
+        std::condition_variable fimProcessamento;
+
+        void aoEvento(Robo& robo, uint32_t eventos);
+        bool recebe(Robo& robo);
+        void envia(Robo& robo);
+        void processa(Robo& robo);
+        void desconecta(Robo& robo, const std::string& motivo);
+    public:
+        Frota(Recursos& recursos) : recursos(recursos) {}
+        ~Frota();
+
+        void conecta(const std::string& host, const std::string& porta);
+        void executa(const std::atomic<bool>& run, double segundos = 0.0);
+
+        void zeraEstatisticas();
+        void imprimeEstatisticas(double segundos) const;
+        uint64_t getQuadros() const;
+        size_t getConectados() const { return conectados; }
+};
+
+/*
+ * Aguarda as tarefas que ainda usam os robôs terminarem no pool
+ */
+Frota::~Frota()
+{
+    std::unique_lock<std::mutex> lock(mutexProcessamento);
+    fimProcessamento.wait(lock, [this] { return emProcessamento == 0; });
+}
+
+/*
+ * Conecta a mais um robô, o socket passa a ser não bloqueante e atendido pelo laço de eventos
+ */
+void Frota::conecta(const std::string& host, const std::string& porta)
+{
+    auto robo = std::make_unique<Robo>();
+    robo->id = robos.size();
+    robo->client = std::make_unique<Client>(host.c_str(), porta.c_str());
+    robo->client->waitConnection();
+
+    // Os modelos são compartilhados por todos os robôs, então todos usam a resolução de referência
+    Protocolo::Sessao sessao{Protocolo::getToken(), Raspberry::Formato{CAMERA_FRAME_WIDTH, CAMERA_FRAME_HEIGHT, 0}, 0, 0};
+    robo->client->sendSessao(sessao);
+    robo->client->receiveSessao(sessao);
+
+    const Raspberry::Formato& formato = sessao.formato;
+
+    if (formato.largura != CAMERA_FRAME_WIDTH || formato.altura != CAMERA_FRAME_HEIGHT) {
+        throw std::runtime_error("Frota: Robô " + host + ":" + porta + " com a resolução " + std::to_string(formato.largura) + "x" +
+                                 std::to_string(formato.altura) + ", a frota usa somente " + std::to_string(CAMERA_FRAME_WIDTH) + "x" +
+                                 std::to_string(CAMERA_FRAME_HEIGHT));
+    }
+
+    robo->fd = robo->client->getSocket();
+    robo->conectado = true;
+
+    robo->recepcao = Recepcao::CABECALHO;
+    robo->recebidos = 0;
+    robo->enviados = sizeof(robo->saida);
+
+    robo->controlador = std::make_unique<ControleAutomatico::Controlador>(ESCALA_DIST_MIN, Raspberry::timeSinceEpoch, false);
+    robo->comando = Raspberry::Comando::NAO_SELECIONADO;
+    robo->numPredito = 0;
+    robo->comAlvo = false;
+    robo->quadros = 0;
+    robo->escalasAvaliadas = 0;
+    robo->latenciaSoma = 0.0;
+
+    if (fcntl(robo->fd, F_SETFL, fcntl(robo->fd, F_GETFL) | O_NONBLOCK) < 0) {
+        throw std::runtime_error("Frota: Erro ao tornar o socket não bloqueante! Código de erro: " + std::to_string(errno));
+    }
+
+    Robo* ptr = robo.get();
+    loop.adiciona(robo->fd, EPOLLIN, [this, ptr](uint32_t eventos) { aoEvento(*ptr, eventos); });
+
+    robos.push_back(std::move(robo));
+    conectados++;
+}
+
+/*
+ * Encerra a conexão com o robô, os demais continuam sendo atendidos
+ */
+void Frota::desconecta(Robo& robo, const std::string& motivo)
+{
+    if (!robo.conectado) {
+        return;
+    }
+
+    Raspberry::print("Frota: Robo " + std::to_string(robo.id) + " desconectado: " + motivo);
+    loop.remove(robo.fd);
+    robo.client.reset();
+    robo.conectado = false;
+    conectados--;
+}
+
+/*
+ * Lê o que estiver disponível no socket, retorna verdadeiro quando um quadro ou as detecções de um quadro estão
+ * completos. As mensagens de outros tipos, como a telemetria da Pi, são descartadas
+ */
+bool Frota::recebe(Robo& robo)
+{
+    while (true) {
+        Raspberry::Byte* destino;
+        size_t total;
+
+        if (robo.recepcao == Recepcao::CABECALHO) {
+            destino = robo.cabecalho;
+            total = sizeof(robo.cabecalho);
+        }
+        else {
+            destino = robo.corpo.data();
+            total = robo.corpo.size();
+        }
+
+        ssize_t numRecv = read(robo.fd, destino + robo.recebidos, std::min(CHUNK_SIZE, total - robo.recebidos));
+
+        if (numRecv == 0) {
+            throw std::runtime_error("conexão fechada pelo robô");
+        }
+        else if (numRecv < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            }
+            else if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("erro ao receber os dados, código de erro: " + std::to_string(errno));
+        }
+
+        robo.recebidos += numRecv;
+        if (robo.recebidos < total) {
+            continue;
+        }
+
+        robo.recebidos = 0;
+
+        if (robo.recepcao == Recepcao::CABECALHO) {
+            robo.recebido = Protocolo::leCabecalho(robo.cabecalho);
+            Protocolo::verifica(robo.recebido);
+
+            robo.corpo.resize(robo.recebido.tamanho);
+            robo.recepcao = Recepcao::CORPO;
+
+            if (robo.recebido.tamanho > 0) {
+                continue;
+            }
+        }
+
+        robo.recepcao = Recepcao::CABECALHO;
+
+        if (robo.recebido.tipo == Protocolo::QUADRO || robo.recebido.tipo == Protocolo::DETECCOES) {
+            robo.quadro = Protocolo::leQuadro(robo.corpo.data(), robo.corpo.size());
+            if (robo.recebido.tipo == Protocolo::QUADRO && robo.corpo.size() == PROTOCOLO_QUADRO) {
+                throw std::runtime_error("quadro vazio");
+            }
+            return true;
+        }
+    }
+}
+
+/*
+ * Continua a transmissão do comando, ao terminar volta a aguardar o próximo quadro
+ */
+void Frota::envia(Robo& robo)
+{
+    while (robo.enviados < sizeof(robo.saida)) {
+        ssize_t numSend = write(robo.fd, robo.saida + robo.enviados, sizeof(robo.saida) - robo.enviados);
+
+        if (numSend < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                loop.modifica(robo.fd, EPOLLOUT);
+                return;
+            }
+            else if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("erro ao transmitir os dados, código de erro: " + std::to_string(errno));
+        }
+
+        robo.enviados += numSend;
+    }
+
+    robo.quadros++;
+    robo.latenciaSoma += Raspberry::timeSinceEpoch() - robo.chegada;
+    loop.modifica(robo.fd, EPOLLIN);
+}
+
+/*
+ * Eventos do socket do robô, roda na thread do laço
+ */
+void Frota::aoEvento(Robo& robo, uint32_t eventos)
+{
+    try {
+        if (eventos & (EPOLLERR | EPOLLHUP)) {
+            throw std::runtime_error("conexão fechada pelo robô");
+        }
+
+        if (eventos & EPOLLOUT) {
+            envia(robo);
+        }
+        else if ((eventos & EPOLLIN) && recebe(robo)) {
+            robo.chegada = Raspberry::timeSinceEpoch();
+
+            // Suspende o socket enquanto o quadro é processado
+            loop.modifica(robo.fd, 0);
+
+            Robo* ptr = &robo;
+            {
+                std::lock_guard<std::mutex> lock(mutexProcessamento);
+                emProcessamento++;
+            }
+            ThreadPool::global().submete([this, ptr] {
+                std::string erro;
+                try {
+                    processa(*ptr);
+                }
+                catch (const std::exception& e) {
+                    erro = e.what();
+                }
+
+                // A resposta volta para a thread do laço
+                loop.posta([this, ptr, erro] {
+                    if (!erro.empty()) {
+                        desconecta(*ptr, erro);
+                        return;
+                    }
+
+                    try {
+                        Protocolo::Comando mensagem;
+                        mensagem.quadro = ptr->quadro;
+                        mensagem.comando = ptr->comando;
+                        memset(mensagem.pwms, 0, sizeof(mensagem.pwms));
+                        Protocolo::setAlvo(mensagem, ptr->comAlvo ? &ptr->alvo : nullptr, ptr->comAlvo, ptr->numPredito);
+                        mensagem.processamento = Protocolo::getDecimosMs(uint32_t((Raspberry::timeSinceEpoch() - ptr->chegada)*1e6));
+
+                        Protocolo::escreveComando(ptr->saida, mensagem);
+                        ptr->enviados = 0;
+                        envia(*ptr);
+                    }
+                    catch (const std::exception& e) {
+                        desconecta(*ptr, e.what());
+                    }
+                });
+
+                // Avisa com o mutex travado, o destrutor pode retornar assim que ele for liberado
+                std::lock_guard<std::mutex> lock(mutexProcessamento);
+                emProcessamento--;
+                fimProcessamento.notify_all();
+            });
+        }
+    }
+    catch (const std::exception& e) {
+        desconecta(robo, e.what());
+    }
+}
+
+/*
+ * Decodifica o quadro, busca o modelo, identifica o número e atualiza o controle do robô, roda em uma thread do pool.
+ * A busca divide as escalas em faixas no mesmo pool, então as threads livres ajudam nos quadros dos outros robôs.
+ * Com as detecções feitas na Pi somente os recortes são classificados, em um único lote, e o preview é ignorado
+ */
+void Frota::processa(Robo& robo)
+{
+    if (robo.recebido.tipo == Protocolo::DETECCOES) {
+        const Raspberry::Byte* preview;
+        uint32_t numPreview;
+        Device::leDeteccoes(robo.corpo.data(), robo.corpo.size(), robo.quadro, robo.deteccoes, preview, numPreview);
+
+        std::vector<Mat_<Raspberry::Flt>> numEncontrados;
+        for (const auto& deteccao : robo.deteccoes) {
+            Mat_<Raspberry::Flt> numEncontrado;
+            deteccao.recorte.convertTo(numEncontrado, CV_32F, 1.0 / 255.0);
+            numEncontrados.push_back(numEncontrado);
+        }
+        std::vector<int> preditos = MNIST::inferencia(numEncontrados, recursos.module);
+
+        // O controle segue o alvo de maior correlação, a Pi já aplicou o limiar
+        bool enquadrado = false;
+        robo.comAlvo = !robo.deteccoes.empty();
+
+        if (robo.comAlvo) {
+            robo.alvo = robo.deteccoes[0].alvo;
+            robo.numPredito = preditos[0];
+            enquadrado = robo.alvo.escala > ESCALA_DIST_MIN;
+        }
+
+        robo.comando = robo.controlador->atualiza(enquadrado, robo.numPredito);
+        return;
+    }
+
+    // O jpeg é decodificado direto do corpo da mensagem
+    Mat jpeg(1, robo.corpo.size() - PROTOCOLO_QUADRO, CV_8U, robo.corpo.data() + PROTOCOLO_QUADRO);
+    Mat_<Raspberry::Cor> quadro = imdecode(jpeg, 1);
+    if (quadro.empty()) {
+        throw std::runtime_error("quadro inválido");
+    }
+
+    Mat_<Raspberry::Flt> quadroFlt;
+    ImageProcessing::Cor2Flt(quadro, quadroFlt);
+
+    int avaliadas;
+    Raspberry::FindPos maxCorr = recursos.busca->busca(quadroFlt, recursos.modelos, robo.corrBuf, &avaliadas);
+    robo.escalasAvaliadas += avaliadas;
+
+    bool enquadrado = false;
+    robo.alvo = maxCorr;
+    robo.comAlvo = maxCorr.ponto.correlacao > THRESHOLD;
+
+    if (robo.comAlvo) {
+        Mat_<Raspberry::Flt> numEncontrado = MNIST::getMNIST(quadroFlt, maxCorr.ponto.posicao, maxCorr.escala*NUM_SIZE);
+        robo.numPredito = MNIST::inferencia(numEncontrado, recursos.module);
+        enquadrado = maxCorr.escala > ESCALA_DIST_MIN;
+    }
+
+    robo.comando = robo.controlador->atualiza(enquadrado, robo.numPredito);
+}
+
+/*
+ * Atende os robôs até run ser falso, todos desconectarem ou passar a duração dada (zero é indefinido)
+ */
+void Frota::executa(const std::atomic<bool>& run, double segundos)
+{
+    double fim = Raspberry::timeSinceEpoch() + segundos;
+
+    while (run && conectados > 0) {
+        if (segundos > 0.0 && Raspberry::timeSinceEpoch() >= fim) {
+            break;
+        }
+        loop.executaUmaVez(100);
+    }
+}
+
+void Frota::zeraEstatisticas()
+{
+    for (auto& robo : robos) {
+        robo->quadros = 0;
+        robo->escalasAvaliadas = 0;
+        robo->latenciaSoma = 0.0;
+    }
+}
+
+uint64_t Frota::getQuadros() const
+{
+    uint64_t total = 0;
+    for (const auto& robo : robos) {
+        total += robo->quadros;
+    }
+    return total;
+}
+
+/*
+ * Imprime a vazão e a latência (quadro recebido até o comando enviado) de cada robô
+ */
+void Frota::imprimeEstatisticas(double segundos) const
+{
+    for (const auto& robo : robos) {
+        double latencia = robo->quadros > 0 ? robo->latenciaSoma / robo->quadros : 0.0;
+        double escalas = robo->quadros > 0 ? double(robo->escalasAvaliadas) / robo->quadros : 0.0;
+
+        std::ostringstream os;
+        os << "Robo " << robo->id << ": " << robo->quadros / segundos << " quadros/s, latencia media = "
+           << latencia*1e3 << " ms, escalas avaliadas por quadro = " << escalas << (robo->conectado ? "" : " (desconectado)");
+        Raspberry::print(os.str());
+    }
+
+    Raspberry::print("Total: " + std::to_string(getQuadros() / segundos) + " quadros/s");
+}
+
+/* -------- Robôs simulados -------- */
+/*
+ * Robô simulado, segue o protocolo do Rasp/main.cpp enviando sempre o mesmo quadro
+ */
+void roboSimulado(std::string porta, const std::vector<Raspberry::Byte>& jpeg, std::atomic<bool>& run, std::atomic<int>& prontos)
+{
+    try {
+        Server server(porta.c_str(), FROTA_TIMEOUT_SIMULADO);
+        prontos++;
+        server.waitConnection();
+
+        // O quadro simulado tem sempre a resolução de referência
+        Protocolo::Sessao sessao;
+        server.receiveSessao(sessao);
+        server.sendSessao(Protocolo::Sessao{sessao.token, Raspberry::Formato{CAMERA_FRAME_WIDTH, CAMERA_FRAME_HEIGHT, 0}, 0, 0});
+
+        Protocolo::Comando comando;
+        for (uint32_t sequencia = 0; run; sequencia++) {
+            server.sendQuadro(Protocolo::Quadro{sequencia, Protocolo::getCarimbo()}, jpeg.data(), jpeg.size());
+            server.receiveComando(comando);
+        }
+    }
+    catch (const std::exception&) {
+        // A Base fechou a conexão, fim da simulação
+    }
+}
+
+/*
+ * Mede a vazão da frota com a quantidade de robôs simulados passada, retorna os quadros por segundo
+ */
+double medeVazao(Recursos& recursos, int numRobos, int portaBase, const std::vector<Raspberry::Byte>& jpeg, double segundos)
+{
+    std::atomic<bool> runSimulados{true};
+    std::atomic<int> prontos{0};
+    std::vector<std::thread> simulados;
+
+    for (auto i = 0; i < numRobos; i++) {
+        simulados.emplace_back(roboSimulado, std::to_string(portaBase + i), std::cref(jpeg), std::ref(runSimulados), std::ref(prontos));
+    }
+
+    while (prontos < numRobos) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    double vazao = 0.0;
+    {
+        Frota frota(recursos);
+        for (auto i = 0; i < numRobos; i++) {
+            frota.conecta("localhost", std::to_string(portaBase + i));
+        }
+
+        // Descarta o início, com as caches e o modelo ainda frios
+        frota.executa(executando, FROTA_AQUECIMENTO);
+        frota.zeraEstatisticas();
+
+        double inicio = Raspberry::timeSinceEpoch();
+        frota.executa(executando, segundos);
+        double decorrido = Raspberry::timeSinceEpoch() - inicio;
+
+        vazao = frota.getQuadros() / decorrido;
+        runSimulados = false;
+    }
+
+    for (auto& simulado : simulados) {
+        simulado.join();
+    }
+
+    return vazao;
+}
+
+/* -------- Main -------- */
+void uso()
+{
+    Raspberry::erro("Uso: BaseFrota model.pt template.png [--threads N] [--afinidade 0-3] host:porta [host:porta ...]\n"
+                    "     BaseFrota model.pt template.png [--threads N] [--afinidade 0-3] --simula imagem.png [--robos 1,2,4,8] [--segundos S] [--porta-base P]");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        uso();
+    }
+
+    // Opções
+    unsigned numThreads = 0;
+    std::string afinidade;
+    std::string imagemSimulada;
+    std::vector<int> numRobos{1, 2, 4, 8, 16};
+    double segundos = FROTA_SEGUNDOS;
+    int portaBase = FROTA_PORTA_BASE;
+    std::vector<std::string> enderecos;
+
+    for (auto i = 3; i < argc; i++) {
+        std::string opcao = argv[i];
+
+        if (opcao == "--threads" && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (opcao == "--afinidade" && i + 1 < argc) {
+            afinidade = argv[++i];
+        }
+        else if (opcao == "--simula" && i + 1 < argc) {
+            imagemSimulada = argv[++i];
+        }
+        else if (opcao == "--robos" && i + 1 < argc) {
+            numRobos.clear();
+            std::istringstream lista(argv[++i]);
+            std::string n;
+            while (std::getline(lista, n, ',')) {
+                numRobos.push_back(std::stoi(n));
+            }
+        }
+        else if (opcao == "--segundos" && i + 1 < argc) {
+            segundos = atof(argv[++i]);
+        }
+        else if (opcao == "--porta-base" && i + 1 < argc) {
+            portaBase = atoi(argv[++i]);
+        }
+        else if (opcao.find(':') != std::string::npos) {
+            enderecos.push_back(opcao);
+        }
+        else {
+            uso();
+        }
+    }
+
+    std::signal(SIGINT, sinal_callback);
+    // Um robô que cai não pode derrubar o serviço
+    std::signal(SIGPIPE, SIG_IGN);
+
+    Recursos recursos;
+    std::string erro;
+
+    try {
+        // Robôs, busca do modelo, OpenCV e inferência dividem o mesmo pool de threads
+        Escalonador::configura(numThreads, afinidade);
+
+        recursos.module = torch::jit::load(argv[1], torch::Device(torch::kCPU));
+        recursos.module = torch::jit::optimize_for_inference(recursos.module);
+
+        ImageProcessing::TemplateMatching::getEscalasGeometricas(recursos.escalas, NUM_ESCALAS, ESCALA_MIN, ESCALA_MAX);
+
+        Mat_<Raspberry::Flt> modelo;
+        ImageProcessing::Cor2Flt(imread(argv[2], 1), modelo);
+        ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, recursos.modelos, NUM_ESCALAS, recursos.escalas);
+        recursos.busca = std::make_unique<ImageProcessing::TemplateMatching::BuscaAdaptativa>(modelo, NUM_ESCALAS, recursos.escalas, BUSCA_CONFIANCA, BUSCA_MARGEM);
+
+        if (!imagemSimulada.empty()) {
+            // Quadro enviado pelos robôs simulados, no mesmo formato da câmera
+            Mat_<Raspberry::Cor> imagem = imread(imagemSimulada, 1);
+            if (imagem.empty()) {
+                throw std::runtime_error("Frota: Erro ao abrir a imagem " + imagemSimulada);
+            }
+            resize(imagem, imagem, Size(CAMERA_FRAME_WIDTH, CAMERA_FRAME_HEIGHT));
+
+            std::vector<Raspberry::Byte> jpeg;
+            imencode(".jpeg", imagem, jpeg, std::vector<int>{IMWRITE_JPEG_QUALITY, 80});
+
+            Raspberry::print("Threads: " + std::to_string(ThreadPool::global().getNumThreads()));
+            Raspberry::print("Robos\tQuadros/s\tQuadros/s por robo");
+
+            for (int n : numRobos) {
+                if (!executando) {
+                    break;
+                }
+
+                double vazao = medeVazao(recursos, n, portaBase, jpeg, segundos);
+
+                std::ostringstream os;
+                os << n << "\t" << vazao << "\t" << vazao / n;
+                Raspberry::print(os.str());
+            }
+        }
+        else {
+            if (enderecos.empty()) {
+                uso();
+            }
+
+            Frota frota(recursos);
+            for (const auto& endereco : enderecos) {
+                size_t separador = endereco.rfind(':');
+                frota.conecta(endereco.substr(0, separador), endereco.substr(separador + 1));
+            }
+
+            Raspberry::print("Frota: " + std::to_string(frota.getConectados()) + " robos, " + std::to_string(ThreadPool::global().getNumThreads()) + " threads");
+
+            double inicio = Raspberry::timeSinceEpoch();
+            frota.executa(executando);
+            frota.imprimeEstatisticas(Raspberry::timeSinceEpoch() - inicio);
+        }
+    }
+    catch (const std::exception& e) {
+        erro = e.what();
+    }
+
+    if (!erro.empty()) {
+        Raspberry::erro(erro);
+    }
+
+    return 0;
+}
@@ -5,25 +5,85 @@
 
 /* -------- Includes -------- */
 #include "Raspberry.hpp"
+#include "ImageProcessing.hpp"
+#include "MNIST.hpp"
+#include "ControleAutomatico.hpp"
 #include "Client.hpp"
+#include "Canal.hpp"
+#include "DetectorMovimento.hpp"
+#include "JpegParalelo.hpp"
+#include "Mailbox.hpp"
+#include "Escalonador.hpp"
+#include "Configuracao.hpp"
+
+#include <csignal>
+#include <fstream>
+#include <random>
 
 /* -------- Defines -------- */
-#define TEMPLATE_SIZE   401
-#define NUM_SIZE        150
+#define PRAZO_QUADRO        0.5     // [s] Sem quadros por este tempo o controle automático recomeça
+#define PRAZO_CONEXAO       2.0     // [s] Sem quadros por este tempo a conexão é dada como perdida
+#define RECONEXAO_ESPERA_MIN    0.05    // [s] Primeira espera entre as tentativas de reconexão, dobra a cada falha
+#define RECONEXAO_ESPERA_MAX    2.0
+#define RECONEXAO_LIMITE        60.0    // [s] Sem reconectar por este tempo a Base encerra
+#define LACO_TIMEOUT_MS     50      // Espera máxima do laço de eventos, para ver o executando
+#define AQUECIMENTO_QUADROS     20      // Quadros sintéticos processados antes de conectar
+#define AQUECIMENTO_PRIMEIROS   3       // Primeiros quadros relatados um a um, contra o regime
+#define TEMPOS_RESERVATORIO     4096    // Amostras do regime guardadas para os percentis, a memória não cresce com a sessão
+
+/* -------- Tipos -------- */
+// Quadro anotado entregue pela thread de processamento para a thread da interface
+typedef struct
+{
+    Mat_<Raspberry::Cor> imagem;
+    std::vector<Raspberry::FindPos> deteccoes;
+    std::vector<int> preditos;
+    bool automatico;
+} Quadro;
 
-#define NUM_ESCALAS     32
-#define ESCALA_MAX      0.4f 
-#define ESCALA_MIN      0.03f
-#define ESCALA          ((ESCALA_MAX - ESCALA_MIN) / NUM_ESCALAS)
-#define THRESHOLD       0.6f
+// Resumo da telemetria enviada pela Pi
+typedef struct
+{
+    uint64_t amostras;
+    double cpuSoma;             // [%]
+    double cpuMax;
+    double temperaturaMax;      // [°C]
+    double latenciaSoma;        // [ms]
+    double latenciaMax;
+    double processamentoSoma;   // [ms]
+    uint32_t filaMotorMax;
+    uint32_t filaCapturaMax;
+    uint32_t filaSocketMax;     // [bytes]
+} ResumoTelemetria;
 
-#define ESCALA_DIST_MIN 0.085f
+// Tempos por quadro [s]: os primeiros na ordem e uma amostra uniforme do regime, de tamanho limitado
+typedef struct
+{
+    std::vector<double> primeiros;  // Até AQUECIMENTO_PRIMEIROS
+    std::vector<double> regime;     // Até TEMPOS_RESERVATORIO
+    uint64_t numRegime = 0;         // Quadros do regime, inclusive os que ficaram fora da amostra
+    std::minstd_rand aleatorio;
+} Tempos;
+
+// Caminho do quadro na Base, o aquecimento passa pelo mesmo
+typedef enum
+{
+    CLASSIFICACAO,  // --deteccao: somente a classificação em lote dos recortes da Pi
+    MULTI,          // --multi: todas as detecções e a classificação em lote
+    BUSCA,          // Busca adaptativa das escalas e a classificação do alvo principal
+    EXAUSTIVA,      // --exaustiva: todas as escalas e a classificação do alvo principal
+} Caminho;
 
 /* -------- Variáveis Globais -------- */
+static std::atomic<bool> executando{true};
+
+// Escritas pela interface (mouse) e lidas pela thread de processamento
+static std::atomic<Raspberry::Comando> comandoManual{Raspberry::Comando::NAO_SELECIONADO};
+static std::atomic<bool> alternaModo{false};
+
+// Usado somente pela thread da interface
 static Mat_<Raspberry::Cor> teclado;
-static Raspberry::Controle controle = Raspberry::Controle::MANUAL;
-static Raspberry::Comando comando = Raspberry::Comando::NAO_SELECIONADO;
-static ControleAutomatico::Estados controleEstado = ControleAutomatico::Estados::BUSCA;
+static Raspberry::Comando comandoTeclado = Raspberry::Comando::NAO_SELECIONADO;
 
 /* -------- Callbacks -------- */
 void mouse_callback(int event, int x, int y, int flags, void *usedata)
@@ -36,114 +96,786 @@ void mouse_callback(int event, int x, int y, int flags, void *usedata)
         uint32_t row = y / BUTTON_HEIGHT;
         
         // Obtem qual comando foi pressionado, e qual deve ser os valores dos PWMs
-        Raspberry::getComando(col, row, teclado, comando);
+        Raspberry::getComando(col, row, teclado, comandoTeclado);
+        comandoManual = comandoTeclado;
 
         // Alterna entre o controle manual ou automático
-        if (comando == Raspberry::Comando::ALTERNA_MODO) {
-            controle = static_cast<Raspberry::Controle>(~controle & 1);
-            Raspberry::limpaTeclado(teclado, comando);
-            controleEstado = ControleAutomatico::Estados::BUSCA;
+        if (comandoTeclado == Raspberry::Comando::ALTERNA_MODO) {
+            Raspberry::limpaTeclado(teclado, comandoTeclado);
+            alternaModo = true;
         }
     }
     else if (event == EVENT_LBUTTONUP) {
-        Raspberry::limpaTeclado(teclado, comando);
-        comando = Raspberry::Comando::NAO_SELECIONADO;
+        Raspberry::limpaTeclado(teclado, comandoTeclado);
+        comandoTeclado = Raspberry::Comando::NAO_SELECIONADO;
+        comandoManual = comandoTeclado;
+    }
+}
+
+void sinal_callback(int sinal)
+{
+    (void)sinal;
+    executando = false;
+}
+
+/* -------- Thread da interface -------- */
+/*
+ * Desenha as anotações do quadro e o teclado ao lado. O quadro é exibido na altura do teclado, qualquer que seja a
+ * resolução negociada, e as anotações são levadas para essa escala
+ */
+void desenhaQuadro(const Quadro& quadro, Mat_<Raspberry::Cor>& tela)
+{
+    const double fatorTela = double(teclado.rows) / quadro.imagem.rows;
+
+    Mat_<Raspberry::Cor> imagem;
+    if (quadro.imagem.rows == teclado.rows) {
+        imagem = quadro.imagem.clone();
+    }
+    else {
+        resize(quadro.imagem, imagem, Size(), fatorTela, fatorTela, INTER_AREA);
+    }
+
+    if (quadro.automatico) {
+        putText(imagem, "Automatico", Point(20, 220), FONT_HERSHEY_DUPLEX, 1.0, Raspberry::Paleta::red, 1.8);  
+    }
+
+    for (size_t i = 0; i < quadro.deteccoes.size(); i++) {
+        // Desenha um retangulo ao redor de cada posição encontrada, com o número predito
+        const Point& original = quadro.deteccoes[i].ponto.posicao;
+        Point posicao(int(original.x*fatorTela + 0.5), int(original.y*fatorTela + 0.5));
+        ImageProcessing::ploteRetangulo(imagem, posicao, quadro.deteccoes[i].escala*TEMPLATE_SIZE*fatorTela);
+
+        if (i == 0) {
+            putText(imagem, std::to_string(quadro.preditos[i]), Point(220, 220), FONT_HERSHEY_DUPLEX, 1.0, Raspberry::Paleta::blue03, 1.2); 
+        }
+        else {
+            putText(imagem, std::to_string(quadro.preditos[i]), posicao, FONT_HERSHEY_DUPLEX, 0.6, Raspberry::Paleta::blue03, 1);
+        }
+    }
+
+    // Coloca o teclado no quadro
+    hconcat(teclado, imagem, tela);
+}
+
+/*
+ * Exibe o quadro anotado mais recente com a taxa de atualização limitada, o mouse também é tratado nesta thread
+ */
+void interfaceGrafica(Mailbox<Quadro>& caixaQuadros, double fpsMax)
+{
+    Raspberry::getTeclado(teclado);
+    namedWindow("RaspCam", WINDOW_AUTOSIZE);
+    setMouseCallback("RaspCam", mouse_callback);
+
+    using namespace std::chrono;
+    const auto periodo = duration_cast<steady_clock::duration>(duration<double>(1.0/fpsMax));
+    auto proximo = steady_clock::now();
+
+    Quadro quadro;
+    Mat_<Raspberry::Cor> tela;
+
+    while (executando) {
+        if (caixaQuadros.consome(quadro)) {
+            desenhaQuadro(quadro, tela);
+        }
+
+        if (!tela.empty()) {
+            imshow("RaspCam", tela);
+        }
+
+        // Aguarda o restante do período tratando os eventos da janela
+        proximo += periodo;
+        auto agora = steady_clock::now();
+        if (proximo < agora) {
+            proximo = agora;
+        }
+        int espera = std::max<int>(1, duration_cast<milliseconds>(proximo - agora).count());
+
+        if (waitKey(espera) == 27) { // Esc
+            executando = false;
+        }
+    }
+
+    destroyAllWindows();
+}
+
+/* -------- Telemetria -------- */
+/*
+ * Acumula o lote de amostras no resumo e, quando houver arquivo, grava cada amostra em uma linha do CSV
+ */
+void acumulaTelemetria(const std::vector<Protocolo::Amostra>& lote, ResumoTelemetria& resumo, std::ofstream& csv)
+{
+    for (const auto& amostra : lote) {
+        double cpu = amostra.cpu / 10.0;
+        double latencia = amostra.latencia / 10.0;
+
+        resumo.amostras++;
+        resumo.cpuSoma += cpu;
+        resumo.cpuMax = std::max(resumo.cpuMax, cpu);
+        resumo.latenciaSoma += latencia;
+        resumo.latenciaMax = std::max(resumo.latenciaMax, latencia);
+        resumo.processamentoSoma += amostra.processamento / 10.0;
+        resumo.filaMotorMax = std::max<uint32_t>(resumo.filaMotorMax, amostra.filaMotor);
+        resumo.filaCapturaMax = std::max<uint32_t>(resumo.filaCapturaMax, amostra.filaCaptura);
+        resumo.filaSocketMax = std::max(resumo.filaSocketMax, amostra.filaSocket);
+
+        if (amostra.temperatura != PROTOCOLO_SEM_TEMPERATURA) {
+            resumo.temperaturaMax = std::max(resumo.temperaturaMax, amostra.temperatura / 10.0);
+        }
+
+        if (csv.is_open()) {
+            csv << amostra.carimbo << "," << cpu << ",";
+            if (amostra.temperatura != PROTOCOLO_SEM_TEMPERATURA) {
+                csv << amostra.temperatura / 10.0;
+            }
+            csv << "," << latencia << "," << amostra.processamento / 10.0 << "," << int(amostra.filaMotor) << ","
+                << int(amostra.filaCaptura) << "," << amostra.filaSocket << "\n";
+        }
+    }
+}
+
+void imprimeTelemetria(const ResumoTelemetria& resumo)
+{
+    if (resumo.amostras == 0) {
+        return;
+    }
+
+    std::ostringstream os;
+    os << "Telemetria da Pi: " << resumo.amostras << " amostras" << std::endl
+       << "  CPU: media = " << resumo.cpuSoma / resumo.amostras << " %, maximo = " << resumo.cpuMax << " %" << std::endl
+       << "  Temperatura maxima: " << resumo.temperaturaMax << " C" << std::endl
+       << "  Latencia do quadro ao comando: media = " << resumo.latenciaSoma / resumo.amostras << " ms, maximo = " << resumo.latenciaMax
+       << " ms, na Base = " << resumo.processamentoSoma / resumo.amostras << " ms" << std::endl
+       << "  Filas maximas: motor = " << resumo.filaMotorMax << ", captura = " << resumo.filaCapturaMax << ", socket = " << resumo.filaSocketMax << " bytes";
+    Raspberry::print(os.str());
+}
+
+/* -------- Tempos -------- */
+/*
+ * Acumula o tempo de um quadro. Depois dos primeiros, cada tempo do regime entra no reservatório com a mesma chance
+ * (amostragem de Vitter), assim os percentis valem para a sessão inteira com memória fixa
+ */
+void acumulaTempo(Tempos& tempos, double tempo)
+{
+    if (tempos.primeiros.size() < AQUECIMENTO_PRIMEIROS) {
+        tempos.primeiros.push_back(tempo);
+        return;
+    }
+
+    tempos.numRegime++;
+    if (tempos.regime.size() < TEMPOS_RESERVATORIO) {
+        tempos.regime.push_back(tempo);
+        return;
+    }
+
+    uint64_t posicao = std::uniform_int_distribution<uint64_t>(0, tempos.numRegime - 1)(tempos.aleatorio);
+    if (posicao < TEMPOS_RESERVATORIO) {
+        tempos.regime[posicao] = tempo;
+    }
+}
+
+/*
+ * Tempos dos primeiros quadros, um a um, contra o regime: a mediana e o p95 dos demais
+ */
+void imprimeTempos(const std::string& titulo, Tempos tempos)
+{
+    if (tempos.primeiros.empty()) {
+        return;
+    }
+
+    std::ostringstream os;
+    os << titulo << " [ms]: primeiros";
+    for (double tempo : tempos.primeiros) {
+        os << " " << 1e3*tempo;
+    }
+
+    if (!tempos.regime.empty()) {
+        std::vector<double>& regime = tempos.regime;
+        std::sort(regime.begin(), regime.end());
+        auto percentil = [&](double p) { return regime[std::min(regime.size() - 1, size_t(p*regime.size()))]; };
+
+        os << ", regime p50 " << 1e3*percentil(0.5) << " p95 " << 1e3*percentil(0.95);
+    }
+
+    os << " (" << tempos.primeiros.size() + tempos.numRegime << " quadros)";
+    Raspberry::print(os.str());
+}
+
+/* -------- Aquecimento -------- */
+/*
+ * Processa quadros sintéticos antes de conectar pelo mesmo caminho que os quadros da Pi vão seguir. O primeiro forward do
+ * TorchScript otimizado compila o grafo para a forma de entrada usada, o pool de threads acorda e o OpenCV aloca os buffers
+ * da busca, assim esse custo não cai nos primeiros quadros da Pi. O modelo adaptativo volta ao original no fim
+ */
+Tempos aquece(const Mat_<Raspberry::Cor>& modeloCor, Mat_<Raspberry::Flt> modelos[], float escalas[], Size tamanho, Caminho caminho,
+              const ImageProcessing::TemplateMatching::BuscaAdaptativa& busca, ImageProcessing::TemplateMatching::ModeloAdaptativo* modeloAdaptativo,
+              torch::jit::script::Module& module)
+{
+    Mat_<Raspberry::Cor> quadro(tamanho);
+    randu(quadro, Scalar::all(0), Scalar::all(255));
+
+    // O modelo no centro na escala do meio, para a busca encontrar o alvo e o número ser recortado
+    Mat_<Raspberry::Cor> alvo;
+    resize(modeloCor, alvo, Size(), escalas[NUM_ESCALAS/2], escalas[NUM_ESCALAS/2], INTER_AREA);
+
+    Rect janela(Point(tamanho.width/2 - alvo.cols/2, tamanho.height/2 - alvo.rows/2), alvo.size());
+    Rect visivel = janela & Rect(Point(0, 0), tamanho);
+    alvo(Rect(visivel.tl() - janela.tl(), visivel.size())).copyTo(quadro(visivel));
+
+    // Recorte como os enviados pela Pi no modo de detecção
+    Mat_<Raspberry::Byte> recorte(MNIST_SIZE, MNIST_SIZE);
+    randu(recorte, Scalar::all(0), Scalar::all(255));
+
+    Mat_<Raspberry::Flt> quadroFlt;
+    Raspberry::FindPos corrBuf[NUM_ESCALAS];
+    Tempos tempos;
+
+    for (auto i = 0; i < AQUECIMENTO_QUADROS; i++) {
+        double inicio = Raspberry::timeSinceEpoch();
+
+        if (caminho == CLASSIFICACAO) {
+            std::vector<Mat_<Raspberry::Flt>> numEncontrados(1);
+            recorte.convertTo(numEncontrados[0], CV_32F, 1.0 / 255.0);
+            MNIST::inferencia(numEncontrados, module);
+        }
+        else if (caminho == MULTI) {
+            ImageProcessing::Cor2Flt(quadro, quadroFlt);
+            std::vector<Raspberry::FindPos> deteccoes = ImageProcessing::TemplateMatching::getDeteccoes(quadroFlt, modelos, NUM_ESCALAS, escalas, THRESHOLD);
+
+            std::vector<Mat_<Raspberry::Flt>> numEncontrados;
+            for (const auto& deteccao : deteccoes) {
+                numEncontrados.push_back(MNIST::getMNIST(quadroFlt, deteccao.ponto.posicao, deteccao.escala*NUM_SIZE));
+            }
+            MNIST::inferencia(numEncontrados, module);
+        }
+        else {
+            ImageProcessing::Cor2Flt(quadro, quadroFlt);
+            Raspberry::FindPos maxCorr = caminho == EXAUSTIVA ?
+                ImageProcessing::TemplateMatching::getMaxCorrelacao(quadroFlt, modelos, corrBuf, NUM_ESCALAS, escalas) :
+                busca.busca(quadroFlt, modelos, corrBuf);
+
+            if (modeloAdaptativo != nullptr) {
+                modeloAdaptativo->atualiza(quadroFlt, maxCorr.ponto.correlacao > THRESHOLD ? &maxCorr : nullptr, modelos);
+            }
+
+            Mat_<Raspberry::Flt> numEncontrado = MNIST::getMNIST(quadroFlt, maxCorr.ponto.posicao, maxCorr.escala*NUM_SIZE);
+            MNIST::inferencia(numEncontrado, module);
+        }
+
+        acumulaTempo(tempos, Raspberry::timeSinceEpoch() - inicio);
     }
+
+    if (modeloAdaptativo != nullptr) {
+        modeloAdaptativo->reinicia(modelos);
+    }
+
+    return tempos;
 }
 
 /* -------- Main -------- */
 int main(int argc, char *argv[])
 {
-    if (argc != 5) {
+    if (argc < 5) {
         Raspberry::erro("Argumentos errados.");
     }
 
+    // Opções
+    bool continuo = false;  // Aproximação contínua pelo controle proporcional
+    bool multi = false;     // Detecta e classifica todos os alvos do quadro
+    bool exaustiva = false; // Avalia sempre todas as escalas, sem a busca adaptativa
+    bool headless = false;  // Sem janela, nenhum quadro é desenhado
+    bool deteccao = false;  // A Pi faz a busca e envia somente as detecções e um preview de tempos em tempos
+    bool adaptativo = false;// Adapta o modelo à aparência do alvo detectado
+    bool movimento = false; // Reutiliza as detecções do quadro anterior enquanto a cena não muda
+    bool aquecimento = true;// Processa quadros sintéticos antes de conectar
+    double fpsTela = 30.0;  // Taxa máxima de atualização da janela
+    unsigned numThreads = 0;    // Threads do escalonador, zero usa uma por núcleo
+    std::string afinidade;      // Cpus das threads do escalonador, ex: "0-3"
+    std::string grava;          // Diretório onde os quadros recebidos são gravados, para o Replay
+    std::string arquivoTelemetria;  // CSV com as amostras de telemetria enviadas pela Pi
+    Raspberry::Formato pedido{0, 0, 0};  // Resolução e taxa pedidas à câmera da Pi, zero deixa o padrão da Pi
+
+    for (auto i = 5; i < argc; i++) {
+        std::string opcao = argv[i];
+
+        if (opcao == "--continuo") {
+            continuo = true;
+        }
+        else if (opcao == "--multi") {
+            multi = true;
+        }
+        else if (opcao == "--exaustiva") {
+            exaustiva = true;
+        }
+        else if (opcao == "--headless") {
+            headless = true;
+        }
+        else if (opcao == "--deteccao") {
+            deteccao = true;
+        }
+        else if (opcao == "--adaptativo") {
+            adaptativo = true;
+        }
+        else if (opcao == "--movimento") {
+            movimento = true;
+        }
+        else if (opcao == "--sem-aquecimento") {
+            aquecimento = false;
+        }
+        else if (opcao == "--fps-tela" && i + 1 < argc) {
+            fpsTela = atof(argv[++i]);
+        }
+        else if (opcao == "--threads" && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (opcao == "--afinidade" && i + 1 < argc) {
+            afinidade = argv[++i];
+        }
+        else if (opcao == "--grava" && i + 1 < argc) {
+            grava = argv[++i];
+        }
+        else if (opcao == "--telemetria" && i + 1 < argc) {
+            arquivoTelemetria = argv[++i];
+        }
+        else if (opcao == "--resolucao" && i + 1 < argc) {
+            if (!Raspberry::leResolucao(argv[++i], pedido)) {
+                Raspberry::erro("Resolução inválida, use LARGURAxALTURA: " + std::string(argv[i]));
+            }
+        }
+        else if (opcao == "--fps" && i + 1 < argc) {
+            pedido.fps = std::max(0, atoi(argv[++i]));
+        }
+        else {
+            Raspberry::erro("Opção desconhecida: " + opcao);
+        }
+    }
+
+    // Busca do modelo, OpenCV e inferência dividem o mesmo pool de threads
+    try {
+        Escalonador::configura(numThreads, afinidade);
+    }
+    catch (const std::exception& e) {
+        Raspberry::erro(e.what());
+    }
+
     // Configurações para exibir os quadros recebidos
     Mat_<Raspberry::Cor> frameBuf;
     Mat_<Raspberry::Flt> frameBufFlt;
 
-    Raspberry::getTeclado(teclado);
-    namedWindow("RaspCam", WINDOW_AUTOSIZE);
-    setMouseCallback("RaspCam", mouse_callback);
+    // Sem interface não há teclado, então o controle já começa automático
+    Raspberry::Controle controle = headless ? Raspberry::Controle::AUTOMATICO : Raspberry::Controle::MANUAL;
+    Raspberry::Comando comando = Raspberry::Comando::NAO_SELECIONADO;
 
-    // Obtem o modelo a ser buscado, para conseguir detectar-lo em diferentes distâncias, é nescessário diferêntes escalas dele
-    float escalas[NUM_ESCALAS];
-    for (auto n = 0; n < NUM_ESCALAS; n++) {
-        escalas[n] = ESCALA*n + ESCALA_MIN;
+    // A interface roda em outra thread e consome somente o quadro anotado mais recente
+    Mailbox<Quadro> caixaQuadros;
+    std::thread threadInterface;
+
+    if (!headless) {
+        threadInterface = std::thread(interfaceGrafica, std::ref(caixaQuadros), fpsTela);
     }
-    
+
+    std::signal(SIGINT, sinal_callback);
+
+    // Uma queda da Pi aparece como erro no envio, e não como SIGPIPE encerrando a Base
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Obtem o modelo a ser buscado, para conseguir detectar-lo em diferentes distâncias, é nescessário diferêntes escalas dele.
+    // As escalas dependem da resolução negociada com a Pi, os modelos pré-processados são gerados depois da conexão
+    float escalas[NUM_ESCALAS];
+    Mat_<Raspberry::Cor> modeloCor = imread(argv[4], 1);
     Mat_<Raspberry::Flt> modelo;
-    ImageProcessing::Cor2Flt(imread(argv[4], 1), modelo);
+    ImageProcessing::Cor2Flt(modeloCor, modelo);
     Mat_<Raspberry::Flt> modelosPreProcessados[NUM_ESCALAS];
-    ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, modelosPreProcessados, NUM_ESCALAS, escalas);
     Raspberry::FindPos corrBuf[NUM_ESCALAS];
 
+    uint64_t quadrosBusca = 0;
+    uint64_t quadrosAlvo = 0;
+    uint64_t escalasAvaliadas = 0;
+    Tempos temposProcessamento;     // Da chegada ao envio do comando
+
+    // Portão de movimento e o resultado do último quadro processado
+    DetectorMovimento detectorMovimento(MOVIMENTO_LIMIAR, MOVIMENTO_REUTILIZADOS_MAX);
+    std::vector<Raspberry::FindPos> deteccoesAnteriores;
+    std::vector<int> preditosAnteriores;
+
     // Variáveis auxliares para o controle automático
     int numPredito;
+    int velocidadesPWM[4] = {0, 0, 0, 0};
+
+    // Telemetria da Pi, recebida em lotes junto dos quadros
+    ResumoTelemetria resumoTelemetria{};
+    std::vector<Protocolo::Amostra> loteTelemetria;
+    std::ofstream csvTelemetria;
+
+    if (!arquivoTelemetria.empty()) {
+        csvTelemetria.open(arquivoTelemetria);
+        if (!csvTelemetria) {
+            Raspberry::erro("Falha ao criar o arquivo de telemetria " + arquivoTelemetria);
+        }
+        csvTelemetria << "carimbo_us,cpu_pct,temperatura_c,latencia_ms,processamento_ms,fila_motor,fila_captura,fila_socket\n";
+    }
 
     // Modelo para reconhecer o número do MNIST
     torch::jit::script::Module module;
+    std::string erro;
 
     try {
         module = torch::jit::load(argv[3], torch::Device(torch::kCPU));
         // Certifica que o modelo está no modo de inferência
         module = torch::jit::optimize_for_inference(module);
         
-        // Conecta à Raspberry
+        // Conecta à Raspberry, o endereço é resolvido uma vez e cada reconexão abre um socket novo
         Client client(argv[1], argv[2]);
-        client.waitConnection();
-        
-        while (true) {            
-            // Recebe os quadros
-            client.receiveImageCompactada(frameBuf);
+
+        // Estado que depende da resolução negociada, refeito somente quando a largura muda
+        uint32_t larguraModelos = 0;
+        float escalaDistMin = ESCALA_DIST_MIN;
+        std::unique_ptr<ImageProcessing::TemplateMatching::BuscaAdaptativa> busca;
+        std::unique_ptr<ImageProcessing::TemplateMatching::ModeloAdaptativo> modeloAdaptativo;
+        std::unique_ptr<ControleAutomatico::Controlador> controlador;
+
+        // O alvo aparece maior em resoluções maiores, as escalas e a distância de parada acompanham a largura do quadro
+        auto configuraModelos = [&](uint32_t largura) {
+            if (largura == larguraModelos) {
+                return;
+            }
+            larguraModelos = largura;
+
+            const float fator = Raspberry::getFatorEscala(largura);
+            escalaDistMin = ESCALA_DIST_MIN*fator;
+            ImageProcessing::TemplateMatching::getEscalasGeometricas(escalas, NUM_ESCALAS, ESCALA_MIN*fator, ESCALA_MAX*fator);
+            ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, modelosPreProcessados, NUM_ESCALAS, escalas);
+
+            modeloAdaptativo.reset();
+            busca = std::make_unique<ImageProcessing::TemplateMatching::BuscaAdaptativa>(modelo, NUM_ESCALAS, escalas, BUSCA_CONFIANCA, BUSCA_MARGEM);
+            modeloAdaptativo = std::make_unique<ImageProcessing::TemplateMatching::ModeloAdaptativo>(modelo, NUM_ESCALAS, escalas, ADAPTA_TAXA, ADAPTA_PERDA_MAX, busca.get());
+            controlador = std::make_unique<ControleAutomatico::Controlador>(escalaDistMin);
+        };
+
+        // Recepção e envio sem bloquear, um link parado não trava o laço, que continua vendo os prazos e o executando.
+        // O canal dura uma conexão, a perda dela encerra a sessão e a Base reconecta
+        EventLoop loop;
+        std::unique_ptr<Canal> canal;
+        bool sessaoAtiva = false;
+        std::string perda;
+        int expirados = 0;
+
+        // Detecções feitas na Pi, o quadro exibido é o último preview recebido
+        std::vector<Raspberry::Deteccao> recebidas;
+
+        // Identificação do quadro em processamento, ecoada no comando, e o instante da sua chegada
+        Protocolo::Quadro quadroRecebido{0, 0};
+        double chegada = 0.0;
+
+        uint32_t numGravados = 0;
+
+        // Decodificação em fatias paralelas quando a Pi envia os reinícios. Sem janela o quadro é reaproveitado, com
+        // ela a interface ainda pode estar lendo o anterior pela caixa de quadros, então cada quadro tem o seu buffer
+        JpegParalelo jpeg;
+
+        auto decodificaQuadro = [&](const Raspberry::Byte* dados, uint32_t numBytes) {
+            if (!headless) {
+                frameBuf.release();
+            }
+
+            jpeg.decodifica(dados, numBytes, frameBuf);
+            if (frameBuf.empty()) {
+                throw std::runtime_error("Base: Erro ao decodificar o quadro!");
+            }
+
+            // O JPEG como foi recebido, a sequência é lida pelo Replay com --quadros <diretório>/quadro_%05d.jpg
+            if (!grava.empty()) {
+                char nome[32];
+                snprintf(nome, sizeof(nome), "/quadro_%05u.jpg", numGravados++);
+
+                std::ofstream arquivo(grava + nome, std::ios::binary);
+                if (!arquivo.write((const char*) dados, numBytes)) {
+                    throw std::runtime_error("Base: Erro ao gravar o quadro em " + grava + nome);
+                }
+            }
+        };
+
+        // Quadro completo: processa e responde com o comando
+        auto processaQuadro = [&]() {
+            expirados = 0;
+
+            // Alterna entre o controle manual ou automático, pedido pela interface
+            if (alternaModo.exchange(false)) {
+                controle = static_cast<Raspberry::Controle>(~controle & 1);
+                controlador->reinicia();
+                detectorMovimento.reinicia();
+            }
+
+            // Detecções em ordem decrescente de correlação e os números preditos em cada uma
+            std::vector<Raspberry::FindPos> deteccoes;
+            std::vector<int> preditos;
 
             // Controle Autômato
             if (controle == Raspberry::Controle::AUTOMATICO) {
-                putText(frameBuf, "Automatico", Point(20, 220), FONT_HERSHEY_DUPLEX, 1.0, Raspberry::Paleta::red, 1.8);  
+                if (deteccao) {
+                    // Somente a classificação dos recortes enviados pela Pi, em um único lote
+                    std::vector<Mat_<Raspberry::Flt>> numEncontrados;
+                    for (const auto& recebida : recebidas) {
+                        Mat_<Raspberry::Flt> numEncontrado;
+                        recebida.recorte.convertTo(numEncontrado, CV_32F, 1.0 / 255.0);
+
+                        deteccoes.push_back(recebida.alvo);
+                        numEncontrados.push_back(numEncontrado);
+                    }
+                    preditos = MNIST::inferencia(numEncontrados, module);
+                }
+                else if (movimento && !detectorMovimento.mudou(frameBuf)) {
+                    // Cena parada: as detecções e os números do último quadro processado continuam valendo
+                    deteccoes = deteccoesAnteriores;
+                    preditos = preditosAnteriores;
+                }
+                else if (multi) {
+                    ImageProcessing::Cor2Flt(frameBuf, frameBufFlt);
+
+                    // Todos os alvos acima do limiar, com os números classificados em um único lote
+                    deteccoes = ImageProcessing::TemplateMatching::getDeteccoes(frameBufFlt, modelosPreProcessados, NUM_ESCALAS, escalas, THRESHOLD);
+
+                    std::vector<Mat_<Raspberry::Flt>> numEncontrados;
+                    for (const auto& deteccao : deteccoes) {
+                        numEncontrados.push_back(MNIST::getMNIST(frameBufFlt, deteccao.ponto.posicao, deteccao.escala*NUM_SIZE));
+                    }
+                    preditos = MNIST::inferencia(numEncontrados, module);
+                }
+                else {
+                    ImageProcessing::Cor2Flt(frameBuf, frameBufFlt);
+
+                    // Obtem o ponto de maior correlação com o modelo
+                    int avaliadas = NUM_ESCALAS;
+                    Raspberry::FindPos maxCorr = exaustiva ? 
+                        ImageProcessing::TemplateMatching::getMaxCorrelacao(frameBufFlt, modelosPreProcessados, corrBuf, NUM_ESCALAS, escalas) :
+                        busca->busca(frameBufFlt, modelosPreProcessados, corrBuf, &avaliadas);
+
+                    quadrosBusca++;
+                    escalasAvaliadas += avaliadas;
 
-                ImageProcessing::Cor2Flt(frameBuf, frameBufFlt);
+                    // O modelo acompanha a aparência do alvo, somente a escala detectada é refeita
+                    if (adaptativo) {
+                        modeloAdaptativo->atualiza(frameBufFlt, maxCorr.ponto.correlacao > THRESHOLD ? &maxCorr : nullptr, modelosPreProcessados);
+                    }
 
-                // Obtem o ponto de maior correlação com o modelo
-                Raspberry::FindPos maxCorr = ImageProcessing::TemplateMatching::getMaxCorrelacao(frameBufFlt, modelosPreProcessados, corrBuf, NUM_ESCALAS, escalas);
+                    if (maxCorr.ponto.correlacao > THRESHOLD) {
+                        quadrosAlvo++;
 
-                // Caso tenha encontrado um template
+                        // Captura o número de dentro do modelo encontrado
+                        Mat_<Raspberry::Flt> numEncontrado = MNIST::getMNIST(frameBufFlt, maxCorr.ponto.posicao, maxCorr.escala*NUM_SIZE);
+                        // Realiza a predição do numero encontrado
+                        deteccoes.push_back(maxCorr);
+                        preditos.push_back(MNIST::inferencia(numEncontrado, module));
+                    }
+                }
+
+                deteccoesAnteriores = deteccoes;
+                preditosAnteriores = preditos;
+
+                // O controle segue o alvo de maior correlação
                 bool enquadrado = false;
+                const Raspberry::FindPos* alvo = deteccoes.empty() ? nullptr : &deteccoes[0];
 
-                if (maxCorr.ponto.correlacao > THRESHOLD) {
-                    if (maxCorr.escala > ESCALA_DIST_MIN) {
-                        enquadrado = true;
-                    } 
-
-                    // Desenha um retangulo ao redor da posição de maior correlação encontrada
-                    ImageProcessing::ploteRetangulo(frameBuf, maxCorr.ponto.posicao, maxCorr.escala*TEMPLATE_SIZE);
-                    // Captura o número de dentro do modelo encontrado
-                    Mat_<Raspberry::Flt> numEncontrado = MNIST::getMNIST(frameBufFlt, maxCorr.ponto.posicao, maxCorr.escala*NUM_SIZE);
-                    // Realiza a predição do numero encontrado
-                    numPredito = MNIST::inferencia(numEncontrado, module);
-                    // Adiciona o número predito ao quadro
-                    putText(frameBuf, std::to_string(numPredito), Point(220, 220), FONT_HERSHEY_DUPLEX, 1.0, Raspberry::Paleta::blue03, 1.2); 
+                if (alvo != nullptr) {
+                    enquadrado = alvo->escala > escalaDistMin;
+                    numPredito = preditos[0];
                 } 
                 
                 // Processa a máquina de estados
-                ControleAutomatico::maquinaEstados(controleEstado, comando, enquadrado, numPredito);   
+                if (continuo) {
+                    comando = controlador->atualizaContinuo(alvo, frameBuf.cols, enquadrado, numPredito, velocidadesPWM);
+                }
+                else {
+                    comando = controlador->atualiza(enquadrado, numPredito);
+                }
             } 
+            else {
+                comando = comandoManual;
+            }
             
-            // Envias o comando de controle dos motores            
-            client.sendBytes(sizeof(comando), (Raspberry::Byte*) &comando);
+            // Envias o comando de controle dos motores, com os PWMs das rodas no controle contínuo e o resumo das detecções
+            Protocolo::Comando mensagem;
+            mensagem.quadro = quadroRecebido;
+            mensagem.comando = comando;
+            for (auto i = 0; i < PROTOCOLO_PWMS; i++) {
+                mensagem.pwms[i] = comando == Raspberry::Comando::AUTO_VELOCIDADE ? velocidadesPWM[i] : 0;
+            }
+            Protocolo::setAlvo(mensagem, deteccoes.empty() ? nullptr : &deteccoes[0], deteccoes.size(), preditos.empty() ? -1 : preditos[0]);
+            const double processamento = Raspberry::timeSinceEpoch() - chegada;
+            mensagem.processamento = Protocolo::getDecimosMs(uint32_t(processamento*1e6));
+            acumulaTempo(temposProcessamento, processamento);
+
+            Raspberry::Byte saida[PROTOCOLO_CABECALHO + PROTOCOLO_COMANDO];
+            Protocolo::escreveComando(saida, mensagem);
+            canal->envia(saida, sizeof(saida));
             
-            // Coloca o teclado no quadro
-            hconcat(teclado, frameBuf, frameBuf);  
+            // Entrega o quadro para a interface, que desenha as anotações no seu próprio ritmo
+            if (!headless) {
+                caixaQuadros.publica(Quadro{frameBuf, deteccoes, preditos, controle == Raspberry::Controle::AUTOMATICO});
+            }
+        };
+
+        // Uma mensagem por vez: os quadros e as detecções são processados e respondidos, a telemetria só registrada.
+        // Tipos de versões futuras são pulados
+        std::function<void()> recebeMensagem = [&]() {
+            canal->recebeMensagem([&](const Protocolo::Cabecalho& cabecalho, const Raspberry::Byte* corpo, uint32_t tamanho) {
+                chegada = Raspberry::timeSinceEpoch();
+
+                switch (cabecalho.tipo) {
+                    case Protocolo::QUADRO:
+                        quadroRecebido = Protocolo::leQuadro(corpo, tamanho);
+                        decodificaQuadro(corpo + PROTOCOLO_QUADRO, tamanho - PROTOCOLO_QUADRO);
+                        processaQuadro();
+                        break;
+                    case Protocolo::DETECCOES: {
+                        const Raspberry::Byte* preview;
+                        uint32_t numPreview;
+                        if (Device::leDeteccoes(corpo, tamanho, quadroRecebido, recebidas, preview, numPreview)) {
+                            decodificaQuadro(preview, numPreview);
+                        }
+                        // O tipo da mensagem já diz que a Pi está no modo de detecção, mesmo sem o --deteccao
+                        deteccao = true;
+                        processaQuadro();
+                        break;
+                    }
+                    case Protocolo::TELEMETRIA:
+                        loteTelemetria.clear();
+                        Protocolo::leTelemetria(corpo, tamanho, loteTelemetria);
+                        acumulaTelemetria(loteTelemetria, resumoTelemetria, csvTelemetria);
+                        break;
+                    default:
+                        break;
+                }
+
+                recebeMensagem();
+            });
+        };
+
+        // A sessão é identificada pelo token, que a Base reapresenta em cada reconexão. Reconhecendo ele a Pi continua a
+        // sequência dos quadros e mantém a câmera e o estado, e a Base mantém o do controle
+        Protocolo::Sessao sessao{Protocolo::getToken(), pedido, 0, 0};
+        double queda = 0.0;     // Instante da última queda, zero antes da primeira conexão
+
+        // Aquecimento na resolução pedida, ou na padrão da Pi. Se a Pi entregar outra largura só as escalas são refeitas,
+        // a rede, as threads e os buffers já estão aquecidos
+        if (aquecimento) {
+            Size previsto(pedido.largura > 0 ? pedido.largura : CAMERA_FRAME_WIDTH, pedido.altura > 0 ? pedido.altura : CAMERA_FRAME_HEIGHT);
+            configuraModelos(previsto.width);
+            Caminho caminho = deteccao ? CLASSIFICACAO : multi ? MULTI : exaustiva ? EXAUSTIVA : BUSCA;
+            imprimeTempos("Base: Aquecimento", aquece(modeloCor, modelosPreProcessados, escalas, previsto, caminho, *busca,
+                                                      adaptativo && (caminho == BUSCA || caminho == EXAUSTIVA) ? modeloAdaptativo.get() : nullptr, module));
+        }
+
+        auto conecta = [&]() {
+            client.waitConnection();
+            client.sendSessao(sessao);
+
+            Protocolo::Sessao obtida;
+            client.receiveSessao(obtida);
+            return obtida;
+        };
 
-            // Exibi o quadro
-            imshow("RaspCam", frameBuf);
-            if (waitKey(1)  == 27) { // Esc
+        while (executando) {
+            // A primeira conexão falha como antes, as reconexões são tentadas com espera crescente até RECONEXAO_LIMITE
+            Protocolo::Sessao obtida;
+            double espera = RECONEXAO_ESPERA_MIN;
+
+            while (executando) {
+                try {
+                    obtida = conecta();
+                    break;
+                }
+                catch (const std::exception& e) {
+                    if (queda == 0.0) {
+                        throw;
+                    }
+
+                    if (Raspberry::timeSinceEpoch() - queda >= RECONEXAO_LIMITE) {
+                        throw std::runtime_error("Base: A Pi não respondeu por " + std::to_string(int(RECONEXAO_LIMITE)) + " s! " + e.what());
+                    }
+
+                    std::this_thread::sleep_for(std::chrono::duration<double>(espera));
+                    espera = std::min(2*espera, RECONEXAO_ESPERA_MAX);
+                }
+            }
+
+            if (!executando) {
                 break;
             }
+
+            Raspberry::print("Base: Quadros de " + std::to_string(obtida.formato.largura) + "x" + std::to_string(obtida.formato.altura) + " a " + std::to_string(obtida.formato.fps) + " fps");
+            configuraModelos(obtida.formato.largura);
+
+            if (queda != 0.0) {
+                std::ostringstream os;
+                os << "Base: Reconectada em " << (Raspberry::timeSinceEpoch() - queda)*1e3 << " ms, "
+                   << (obtida.retomada ? "sessao retomada no quadro " + std::to_string(obtida.sequencia) : std::string("sessao nova"));
+                Raspberry::print(os.str());
+            }
+
+            // Sem a retomada a Pi recomeçou do zero, o controle também recomeça
+            if (!obtida.retomada) {
+                controlador->reinicia();
+                detectorMovimento.reinicia();
+            }
+
+            sessaoAtiva = true;
+            expirados = 0;
+            canal = std::make_unique<Canal>(loop, client, [&](const std::string& motivo) {
+                perda = motivo;
+                sessaoAtiva = false;
+            });
+
+            canal->setPrazo(PRAZO_QUADRO, [&] {
+                if (expirados++ == 0) {
+                    Raspberry::print("Base: Sem quadros da Pi, aguardando.");
+                    controlador->reinicia();
+                    detectorMovimento.reinicia();
+                }
+
+                if (expirados*PRAZO_QUADRO >= PRAZO_CONEXAO) {
+                    perda = "a Pi parou de responder";
+                    sessaoAtiva = false;
+                }
+            });
+
+            recebeMensagem();
+            while (executando && sessaoAtiva) {
+                loop.executaUmaVez(LACO_TIMEOUT_MS);
+            }
+            canal.reset();
+
+            if (executando) {
+                queda = Raspberry::timeSinceEpoch();
+                Raspberry::print("Base: Conexao perdida (" + perda + "), reconectando.");
+            }
         }
     }
     catch (const std::exception& e) {
-        Raspberry::erro(e.what());
+        erro = e.what();
+    }
+
+    executando = false;
+    if (threadInterface.joinable()) {
+        threadInterface.join();
+    }
+
+    if (movimento) {
+        Raspberry::print(detectorMovimento.getEstatisticas());
+    }
+
+    imprimeTelemetria(resumoTelemetria);
+    imprimeTempos("Processamento na Base", temposProcessamento);
+
+    if (quadrosBusca > 0) {
+        std::ostringstream os;
+        os << "Escalas avaliadas por quadro: " << double(escalasAvaliadas) / quadrosBusca << " de " << NUM_ESCALAS << std::endl
+           << "Quadros com o alvo: " << 100.0*quadrosAlvo / quadrosBusca << " %";
+        Raspberry::print(os.str());
+    }
+
+    if (!erro.empty()) {
+        Raspberry::erro(erro);
     }
     
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,145 @@
+/*
+ *  BasePontoFixo: compara a busca multi-escala em ponto fixo (lib/PontoFixo, a usada na Pi) com a busca em float
+ *  da Base, nas mesmas escalas e imagens. Mostra a diferença das correlações, se a posição, a escala e a decisão
+ *  do THRESHOLD coincidem e o tempo de cada uma.
+ */
+
+/* -------- Includes -------- */
+#include "Raspberry.hpp"
+#include "ImageProcessing.hpp"
+#include "PontoFixo.hpp"
+#include "Escalonador.hpp"
+#include "Configuracao.hpp"
+
+/* -------- Defines -------- */
+#define DIST_POSICAO_MAX    2       // [pixels] Diferença de posição aceita como a mesma detecção
+
+/* -------- Main -------- */
+void uso()
+{
+    Raspberry::erro("Uso: BasePontoFixo <modelo> <imagem> [imagem...] [--threads N]");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        uso();
+    }
+
+    // Opções
+    unsigned numThreads = 0;
+    std::vector<std::string> imagens;
+
+    for (auto i = 2; i < argc; i++) {
+        std::string opcao = argv[i];
+
+        if (opcao == "--threads" && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (opcao.rfind("--", 0) == 0) {
+            uso();
+        }
+        else {
+            imagens.push_back(opcao);
+        }
+    }
+
+    try {
+        Escalonador::configura(numThreads);
+    }
+    catch (const std::exception& e) {
+        Raspberry::erro(e.what());
+    }
+
+    float escalas[NUM_ESCALAS];
+    ImageProcessing::TemplateMatching::getEscalasGeometricas(escalas, NUM_ESCALAS, ESCALA_MIN, ESCALA_MAX);
+
+    Mat_<Raspberry::Cor> modeloCor = imread(argv[1], 1);
+    if (modeloCor.empty()) {
+        Raspberry::erro("Erro ao abrir o modelo " + std::string(argv[1]));
+    }
+
+    // Modelos das duas buscas a partir da mesma imagem
+    Mat_<Raspberry::Flt> modelo;
+    ImageProcessing::Cor2Flt(modeloCor, modelo);
+    Mat_<Raspberry::Flt> modelosFlt[NUM_ESCALAS];
+    ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, modelosFlt, NUM_ESCALAS, escalas);
+
+    Mat_<PontoFixo::Pixel> modeloCinza;
+    PontoFixo::getCinza(modeloCor, modeloCinza);
+    PontoFixo::Modelo modelosFixo[NUM_ESCALAS];
+    PontoFixo::getModelos(modeloCinza, modelosFixo, NUM_ESCALAS, escalas);
+
+    Raspberry::FindPos corrFlt[NUM_ESCALAS];
+    Raspberry::FindPos corrFixo[NUM_ESCALAS];
+
+    // Estatísticas
+    double difMax = 0.0, difSoma = 0.0;
+    uint64_t numEscalas = 0, posicoesIguais = 0;
+    uint64_t numImagens = 0, escalasIguais = 0, decisoesIguais = 0;
+    double tempoFlt = 0.0, tempoFixo = 0.0;
+
+    Raspberry::print("Kernel: " + std::string(PontoFixo::getKernel()));
+    Raspberry::print("Imagem\tCorrFloat\tCorrFixo\tEscalaFloat\tEscalaFixo");
+
+    for (const auto& nome : imagens) {
+        Mat_<Raspberry::Cor> quadro = imread(nome, 1);
+        if (quadro.empty()) {
+            Raspberry::print("Erro ao abrir " + nome + ", ignorada");
+            continue;
+        }
+
+        // O tempo de cada busca inclui a conversão do quadro, como no laço dos programas
+        double inicio = Raspberry::timeSinceEpoch();
+        Mat_<Raspberry::Flt> quadroFlt;
+        ImageProcessing::Cor2Flt(quadro, quadroFlt);
+        Raspberry::FindPos maxFlt = ImageProcessing::TemplateMatching::getMaxCorrelacao(quadroFlt, modelosFlt, corrFlt, NUM_ESCALAS, escalas);
+        tempoFlt += Raspberry::timeSinceEpoch() - inicio;
+
+        inicio = Raspberry::timeSinceEpoch();
+        Mat_<PontoFixo::Pixel> quadroCinza;
+        PontoFixo::getCinza(quadro, quadroCinza);
+        Raspberry::FindPos maxFixo = PontoFixo::getMaxCorrelacao(quadroCinza, modelosFixo, corrFixo, NUM_ESCALAS, escalas);
+        tempoFixo += Raspberry::timeSinceEpoch() - inicio;
+
+        for (auto n = 0; n < NUM_ESCALAS; n++) {
+            // Escala maior que o quadro, nenhuma das buscas a avalia
+            if (corrFlt[n].ponto.correlacao < -0.5 || corrFixo[n].ponto.correlacao < -0.5) {
+                continue;
+            }
+
+            double dif = std::abs(corrFlt[n].ponto.correlacao - corrFixo[n].ponto.correlacao);
+            difMax = std::max(difMax, dif);
+            difSoma += dif;
+            numEscalas++;
+
+            Point d = corrFlt[n].ponto.posicao - corrFixo[n].ponto.posicao;
+            if (std::abs(d.x) <= DIST_POSICAO_MAX && std::abs(d.y) <= DIST_POSICAO_MAX) {
+                posicoesIguais++;
+            }
+        }
+
+        numImagens++;
+        escalasIguais += maxFlt.escala == maxFixo.escala;
+        decisoesIguais += (maxFlt.ponto.correlacao >= THRESHOLD) == (maxFixo.ponto.correlacao >= THRESHOLD);
+
+        std::ostringstream linha;
+        linha << nome << "\t" << maxFlt.ponto.correlacao << "\t" << maxFixo.ponto.correlacao
+              << "\t" << maxFlt.escala << "\t" << maxFixo.escala;
+        Raspberry::print(linha.str());
+    }
+
+    if (numImagens == 0 || numEscalas == 0) {
+        Raspberry::erro("Nenhuma imagem comparada!");
+    }
+
+    std::ostringstream os;
+    os << "Diferenca da correlacao por escala: maxima " << difMax << ", media " << difSoma / numEscalas << std::endl
+       << "Posicao por escala igual (<= " << DIST_POSICAO_MAX << " px): " << 100.0*posicoesIguais / numEscalas << " %" << std::endl
+       << "Escala da melhor correlacao igual: " << 100.0*escalasIguais / numImagens << " %" << std::endl
+       << "Decisao do threshold (" << THRESHOLD << ") igual: " << 100.0*decisoesIguais / numImagens << " %" << std::endl
+       << "Tempo medio por quadro: float " << 1000.0*tempoFlt / numImagens << " ms, ponto fixo " << 1000.0*tempoFixo / numImagens << " ms";
+    Raspberry::print(os.str());
+
+    return 0;
+}
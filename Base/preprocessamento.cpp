@@ -0,0 +1,90 @@
+/*
+ *  BasePreProcessamento: compara o pré-processamento do modelo, modulo2(dcReject(modelo, dontcare)), com a versão
+ *  vetorizada no próprio buffer (ImageProcessing::preProcessa) em todas as escalas. Mostra o tempo de cada uma
+ *  e a maior diferença entre os resultados.
+ */
+
+/* -------- Includes -------- */
+#include "Raspberry.hpp"
+#include "ImageProcessing.hpp"
+#include "Configuracao.hpp"
+
+/* -------- Defines -------- */
+#define REPETICOES      200
+
+/* -------- Main -------- */
+void uso()
+{
+    Raspberry::erro("Uso: BasePreProcessamento <modelo> [--repeticoes N]");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        uso();
+    }
+
+    int repeticoes = REPETICOES;
+    for (auto i = 2; i < argc; i++) {
+        std::string opcao = argv[i];
+
+        if (opcao == "--repeticoes" && i + 1 < argc) {
+            repeticoes = std::max(1, atoi(argv[++i]));
+        }
+        else {
+            uso();
+        }
+    }
+
+    Mat_<Raspberry::Cor> modeloCor = imread(argv[1], 1);
+    if (modeloCor.empty()) {
+        Raspberry::erro("Erro ao abrir o modelo " + std::string(argv[1]));
+    }
+
+    Mat_<Raspberry::Flt> modelo;
+    ImageProcessing::Cor2Flt(modeloCor, modelo);
+
+    float escalas[NUM_ESCALAS];
+    Raspberry::getEscalasGeometricas(escalas, NUM_ESCALAS, ESCALA_MIN, ESCALA_MAX);
+
+    Raspberry::print("Escala\tPixels\tAtual [us]\tVetorizado [us]\tDiferenca maxima");
+
+    double totalAtual = 0.0, totalVetorizado = 0.0;
+
+    for (auto n = 0; n < NUM_ESCALAS; n++) {
+        Mat_<Raspberry::Flt> temp;
+        resize(modelo, temp, Size(), escalas[n], escalas[n], INTER_NEAREST);
+
+        // As duas versões alteram a entrada, então cada repetição parte de uma cópia do modelo redimensionado
+        Mat_<Raspberry::Flt> entrada, atual, vetorizado;
+
+        double inicio = Raspberry::timeSinceEpoch();
+        for (auto r = 0; r < repeticoes; r++) {
+            temp.copyTo(entrada);
+            atual = ImageProcessing::modulo2(ImageProcessing::dcReject(entrada, 1.0));
+        }
+        double tempoAtual = (Raspberry::timeSinceEpoch() - inicio)/repeticoes;
+
+        inicio = Raspberry::timeSinceEpoch();
+        for (auto r = 0; r < repeticoes; r++) {
+            temp.copyTo(vetorizado);
+            ImageProcessing::preProcessa(vetorizado, 1.0);
+        }
+        double tempoVetorizado = (Raspberry::timeSinceEpoch() - inicio)/repeticoes;
+
+        totalAtual += tempoAtual;
+        totalVetorizado += tempoVetorizado;
+
+        std::ostringstream linha;
+        linha << escalas[n] << "\t" << temp.total() << "\t" << 1e6*tempoAtual << "\t" << 1e6*tempoVetorizado
+              << "\t" << norm(atual, vetorizado, NORM_INF);
+        Raspberry::print(linha.str());
+    }
+
+    std::ostringstream os;
+    os << "Todas as escalas: atual " << 1e6*totalAtual << " us, vetorizado " << 1e6*totalVetorizado
+       << " us (" << totalAtual/totalVetorizado << "x)";
+    Raspberry::print(os.str());
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+/*
+ *  BaseSimulador: simula milhares de robôs, cada um com o seu ControleAutomatico::Controlador em tempo virtual,
+ *  distribuídos no pool de threads. Mede a vazão (passos de controle por segundo) e confere que o resultado,
+ *  resumido em uma assinatura dos comandos gerados, não depende da quantidade de threads.
+ */
+
+/* -------- Includes -------- */
+#include "Raspberry.hpp"
+#include "AgendadorMotor.hpp"
+#include "ControleAutomatico.hpp"
+#include "ThreadPool.hpp"
+#include "Configuracao.hpp"
+
+/* -------- Defines -------- */
+#define SIM_ROBOS           4096
+#define SIM_PASSOS          3000
+#define SIM_FPS             30.0
+#define SIM_BLOCO           16      // Robôs por tarefa do pool
+#define SIM_SEMENTE         1234
+
+#define SIM_VELOCIDADE      0.3     // [m/s] Avanço no FRENTE
+#define SIM_ESCALA_1M       0.1f    // Escala aparente do alvo a 1 m
+#define SIM_DIST_MIN        1.5     // [m] Faixa da distância de um novo alvo
+#define SIM_DIST_MAX        4.0
+#define SIM_DIST_COLISAO    0.3     // [m]
+#define SIM_PROB_PERDA      0.02    // Probabilidade do alvo não ser detectado no quadro
+#define SIM_PROB_ERRO       0.05    // Probabilidade do número ser classificado errado
+
+/* -------- Robô simulado -------- */
+/*
+ * Robô e cena simulados: um alvo por vez à frente do robô, as manobras seguem as durações e a preempção do AgendadorMotor
+ */
+class RoboSimulado
+{
+    private:
+        double tempo = 0.0;
+        uint64_t semente;
+        ControleAutomatico::Controlador controlador;
+
+        // Cena
+        double distancia;
+        int numero;
+
+        // Manobra em andamento na Pi
+        Raspberry::Comando movimento = Raspberry::Comando::PARADO;
+        Raspberry::Comando manobra = Raspberry::Comando::NAO_SELECIONADO;
+        double fimManobra = 0.0;
+
+        /*
+         * xorshift64, cada robô tem a sua sequência para o resultado não depender da ordem de execução
+         */
+        double aleatorio()
+        {
+            semente ^= semente << 13;
+            semente ^= semente >> 7;
+            semente ^= semente << 17;
+            return (semente >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        void novoAlvo()
+        {
+            distancia = SIM_DIST_MIN + (SIM_DIST_MAX - SIM_DIST_MIN)*aleatorio();
+            numero = std::min(9, int(10*aleatorio()));
+        }
+
+        /*
+         * Aplica o comando com as regras de manobra do AgendadorMotor da Pi
+         */
+        void aplica(Raspberry::Comando comando)
+        {
+            bool manobraAtiva = manobra != Raspberry::Comando::NAO_SELECIONADO;
+            if (manobraAtiva && !Manobra::isPreemptada(manobra, comando)) {
+                return;
+            }
+
+            double duracao = Manobra::getDuracao(comando, movimento);
+            if (duracao > 0.0) {
+                manobra = comando;
+                fimManobra = tempo + duracao;
+            }
+            else {
+                manobra = Raspberry::Comando::NAO_SELECIONADO;
+            }
+        }
+    public:
+        uint64_t assinatura = 14695981039346656037ull;
+        uint64_t alvos = 0;
+        uint64_t colisoes = 0;
+
+        RoboSimulado(uint64_t semente)
+            : semente(semente | 1), controlador(ESCALA_DIST_MIN, [this] { return tempo; }, false)
+        {
+            novoAlvo();
+        }
+
+        /*
+         * Avança um quadro: move o robô, detecta o alvo e atualiza o controle
+         */
+        void passo(double dt)
+        {
+            tempo += dt;
+
+            // Fim da manobra, o robô está diante de um novo alvo
+            if (manobra != Raspberry::Comando::NAO_SELECIONADO && tempo >= fimManobra) {
+                manobra = Raspberry::Comando::NAO_SELECIONADO;
+                movimento = Raspberry::Comando::PARADO;
+                novoAlvo();
+                alvos++;
+            }
+
+            if (movimento == Raspberry::Comando::FRENTE) {
+                distancia -= SIM_VELOCIDADE*dt;
+
+                if (distancia < SIM_DIST_COLISAO) {
+                    novoAlvo();
+                    colisoes++;
+                }
+            }
+
+            // Percepção
+            float escala = SIM_ESCALA_1M / distancia;
+            bool detectado = escala > ESCALA_MIN && aleatorio() > SIM_PROB_PERDA;
+            bool enquadrado = detectado && escala > ESCALA_DIST_MIN;
+            int numPredito = aleatorio() < SIM_PROB_ERRO ? std::min(9, int(10*aleatorio())) : numero;
+
+            Raspberry::Comando comando = controlador.atualiza(enquadrado, numPredito);
+            aplica(comando);
+
+            // FNV-1a dos comandos gerados
+            assinatura = (assinatura ^ static_cast<uint64_t>(comando)) * 1099511628211ull;
+        }
+};
+
+/* -------- Main -------- */
+void uso()
+{
+    Raspberry::erro("Uso: BaseSimulador [--robos N] [--passos P] [--threads 1,2,4] [--semente S]");
+}
+
+int main(int argc, char *argv[])
+{
+    // Opções
+    size_t numRobos = SIM_ROBOS;
+    size_t numPassos = SIM_PASSOS;
+    uint64_t semente = SIM_SEMENTE;
+    std::vector<unsigned> numThreads{1, std::thread::hardware_concurrency()};
+
+    for (auto i = 1; i < argc; i++) {
+        std::string opcao = argv[i];
+
+        if (opcao == "--robos" && i + 1 < argc) {
+            numRobos = atol(argv[++i]);
+        }
+        else if (opcao == "--passos" && i + 1 < argc) {
+            numPassos = atol(argv[++i]);
+        }
+        else if (opcao == "--semente" && i + 1 < argc) {
+            semente = atoll(argv[++i]);
+        }
+        else if (opcao == "--threads" && i + 1 < argc) {
+            numThreads.clear();
+            std::istringstream lista(argv[++i]);
+            std::string n;
+            while (std::getline(lista, n, ',')) {
+                numThreads.push_back(std::stoi(n));
+            }
+        }
+        else {
+            uso();
+        }
+    }
+
+    const double dt = 1.0 / SIM_FPS;
+
+    std::ostringstream os;
+    os << "Robos: " << numRobos << ", passos: " << numPassos << " (" << numPassos*dt << " s simulados a " << SIM_FPS << " quadros/s)";
+    Raspberry::print(os.str());
+    Raspberry::print("Threads\tPassos/s\tAlvos\tColisoes\tAssinatura");
+
+    uint64_t assinaturaReferencia = 0;
+
+    for (size_t k = 0; k < numThreads.size(); k++) {
+        std::vector<std::unique_ptr<RoboSimulado>> robos;
+        for (size_t i = 0; i < numRobos; i++) {
+            robos.push_back(std::make_unique<RoboSimulado>(semente + i*0x9E3779B97F4A7C15ull));
+        }
+
+        ThreadPool pool(numThreads[k]);
+
+        // Os robôs são independentes, cada tarefa avança o seu bloco de robôs por toda a simulação
+        double inicio = Raspberry::timeSinceEpoch();
+        pool.paraleloPara(numRobos, SIM_BLOCO, [&](size_t primeiro, size_t fim) {
+            for (size_t i = primeiro; i < fim; i++) {
+                for (size_t p = 0; p < numPassos; p++) {
+                    robos[i]->passo(dt);
+                }
+            }
+        });
+        double decorrido = Raspberry::timeSinceEpoch() - inicio;
+
+        uint64_t assinatura = 0, alvos = 0, colisoes = 0;
+        for (const auto& robo : robos) {
+            assinatura = (assinatura ^ robo->assinatura) * 1099511628211ull;
+            alvos += robo->alvos;
+            colisoes += robo->colisoes;
+        }
+
+        std::ostringstream linha;
+        linha << pool.getNumThreads() << "\t" << numRobos*numPassos / decorrido << "\t" << alvos << "\t" << colisoes
+              << "\t" << std::hex << assinatura;
+        Raspberry::print(linha.str());
+
+        if (k == 0) {
+            assinaturaReferencia = assinatura;
+        }
+        else if (assinatura != assinaturaReferencia) {
+            Raspberry::erro("Simulador: o resultado mudou com a quantidade de threads!");
+        }
+    }
+
+    return 0;
+}
@@ -6,117 +6,348 @@
 /* -------- Includes -------- */
 #include "Raspberry.hpp"
 #include "Server.hpp"
+#include "AgendadorMotor.hpp"
+#include "PontoFixo.hpp"
+#include "CapturaV4L2.hpp"
+#include "DetectorMovimento.hpp"
+#include "Escalonador.hpp"
+#include "Telemetria.hpp"
+#include "Configuracao.hpp"
 
-/* -------- Variáveis Globais -------- */
-std::mutex mutex;
-std::condition_variable cv_motor;
-Raspberry::Comando comando = Raspberry::Comando::NAO_SELECIONADO;
+#include <csignal>
 
-/* -------- Thread de controle dos motores -------- */
-void controleMotor(std::atomic<bool>& run)
+/* -------- Defines -------- */
+#define SERVIDOR_TIMEOUT    30      // [s] Espera pela conexão e pelos comandos da Base
+#define SESSAO_RETENCAO     60      // [s] Depois de uma queda a sessão aguarda a Base reconectar por este tempo
+
+/* -------- Main -------- */
+int main(int argc, char *argv[])
 {
-    // Inicializa os GPIOs da ponte H
-    Raspberry::Motores::initPwm();
-
-    while(run) {
-        std::unique_lock<std::mutex> lock(mutex);
-
-        // Espera receber um comando
-        cv_motor.wait(lock);
-
-        // Modo manual
-        if (comando < Raspberry::Comando::AUTO_PARADO) {
-            Raspberry::Motores::setDirAjustado(comando);
-        }
-        else { // Modo automático            
-            double timeExe = 0.0;
-
-            switch (comando) {
-                case Raspberry::Comando::AUTO_180_ESQUERDA:
-                    Raspberry::Motores::setDirAjustado(Raspberry::Comando::GIRA_ESQUERDA);
-                    timeExe = 0.9;
-                    break;
-
-                case Raspberry::Comando::AUTO_180_DIREITA:
-                    Raspberry::Motores::setDirAjustado(Raspberry::Comando::GIRA_DIREITA);
-                    timeExe = 0.9;
-                    break;
-
-                case Raspberry::Comando::AUTO_90_ESQUERDA:
-                    Raspberry::Motores::setDirAjustado(Raspberry::Comando::GIRA_ESQUERDA);
-                    timeExe = 0.48;
-                    break;
-
-                case Raspberry::Comando::AUTO_90_DIREITA:
-                    Raspberry::Motores::setDirAjustado(Raspberry::Comando::GIRA_DIREITA);
-                    timeExe = 0.48;
-                    break;
-
-                case Raspberry::Comando::AUTO_FRENTE:
-                    Raspberry::Motores::setDirAjustado(Raspberry::Comando::FRENTE);
-                    timeExe = 4;
-                    break;
-
-                default:
-                    Raspberry::Motores::setDirAjustado(Raspberry::Comando::PARADO);
-                    timeExe = 10;
-                    break;
-            }
+    if (argc < 2) {
+        Raspberry::erro("Poucos argumentos.");
+    }
+
+    // Mede o uso de CPU de cada backend de PWM e encerra
+    if (std::string(argv[1]) == "--mede-pwm") {
+        double segundos = argc > 2 ? atof(argv[2]) : 5.0;
+        const int pinos[PWM_NUM_CANAIS] = {M1_A, M1_B, M2_A, M2_B};
+        const int enables[2] = {M1_EN, M2_EN};
 
-            double timer = Raspberry::timeSinceEpoch();    
-            while (Raspberry::timeSinceEpoch() - timer < timeExe) {
-                ;;
+        for (auto nome : {"soft", "unico", "hw", "mock"}) {
+            auto backend = Pwm::cria(nome, pinos, enables, PWM_MAX);
+            Raspberry::print(std::string(nome) + ": " + std::to_string(100.0*Pwm::medeCpu(*backend, segundos)) + " % CPU");
+        }
+        return 0;
+    }
+
+    // Mede a taxa e o tamanho dos quadros da captura V4L2 e encerra, ex: --mede-captura /dev/video0 [segundos] [yuyv]
+    if (std::string(argv[1]) == "--mede-captura" && argc > 2) {
+        double segundos = argc > 3 ? atof(argv[3]) : 5.0;
+        bool mjpeg = !(argc > 4 && std::string(argv[4]) == "yuyv");
+
+        try {
+            CapturaV4L2 captura(argv[2], CAMERA_FRAME_WIDTH, CAMERA_FRAME_HEIGHT, CAMERA_FPS, mjpeg);
+            uint64_t quadros = 0, bytes = 0;
+            uint32_t tamanho;
+
+            double inicio = Raspberry::timeSinceEpoch();
+            while (Raspberry::timeSinceEpoch() - inicio < segundos) {
+                captura.proximo(tamanho);
+                quadros++;
+                bytes += tamanho;
             }
-            
-            Raspberry::Motores::setDirAjustado(Raspberry::Comando::PARADO);
+            double duracao = Raspberry::timeSinceEpoch() - inicio;
+
+            std::ostringstream os;
+            os << captura.getFormato() << ": " << quadros/duracao << " quadros/s, " << bytes/std::max<uint64_t>(quadros, 1) << " bytes por quadro";
+            Raspberry::print(os.str());
+        }
+        catch (const std::exception& e) {
+            Raspberry::erro(e.what());
         }
+        return 0;
     }
 
-    // Desliga os motores
-    Raspberry::Motores::stopPWM();
-}
+    // Backend dos PWMs: soft (padrão), unico, hw ou mock
+    std::string backendPwm = "soft";
+    int primeiraOpcao = 2;
+    if (argc > 2 && std::string(argv[2]).rfind("--", 0) != 0) {
+        backendPwm = argv[2];
+        primeiraOpcao = 3;
+    }
 
-/* -------- Main -------- */
-int main(int argc, char *argv[])
-{
-    if (argc < 2) {
-        Raspberry::erro("Poucos argumentos.");
+    // Detecção na Pi: envia somente as detecções e um preview a cada periodoPreview quadros
+    std::string arquivoModelo;
+    int periodoPreview = PREVIEW_PERIODO;
+    bool movimento = false;     // Reenvia as detecções anteriores enquanto a cena não muda, sem refazer a busca
+    std::string dispositivoV4L2;    // Captura direto do V4L2 no lugar do VideoCapture, ex: /dev/video0
+    bool mjpeg = true;              // Na captura V4L2 pede o MJPEG da câmera, que é transmitido sem recompressão
+
+    for (auto i = primeiraOpcao; i < argc; i++) {
+        std::string opcao = argv[i];
+
+        if (opcao == "--deteccao" && i + 1 < argc) {
+            arquivoModelo = argv[++i];
+        }
+        else if (opcao == "--preview" && i + 1 < argc) {
+            periodoPreview = std::max(1, atoi(argv[++i]));
+        }
+        else if (opcao == "--movimento") {
+            movimento = true;
+        }
+        else if (opcao == "--v4l2" && i + 1 < argc) {
+            dispositivoV4L2 = argv[++i];
+        }
+        else if (opcao == "--yuyv") {
+            mjpeg = false;
+        }
+        else {
+            Raspberry::erro("Opção desconhecida: " + opcao);
+        }
+    }
+
+    const bool deteccao = !arquivoModelo.empty();
+
+    // Modelos da busca em ponto fixo
+    float escalas[NUM_ESCALAS];
+    PontoFixo::Modelo modelos[NUM_ESCALAS];
+    Raspberry::FindPos corrBuf[NUM_ESCALAS];
+    Mat_<PontoFixo::Pixel> modelo;
+    DetectorMovimento detectorMovimento(MOVIMENTO_LIMIAR, MOVIMENTO_REUTILIZADOS_MAX);
+
+    if (deteccao) {
+        try {
+            Escalonador::configura();
+        }
+        catch (const std::exception& e) {
+            Raspberry::erro(e.what());
+        }
+
+        Mat_<Raspberry::Cor> modeloCor = imread(arquivoModelo, 1);
+        if (modeloCor.empty()) {
+            Raspberry::erro("Falha ao abrir o modelo " + arquivoModelo);
+        }
+
+        // As escalas dependem da resolução, os modelos são gerados depois da negociação com a Base
+        PontoFixo::getCinza(modeloCor, modelo);
+        Raspberry::print(std::string("Deteccao na Pi, kernel ") + PontoFixo::getKernel());
     }
     
-    // Inicia a camera e configura a camera
-    VideoCapture camera(CAMERA_VIDEO);
-    if (!camera.isOpened()) {
-        Raspberry::erro("Falha ao abrir a camera.");
+    // Inicia a camera e configura a camera, pelo V4L2 ou pelo VideoCapture
+    VideoCapture camera;
+    std::unique_ptr<CapturaV4L2> captura;
+
+    if (!dispositivoV4L2.empty()) {
+        try {
+            captura = std::make_unique<CapturaV4L2>(dispositivoV4L2, CAMERA_FRAME_WIDTH, CAMERA_FRAME_HEIGHT, CAMERA_FPS, mjpeg);
+        }
+        catch (const std::exception& e) {
+            Raspberry::erro(e.what());
+        }
     }
+    else {
+        camera.open(CAMERA_VIDEO);
+        if (!camera.isOpened()) {
+            Raspberry::erro("Falha ao abrir a camera.");
+        }
+
+        camera.set(CAP_PROP_FRAME_WIDTH, CAMERA_FRAME_WIDTH);
+        camera.set(CAP_PROP_FRAME_HEIGHT, CAMERA_FRAME_HEIGHT);
+        camera.set(CAP_PROP_FPS, CAMERA_FPS);
+    }
+
+    /*
+     * Configura a câmera com o formato pedido pela Base e o troca pelo que a câmera de fato entrega.
+     * A captura V4L2 só troca o formato parada, então ela é reaberta quando o pedido é diferente do atual
+     */
+    auto configuraCamera = [&](Raspberry::Formato& formato) {
+        if (captura) {
+            if (int(formato.largura) != captura->getLargura() || int(formato.altura) != captura->getAltura() || int(formato.fps) != captura->getFps()) {
+                captura.reset();
+                captura = std::make_unique<CapturaV4L2>(dispositivoV4L2, formato.largura, formato.altura, formato.fps, mjpeg);
+            }
 
-    camera.set(CAP_PROP_FRAME_WIDTH, CAMERA_FRAME_WIDTH);
-    camera.set(CAP_PROP_FRAME_HEIGHT, CAMERA_FRAME_HEIGHT);
+            formato = Raspberry::Formato{uint32_t(captura->getLargura()), uint32_t(captura->getAltura()), uint32_t(captura->getFps())};
+            Raspberry::print("Captura V4L2: " + captura->getFormato() + (captura->isMjpeg() ? ", transmitida sem recompressão" : ""));
+        }
+        else {
+            camera.set(CAP_PROP_FRAME_WIDTH, formato.largura);
+            camera.set(CAP_PROP_FRAME_HEIGHT, formato.altura);
+            camera.set(CAP_PROP_FPS, formato.fps);
+
+            formato = Raspberry::Formato{uint32_t(camera.get(CAP_PROP_FRAME_WIDTH)), uint32_t(camera.get(CAP_PROP_FRAME_HEIGHT)), uint32_t(camera.get(CAP_PROP_FPS) + 0.5)};
+            Raspberry::print("Camera: " + std::to_string(formato.largura) + "x" + std::to_string(formato.altura) + " a " + std::to_string(formato.fps) + " fps");
+        }
+    };
+
+    // Uma queda da Base aparece como erro no envio, e não como SIGPIPE encerrando a Pi
+    std::signal(SIGPIPE, SIG_IGN);
 
     // Controle dos Motores
     std::atomic<bool> runMotor{true};
-    std::thread motorThread(controleMotor, std::ref(runMotor));
+    AgendadorMotor agendador(backendPwm);
+    std::thread motorThread(&AgendadorMotor::executa, &agendador, std::ref(runMotor));
 
     try {
         // Inicializa o servidor
-        Server server(argv[1], 30);
-        server.waitConnection();
-       
+        Server server(argv[1], SERVIDOR_TIMEOUT);
+
+        // Sessão atual, mantida depois de uma queda: a câmera, os modelos, a sequência dos quadros e o portão de movimento
+        // continuam valendo quando a Base reconecta com o mesmo token
+        Protocolo::Sessao sessao{0, Raspberry::Formato{0, 0, 0}, 0, 0};
+        Raspberry::Formato pedidoAnterior{0, 0, 0};
+        uint32_t larguraModelos = 0;
+        double queda = 0.0;     // Instante da última queda, zero antes da primeira conexão
+
         // Para armazenar as imagens que serão transmitidas
         Mat_<Raspberry::Cor> frameBuf;
+        Mat_<PontoFixo::Pixel> frameBufCinza;
+        std::vector<Raspberry::Deteccao> deteccoes;
+        uint32_t numQuadros = 0;
+        Protocolo::Comando comando;
+
+        const Raspberry::Byte* jpeg = nullptr;
+        uint32_t tamanhoJpeg = 0;
+
+        // Telemetria em lotes, a latência vem do carimbo do quadro ecoado no comando
+        Telemetria telemetria;
+        uint16_t latencia = 0, processamento = 0;
+
+        while (true) {
+            try {
+                server.waitConnection();
 
-        while(true) {
-            // Transmite os quadros
-            camera.read(frameBuf);
-            server.sendImageCompactada(frameBuf);
+                // Formato da câmera: a Base pede, zero mantém o padrão, e a Pi responde com o que a câmera entrega
+                Protocolo::Sessao pedida;
+                server.receiveSessao(pedida);
 
-            // Recebe o comando de ação
-            {
-                std::unique_lock<std::mutex> lock(mutex);
-                server.receiveBytes(sizeof(comando), (Raspberry::Byte *) &comando); 
-            }         
+                Raspberry::Formato formato = pedida.formato;
+                formato.largura = formato.largura > 0 ? formato.largura : CAMERA_FRAME_WIDTH;
+                formato.altura = formato.altura > 0 ? formato.altura : CAMERA_FRAME_HEIGHT;
+                formato.fps = formato.fps > 0 ? formato.fps : CAMERA_FPS;
 
-            // Acorda a thread para executar o comando
-            cv_motor.notify_one();  
+                const bool retomada = sessao.token != 0 && pedida.token == sessao.token;
+                if (!retomada) {
+                    numQuadros = 0;
+                    latencia = processamento = 0;
+                    detectorMovimento.reinicia();
+                }
+
+                // A câmera só é reconfigurada quando o pedido muda, uma reconexão não reabre a captura
+                if (formato.largura != pedidoAnterior.largura || formato.altura != pedidoAnterior.altura || formato.fps != pedidoAnterior.fps) {
+                    pedidoAnterior = formato;
+                    configuraCamera(formato);
+                }
+                else {
+                    formato = sessao.formato;
+                }
+
+                // O alvo aparece maior em resoluções maiores, as escalas acompanham a largura do quadro
+                if (deteccao && formato.largura != larguraModelos) {
+                    float fator = Raspberry::getFatorEscala(formato.largura);
+                    Raspberry::getEscalasGeometricas(escalas, NUM_ESCALAS, ESCALA_MIN*fator, ESCALA_MAX*fator);
+                    PontoFixo::getModelos(modelo, modelos, NUM_ESCALAS, escalas);
+                    larguraModelos = formato.largura;
+                }
+
+                sessao = Protocolo::Sessao{pedida.token, formato, numQuadros, retomada};
+                server.sendSessao(sessao);
+
+                if (retomada) {
+                    std::ostringstream os;
+                    os << "Sessao retomada no quadro " << numQuadros << ", " << (Raspberry::timeSinceEpoch() - queda)*1e3 << " ms depois da queda";
+                    Raspberry::print(os.str());
+                }
+                queda = 0.0;
+
+                // O JPEG da câmera vai direto para a Base quando a Pi não precisa do quadro decodificado
+                const bool repassaJpeg = captura && captura->isMjpeg() && !deteccao;
+
+                while(true) {
+                    if (captura) {
+                        jpeg = captura->proximo(tamanhoJpeg);
+                        if (!repassaJpeg && !captura->getQuadro(frameBuf)) {
+                            continue;   // JPEG corrompido da câmera, o buffer volta para o driver no próximo
+                        }
+                    }
+                    else {
+                        camera.read(frameBuf);
+                    }
+                    Protocolo::Quadro quadro{numQuadros++, Protocolo::getCarimbo()};
+
+                    if (deteccao) {
+                        // Busca do modelo e recorte do número feitos aqui, a Base recebe poucos bytes por quadro.
+                        // Com a cena parada as detecções do quadro anterior são enviadas de novo
+                        if (!movimento || detectorMovimento.mudou(frameBuf)) {
+                            PontoFixo::getCinza(frameBuf, frameBufCinza);
+                            Raspberry::FindPos maxCorr = PontoFixo::getMaxCorrelacao(frameBufCinza, modelos, corrBuf, NUM_ESCALAS, escalas);
+
+                            deteccoes.clear();
+                            if (maxCorr.ponto.correlacao > THRESHOLD) {
+                                deteccoes.push_back(Raspberry::Deteccao{maxCorr, PontoFixo::getRecorte(frameBufCinza, maxCorr.ponto.posicao, maxCorr.escala*NUM_SIZE)});
+                            }
+                        }
+
+                        bool enviaPreview = quadro.sequencia % periodoPreview == 0;
+                        server.sendDeteccoes(quadro, deteccoes, enviaPreview ? frameBuf : Mat_<Raspberry::Cor>());
+                    }
+                    else if (repassaJpeg) {
+                        // Transmite o JPEG direto do buffer da câmera
+                        server.sendQuadro(quadro, jpeg, tamanhoJpeg);
+                    }
+                    else {
+                        // Transmite os quadros
+                        server.sendQuadro(quadro, frameBuf);
+                    }
+
+                    // Uma amostra a cada TELEMETRIA_PERIODO, o lote vai junto do quadro quando completa
+                    if (telemetria.isHora()) {
+                        uint32_t filaCaptura = captura ? captura->getProntos() : 0;
+                        uint32_t filaMotor = std::min<uint32_t>(agendador.getPendentes(), UINT8_MAX);
+
+                        if (telemetria.amostra(latencia, processamento, filaMotor, filaCaptura, server.getFilaEnvio())) {
+                            server.sendTelemetria(telemetria.getLote());
+                            telemetria.esvazia();
+                        }
+                    }
+
+                    // Recebe o comando de ação e agenda a sua execução
+                    server.receiveComando(comando);
+                    latencia = Protocolo::getDecimosMs(Protocolo::getCarimbo() - comando.quadro.carimbo);
+                    processamento = comando.processamento;
+
+                    // No controle contínuo o comando vem com os PWMs das rodas
+                    if (comando.comando == Raspberry::Comando::AUTO_VELOCIDADE) {
+                        int velocidades[PWM_NUM_CANAIS];
+                        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+                            velocidades[i] = comando.pwms[i];
+                        }
+                        agendador.postaComando(comando.comando, velocidades);
+                    }
+                    else {
+                        agendador.postaComando(comando.comando);
+                    }
+                }
+            }
+            catch (const std::exception& e) {
+                // Falhas fora da conexão, ex: na câmera, encerram a Pi, assim como a espera pela primeira conexão
+                // e uma queda sem a Base voltar em SESSAO_RETENCAO
+                if (server.isConectado() || sessao.token == 0) {
+                    throw;
+                }
+
+                double agora = Raspberry::timeSinceEpoch();
+                if (queda == 0.0) {
+                    // Queda nova: sem a Base os motores param, inclusive no meio de uma manobra
+                    queda = agora;
+                    int paradas[PWM_NUM_CANAIS] = {0, 0, 0, 0};
+                    agendador.postaComando(Raspberry::Comando::AUTO_VELOCIDADE, paradas);
+                    Raspberry::print(std::string(e.what()) + " Aguardando a Base reconectar.");
+                }
+                else if (agora - queda >= SESSAO_RETENCAO) {
+                    throw std::runtime_error("A Base não reconectou em " + std::to_string(SESSAO_RETENCAO) + " s.");
+                }
+            }
         }
     }
     catch (const std::exception& e) {
@@ -125,8 +356,13 @@ int main(int argc, char *argv[])
 
     // Para a thread dos motores
     runMotor = false;
-    cv_motor.notify_one();
+    agendador.acorda();
     motorThread.join();
+    agendador.imprimeEstatisticas();
+
+    if (movimento) {
+        Raspberry::print(detectorMovimento.getEstatisticas());
+    }
     
     return 0;
 }
\ No newline at end of file
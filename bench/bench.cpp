@@ -0,0 +1,352 @@
+/*
+ *  Bench: microbenchmarks dos caminhos quentes (Google Benchmark). O alvo bench do CMake roda todos e grava
+ *  os resultados em JSON, para acompanhar regressões entre versões.
+ *  A busca em ponto fixo e a transferência pelo Device rodam nos dois programas, o restante somente na Base.
+ */
+
+/* -------- Includes -------- */
+#include "Raspberry.hpp"
+#include "ImageProcessing.hpp"
+#include "MNIST.hpp"
+#include "PontoFixo.hpp"
+#include "JpegParalelo.hpp"
+#include "Server.hpp"
+#include "Client.hpp"
+#include "Configuracao.hpp"
+
+#include <benchmark/benchmark.h>
+
+/* -------- Defines -------- */
+#define BENCH_PORTA         "6500"
+#define BENCH_ESCALA_ALVO   0.2f    // Escala do modelo colado no quadro sintético
+#define BENCH_SEMENTE       1234
+
+/* -------- Dados -------- */
+/*
+ * Quadro sintético com o modelo colado sobre ruído, criado uma vez e compartilhado pelos benchmarks
+ */
+typedef struct
+{
+    Mat_<Raspberry::Cor> quadro;
+    Mat_<Raspberry::Cor> modelo;
+    float escalas[NUM_ESCALAS];
+} Dados;
+
+static const Dados& getDados()
+{
+    static Dados dados = [] {
+        Dados d;
+        d.modelo = imread(BENCH_DIR "/Base/quadrado.png", 1);
+        if (d.modelo.empty()) {
+            Raspberry::erro("Bench: Erro ao abrir o modelo " BENCH_DIR "/Base/quadrado.png");
+        }
+
+        d.quadro.create(CAMERA_FRAME_HEIGHT, CAMERA_FRAME_WIDTH);
+        setRNGSeed(BENCH_SEMENTE);
+        randu(d.quadro, Scalar::all(0), Scalar::all(255));
+
+        Mat_<Raspberry::Cor> alvo;
+        resize(d.modelo, alvo, Size(), BENCH_ESCALA_ALVO, BENCH_ESCALA_ALVO, INTER_AREA);
+        alvo.copyTo(d.quadro(Rect(Point((d.quadro.cols - alvo.cols)/2, (d.quadro.rows - alvo.rows)/2), alvo.size())));
+
+        Raspberry::getEscalasGeometricas(d.escalas, NUM_ESCALAS, ESCALA_MIN, ESCALA_MAX);
+        return d;
+    }();
+
+    return dados;
+}
+
+/*
+ * Servidor e cliente conectados pelo loopback
+ */
+typedef struct
+{
+    std::unique_ptr<Server> server;
+    std::unique_ptr<Client> client;
+} Conexao;
+
+static Conexao& getConexao()
+{
+    static Conexao conexao = [] {
+        Conexao c;
+        c.server = std::make_unique<Server>(BENCH_PORTA, 5);
+        c.client = std::make_unique<Client>("127.0.0.1", BENCH_PORTA);
+
+        // O connect termina pela fila do listen, antes do accept
+        c.client->waitConnection();
+        c.server->waitConnection();
+        return c;
+    }();
+
+    return conexao;
+}
+
+/* -------- Ponto fixo -------- */
+static void BM_PontoFixo_getCinza(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<PontoFixo::Pixel> cinza;
+
+    for (auto _ : state) {
+        PontoFixo::getCinza(dados.quadro, cinza);
+        benchmark::DoNotOptimize(cinza.data);
+    }
+}
+BENCHMARK(BM_PontoFixo_getCinza)->Unit(benchmark::kMicrosecond);
+
+static void BM_PontoFixo_getModelos(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<PontoFixo::Pixel> modelo;
+    PontoFixo::getCinza(dados.modelo, modelo);
+    PontoFixo::Modelo modelos[NUM_ESCALAS];
+
+    for (auto _ : state) {
+        PontoFixo::getModelos(modelo, modelos, NUM_ESCALAS, dados.escalas);
+    }
+}
+BENCHMARK(BM_PontoFixo_getModelos)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Correlação de toda a região válida de uma escala, o argumento é o índice da escala. Com o kernel especializado
+// no tamanho do modelo da escala e com o genérico
+static void BM_PontoFixo_correlaciona(benchmark::State& state, bool especializado)
+{
+    const Dados& dados = getDados();
+    Mat_<PontoFixo::Pixel> modelo, cinza;
+    PontoFixo::getCinza(dados.modelo, modelo);
+    PontoFixo::getCinza(dados.quadro, cinza);
+
+    int n = state.range(0);
+    PontoFixo::Modelo modelos[NUM_ESCALAS];
+    PontoFixo::getModelos(modelo, modelos, NUM_ESCALAS, dados.escalas);
+
+    if (modelos[n].coef.rows > cinza.rows || modelos[n].coef.cols > cinza.cols) {
+        state.SkipWithError("modelo maior que o quadro");
+        return;
+    }
+
+    PontoFixo::Integrais integrais;
+    PontoFixo::getIntegrais(cinza, integrais);
+    Mat_<float> resultado;
+
+    for (auto _ : state) {
+        PontoFixo::correlaciona(cinza, integrais, modelos[n], 0, cinza.rows - modelos[n].coef.rows + 1, resultado, especializado);
+        benchmark::DoNotOptimize(resultado.data);
+    }
+    state.SetLabel(PontoFixo::getKernel());
+}
+BENCHMARK_CAPTURE(BM_PontoFixo_correlaciona, especializado, true)->DenseRange(0, NUM_ESCALAS - 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_PontoFixo_correlaciona, generico, false)->DenseRange(0, NUM_ESCALAS - 1)->Unit(benchmark::kMicrosecond);
+
+static void BM_PontoFixo_getMaxCorrelacao(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<PontoFixo::Pixel> modelo, cinza;
+    PontoFixo::getCinza(dados.modelo, modelo);
+    PontoFixo::getCinza(dados.quadro, cinza);
+
+    PontoFixo::Modelo modelos[NUM_ESCALAS];
+    PontoFixo::getModelos(modelo, modelos, NUM_ESCALAS, dados.escalas);
+    Raspberry::FindPos corrBuf[NUM_ESCALAS];
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PontoFixo::getMaxCorrelacao(cinza, modelos, corrBuf, NUM_ESCALAS, dados.escalas));
+    }
+    state.SetLabel(PontoFixo::getKernel());
+}
+BENCHMARK(BM_PontoFixo_getMaxCorrelacao)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/* -------- Device -------- */
+// Quadro compactado enviado pelo servidor e recebido pelo cliente, como a Pi e a Base
+static void BM_Device_imagemCompactada(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Conexao& conexao = getConexao();
+    Mat_<Raspberry::Cor> recebido;
+
+    for (auto _ : state) {
+        // O envio em outra thread, como no BM_Device_vazao, um JPEG maior que o buffer do socket travaria
+        std::thread envia([&] { conexao.server->sendImageCompactada(dados.quadro); });
+        conexao.client->receiveImageCompactada(recebido);
+        envia.join();
+        benchmark::DoNotOptimize(recebido.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Device_imagemCompactada)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Vazão do sendBytes/receiveBytes, o argumento é o tamanho da transferência
+static void BM_Device_vazao(benchmark::State& state)
+{
+    Conexao& conexao = getConexao();
+    std::vector<Raspberry::Byte> envio(state.range(0), 0x55), recepcao(state.range(0));
+
+    for (auto _ : state) {
+        // A recepção em outra thread, transferências maiores que o buffer do socket travariam
+        std::thread recebe([&] { conexao.client->receiveBytes(recepcao.size(), recepcao.data()); });
+        conexao.server->sendBytes(envio.size(), envio.data());
+        recebe.join();
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_Device_vazao)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->UseRealTime();
+
+/* -------- JPEG -------- */
+// Quadro sintético redimensionado para a resolução dos argumentos (largura, altura)
+static Mat_<Raspberry::Cor> getQuadro(const benchmark::State& state)
+{
+    Mat_<Raspberry::Cor> quadro;
+    resize(getDados().quadro, quadro, Size(state.range(0), state.range(1)), 0, 0, INTER_LINEAR);
+    return quadro;
+}
+
+// Compressão na Pi, sem e com os reinícios por linha de MCUs
+static void BM_Jpeg_codifica(benchmark::State& state, bool reinicios)
+{
+    Mat_<Raspberry::Cor> quadro = getQuadro(state);
+    const std::vector<int> param{IMWRITE_JPEG_QUALITY, 80, IMWRITE_JPEG_RST_INTERVAL, reinicios ? JpegParalelo::getIntervaloReinicio(quadro.cols) : 0};
+    std::vector<Raspberry::Byte> jpeg;
+
+    for (auto _ : state) {
+        imencode(".jpeg", quadro, jpeg, param);
+        benchmark::DoNotOptimize(jpeg.data());
+    }
+    state.counters["bytes"] = jpeg.size();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_Jpeg_codifica, sem_reinicios, false)->Args({320, 240})->Args({640, 480})->Args({1280, 720})->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Jpeg_codifica, com_reinicios, true)->Args({320, 240})->Args({640, 480})->Args({1280, 720})->Unit(benchmark::kMillisecond);
+
+// Descompressão na Base, o imdecode de uma vez e as fatias paralelas no pool
+static void BM_Jpeg_decodifica(benchmark::State& state, bool paralelo)
+{
+    Mat_<Raspberry::Cor> quadro = getQuadro(state);
+    const std::vector<int> param{IMWRITE_JPEG_QUALITY, 80, IMWRITE_JPEG_RST_INTERVAL, JpegParalelo::getIntervaloReinicio(quadro.cols)};
+    std::vector<Raspberry::Byte> jpeg;
+    imencode(".jpeg", quadro, jpeg, param);
+
+    JpegParalelo decodificador(paralelo ? 0 : 1);
+    Mat_<Raspberry::Cor> recebido;
+
+    for (auto _ : state) {
+        decodificador.decodifica(jpeg, recebido);
+        benchmark::DoNotOptimize(recebido.data);
+    }
+    state.counters["paralelos"] = double(decodificador.getParalelos()) / decodificador.getQuadros();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_Jpeg_decodifica, imdecode, false)->Args({320, 240})->Args({640, 480})->Args({1280, 720})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Jpeg_decodifica, paralelo, true)->Args({320, 240})->Args({640, 480})->Args({1280, 720})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+#ifdef BASE
+/* -------- Busca em float -------- */
+static void BM_Cor2Flt(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<Raspberry::Flt> quadroFlt;
+
+    for (auto _ : state) {
+        ImageProcessing::Cor2Flt(dados.quadro, quadroFlt);
+        benchmark::DoNotOptimize(quadroFlt.data);
+    }
+}
+BENCHMARK(BM_Cor2Flt)->Unit(benchmark::kMicrosecond);
+
+static void BM_getModeloPreProcessados(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<Raspberry::Flt> modelo;
+    ImageProcessing::Cor2Flt(dados.modelo, modelo);
+
+    float escalas[NUM_ESCALAS];
+    std::copy(dados.escalas, dados.escalas + NUM_ESCALAS, escalas);
+    Mat_<Raspberry::Flt> modelos[NUM_ESCALAS];
+
+    for (auto _ : state) {
+        ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, modelos, NUM_ESCALAS, escalas);
+    }
+}
+BENCHMARK(BM_getModeloPreProcessados)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// matchTemplateSame de uma escala, o argumento é o índice da escala
+static void BM_matchTemplateSame(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<Raspberry::Flt> modelo, quadroFlt;
+    ImageProcessing::Cor2Flt(dados.modelo, modelo);
+    ImageProcessing::Cor2Flt(dados.quadro, quadroFlt);
+
+    float escalas[NUM_ESCALAS];
+    std::copy(dados.escalas, dados.escalas + NUM_ESCALAS, escalas);
+    Mat_<Raspberry::Flt> modelos[NUM_ESCALAS];
+    ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, modelos, NUM_ESCALAS, escalas);
+
+    const Mat_<Raspberry::Flt>& escala = modelos[state.range(0)];
+    if (escala.rows > quadroFlt.rows || escala.cols > quadroFlt.cols) {
+        state.SkipWithError("modelo maior que o quadro");
+        return;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ImageProcessing::TemplateMatching::matchTemplateSame(quadroFlt, escala, TM_CCOEFF_NORMED).data);
+    }
+}
+BENCHMARK(BM_matchTemplateSame)->DenseRange(0, NUM_ESCALAS - 1)->Unit(benchmark::kMicrosecond);
+
+static void BM_getMaxCorrelacao(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<Raspberry::Flt> modelo, quadroFlt;
+    ImageProcessing::Cor2Flt(dados.modelo, modelo);
+    ImageProcessing::Cor2Flt(dados.quadro, quadroFlt);
+
+    float escalas[NUM_ESCALAS];
+    std::copy(dados.escalas, dados.escalas + NUM_ESCALAS, escalas);
+    Mat_<Raspberry::Flt> modelos[NUM_ESCALAS];
+    ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, modelos, NUM_ESCALAS, escalas);
+    Raspberry::FindPos corrBuf[NUM_ESCALAS];
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ImageProcessing::TemplateMatching::getMaxCorrelacao(quadroFlt, modelos, corrBuf, NUM_ESCALAS, escalas));
+    }
+}
+BENCHMARK(BM_getMaxCorrelacao)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/* -------- MNIST -------- */
+static void BM_getMNIST(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<Raspberry::Flt> quadroFlt;
+    ImageProcessing::Cor2Flt(dados.quadro, quadroFlt);
+    Point centro(quadroFlt.cols/2, quadroFlt.rows/2);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MNIST::getMNIST(quadroFlt, centro, BENCH_ESCALA_ALVO*NUM_SIZE).data);
+    }
+}
+BENCHMARK(BM_getMNIST)->Unit(benchmark::kMicrosecond);
+
+// Inferência de um lote, o argumento é o tamanho do lote
+static void BM_inferencia(benchmark::State& state)
+{
+    const Dados& dados = getDados();
+    Mat_<Raspberry::Flt> quadroFlt;
+    ImageProcessing::Cor2Flt(dados.quadro, quadroFlt);
+
+    torch::jit::script::Module module = torch::jit::load(BENCH_DIR "/Base/lenet5_model.pt", torch::Device(torch::kCPU));
+    module = torch::jit::optimize_for_inference(module);
+
+    std::vector<Mat_<Raspberry::Flt>> numeros(state.range(0));
+    for (auto& numero : numeros) {
+        numero = MNIST::getMNIST(quadroFlt, Point(quadroFlt.cols/2, quadroFlt.rows/2), BENCH_ESCALA_ALVO*NUM_SIZE);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MNIST::inferencia(numeros, module));
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_inferencia)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMicrosecond);
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,273 @@
+#include "AgendadorMotor.hpp"
+
+/*
+ * Retorna a direção e a duração [s] correspondente ao comando, duração zero significa que não é uma manobra temporizada
+ */
+double Manobra::getDuracao(Raspberry::Comando comando, Raspberry::Comando& direcao)
+{
+    switch (comando) {
+        case Raspberry::Comando::AUTO_180_ESQUERDA:
+            direcao = Raspberry::Comando::GIRA_ESQUERDA;
+            return 0.9;
+
+        case Raspberry::Comando::AUTO_180_DIREITA:
+            direcao = Raspberry::Comando::GIRA_DIREITA;
+            return 0.9;
+
+        case Raspberry::Comando::AUTO_90_ESQUERDA:
+            direcao = Raspberry::Comando::GIRA_ESQUERDA;
+            return 0.48;
+
+        case Raspberry::Comando::AUTO_90_DIREITA:
+            direcao = Raspberry::Comando::GIRA_DIREITA;
+            return 0.48;
+
+        case Raspberry::Comando::AUTO_FRENTE:
+            direcao = Raspberry::Comando::FRENTE;
+            return 4;
+
+        case Raspberry::Comando::AUTO_PARADO:
+            direcao = Raspberry::Comando::PARADO;
+            return 10;
+
+        default: // Modo manual
+            direcao = comando;
+            return 0.0;
+    }
+}
+
+/*
+ * Comandos de manutenção (PARADO, NAO_SELECIONADO) reenviados a cada quadro não interrompem uma manobra,
+ * e a pausa do AUTO_PARADO só termina pelo prazo
+ */
+bool Manobra::isPreemptada(Raspberry::Comando manobra, Raspberry::Comando comando)
+{
+    if (manobra == Raspberry::Comando::AUTO_PARADO) {
+        return false;
+    }
+
+    return comando != Raspberry::Comando::PARADO && comando != Raspberry::Comando::NAO_SELECIONADO;
+}
+
+#ifdef RASP
+
+/*
+ * Diferença a - b em segundos
+ */
+static double diferenca(const struct timespec& a, const struct timespec& b)
+{
+    return (a.tv_sec - b.tv_sec) + (a.tv_nsec - b.tv_nsec)*1e-9;
+}
+
+/*
+ * Soma um intervalo em segundos ao instante passado
+ */
+static struct timespec soma(const struct timespec& t, double segundos)
+{
+    struct timespec r;
+    int64_t nsec = t.tv_nsec + static_cast<int64_t>(segundos*1e9);
+    r.tv_sec = t.tv_sec + nsec / 1000000000;
+    r.tv_nsec = nsec % 1000000000;
+    return r;
+}
+
+/*
+ * Acumula uma amostra de atraso nas estatísticas de jitter
+ */
+static void acumula(AgendadorMotor::Jitter& jitter, double atraso)
+{
+    jitter.amostras++;
+    jitter.soma += atraso;
+    jitter.maximo = std::max(jitter.maximo, atraso);
+}
+
+AgendadorMotor::AgendadorMotor(const std::string& backendPwm) : backendPwm(backendPwm)
+{
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timerFd < 0) {
+        throw std::runtime_error("AgendadorMotor: Erro ao criar o timer! Código de erro: " + std::to_string(errno));
+    }
+
+    eventoFd = eventfd(0, EFD_CLOEXEC);
+    if (eventoFd < 0) {
+        throw std::runtime_error("AgendadorMotor: Erro ao criar o evento! Código de erro: " + std::to_string(errno));
+    }
+}
+
+AgendadorMotor::~AgendadorMotor()
+{
+    if (timerFd >= 0) {
+        close(timerFd);
+    }
+
+    if (eventoFd >= 0) {
+        close(eventoFd);
+    }
+}
+
+/*
+ * Posta um comando para ser aplicado pela thread dos motores, chamado pela thread de rede.
+ * As velocidades são usadas somente pelo AUTO_VELOCIDADE
+ */
+void AgendadorMotor::postaComando(Raspberry::Comando comando, const int velocidades[])
+{
+    ComandoPostado postado;
+    postado.comando = comando;
+    for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+        postado.velocidades[i] = velocidades != nullptr ? velocidades[i] : 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &postado.postagem);
+
+    postados.store(caixaComando.publica(postado), std::memory_order_relaxed);
+    acorda();
+}
+
+/*
+ * Acorda a thread dos motores, usado também para encerra-la
+ */
+void AgendadorMotor::acorda()
+{
+    uint64_t um = 1;
+    if (write(eventoFd, &um, sizeof(um)) < 0) {
+        throw std::runtime_error("AgendadorMotor: Erro ao sinalizar o evento! Código de erro: " + std::to_string(errno));
+    }
+}
+
+/*
+ * Comandos postados que a thread dos motores ainda não retirou da caixa, incluindo os que serão sobrescritos
+ */
+uint32_t AgendadorMotor::getPendentes() const
+{
+    uint64_t retirado = retirados.load(std::memory_order_relaxed);
+    return uint32_t(postados.load(std::memory_order_relaxed) - retirado);
+}
+
+/*
+ * Arma o timer para o prazo absoluto passado, ou desarma caso seja nulo
+ */
+void AgendadorMotor::armaTimer(const struct timespec* prazo)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+
+    if (prazo != nullptr) {
+        spec.it_value = *prazo;
+    }
+
+    if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        throw std::runtime_error("AgendadorMotor: Erro ao armar o timer! Código de erro: " + std::to_string(errno));
+    }
+}
+
+/*
+ * Aplica o comando nos motores, caso seja uma manobra temporizada agenda o seu fim
+ */
+void AgendadorMotor::aplicaComando(ComandoPostado& postado)
+{
+    Raspberry::Comando comando = postado.comando;
+
+    if (manobraAtiva && !Manobra::isPreemptada(manobraAtual, comando)) {
+        return;
+    }
+
+    Raspberry::Comando direcao;
+    double duracao = Manobra::getDuracao(comando, direcao);
+
+    if (comando == Raspberry::Comando::AUTO_VELOCIDADE) {
+        Raspberry::Motores::setVelPWM(postado.velocidades);
+    }
+    else {
+        Raspberry::Motores::setDirAjustado(direcao);
+    }
+
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    acumula(jitterAplicacao, diferenca(agora, postado.postagem));
+
+    if (duracao > 0.0) {
+        prazoManobra = soma(agora, duracao);
+        armaTimer(&prazoManobra);
+        manobraAtiva = true;
+        manobraAtual = comando;
+    }
+    else if (manobraAtiva) {
+        armaTimer(nullptr);
+        manobraAtiva = false;
+    }
+}
+
+/*
+ * Laço da thread dos motores, dorme até chegar um comando ou vencer o prazo da manobra
+ */
+void AgendadorMotor::executa(std::atomic<bool>& run)
+{
+    // Inicializa os PWMs da ponte H
+    Raspberry::Motores::initPwm(backendPwm);
+
+    struct pollfd fds[2];
+    fds[0] = {timerFd, POLLIN, 0};
+    fds[1] = {eventoFd, POLLIN, 0};
+
+    while (run) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("AgendadorMotor: Erro ao aguardar os eventos! Código de erro: " + std::to_string(errno));
+        }
+
+        // Fim da manobra temporizada
+        if (fds[0].revents & POLLIN) {
+            uint64_t expiracoes;
+            if (read(timerFd, &expiracoes, sizeof(expiracoes)) > 0 && manobraAtiva) {
+                struct timespec agora;
+                clock_gettime(CLOCK_MONOTONIC, &agora);
+                acumula(jitterPrazo, diferenca(agora, prazoManobra));
+
+                Raspberry::Motores::setDirAjustado(Raspberry::Comando::PARADO);
+                manobraAtiva = false;
+            }
+        }
+
+        // Novo comando
+        if (fds[1].revents & POLLIN) {
+            uint64_t eventos;
+            if (read(eventoFd, &eventos, sizeof(eventos)) < 0) {
+                continue;
+            }
+
+            // Somente o comando mais recente importa, os anteriores já foram sobrescritos
+            ComandoPostado postado;
+            if (caixaComando.consome(postado)) {
+                retirados.store(caixaComando.getUltimaSequencia(), std::memory_order_relaxed);
+                aplicaComando(postado);
+            }
+        }
+    }
+
+    // Desliga os motores
+    Raspberry::Motores::stopPWM();
+}
+
+/*
+ * Imprime o jitter da aplicação dos comandos e do fim das manobras, e quantos comandos foram sobrescritos antes de serem aplicados
+ */
+void AgendadorMotor::imprimeEstatisticas() const
+{
+    const Jitter* jitters[] = {&jitterAplicacao, &jitterPrazo};
+    const char* nomes[] = {"Aplicacao do comando", "Prazo da manobra"};
+
+    for (auto i = 0; i < 2; i++) {
+        double media = jitters[i]->amostras > 0 ? jitters[i]->soma / jitters[i]->amostras : 0.0;
+
+        std::ostringstream os;
+        os << nomes[i] << ": " << jitters[i]->amostras << " amostras, media = " << media*1e6
+           << " us, maximo = " << jitters[i]->maximo*1e6 << " us";
+        Raspberry::print(os.str());
+    }
+
+    Raspberry::print("Comandos recebidos: " + std::to_string(caixaComando.getUltimaSequencia()) +
+                     ", sobrescritos: " + std::to_string(caixaComando.getSobrescritos()));
+}
+
+#endif // RASP
@@ -0,0 +1,79 @@
+#ifndef AGENDADOR_MOTOR_HPP
+#define AGENDADOR_MOTOR_HPP
+
+#include "Raspberry.hpp"
+#include "Mailbox.hpp"
+
+/*
+ * Duração e preempção das manobras temporizadas, as regras do AgendadorMotor, também usadas pelo simulador da Base
+ */
+namespace Manobra
+{
+    double getDuracao(Raspberry::Comando comando, Raspberry::Comando& direcao);
+    bool isPreemptada(Raspberry::Comando manobra, Raspberry::Comando comando);
+} // namespace Manobra
+
+#ifdef RASP
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+/*
+ * Agenda a aplicação dos comandos nos motores com prazos absolutos (timerfd), sem espera ocupada.
+ * Um comando novo preempta a manobra temporizada em execução (AUTO_90_*, AUTO_180_*, AUTO_FRENTE).
+ */
+class AgendadorMotor
+{
+    public:
+        typedef struct
+        {
+            uint64_t amostras;
+            double soma;    // [s]
+            double maximo;  // [s]
+        } Jitter;
+
+    private:
+        int timerFd = -1;
+        int eventoFd = -1;
+        std::string backendPwm;
+
+        typedef struct
+        {
+            Raspberry::Comando comando;
+            int velocidades[PWM_NUM_CANAIS];
+            struct timespec postagem;
+        } ComandoPostado;
+
+        // Último comando postado pela thread de rede, sem lock entre as threads
+        Mailbox<ComandoPostado> caixaComando;
+
+        // Sequências do último comando postado e do último retirado da caixa, para a telemetria
+        std::atomic<uint64_t> postados{0};
+        std::atomic<uint64_t> retirados{0};
+
+        // Manobra temporizada em execução
+        bool manobraAtiva = false;
+        Raspberry::Comando manobraAtual = Raspberry::Comando::NAO_SELECIONADO;
+        struct timespec prazoManobra;
+
+        Jitter jitterAplicacao{0, 0.0, 0.0};
+        Jitter jitterPrazo{0, 0.0, 0.0};
+
+        void aplicaComando(ComandoPostado& postado);
+        void armaTimer(const struct timespec* prazo);
+    public:
+        AgendadorMotor(const std::string& backendPwm = "soft");
+        ~AgendadorMotor();
+
+        void postaComando(Raspberry::Comando comando, const int velocidades[] = nullptr);
+        void acorda();
+        uint32_t getPendentes() const;
+        void executa(std::atomic<bool>& run);
+
+        void imprimeEstatisticas() const;
+};
+
+#endif // RASP
+#endif
@@ -0,0 +1,250 @@
+#include "Canal.hpp"
+
+Canal::Canal(EventLoop& loop, Device& device, Erro aoErro)
+    : loop(loop), fd(device.getSocket()), aoErro(std::move(aoErro))
+{
+    if (fd == SOCKET_ERROR) {
+        throw std::runtime_error("Canal: Erro o socket não está conectado!");
+    }
+
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        throw std::runtime_error("Canal: Erro ao tornar o socket não bloqueante! Código de erro: " + std::to_string(errno));
+    }
+
+    timer = loop.criaTimer([this] {
+        if (lendo && aoPrazo) {
+            aoPrazo();
+        }
+    });
+
+    loop.adiciona(fd, 0, [this](uint32_t ocorridos) { aoEvento(ocorridos); });
+}
+
+Canal::~Canal()
+{
+    if (aberto) {
+        loop.remove(fd);
+    }
+    loop.removeTimer(timer);
+}
+
+/*
+ * Prazo sem bytes novos durante uma leitura, zero desativa
+ */
+void Canal::setPrazo(double segundos, EventLoop::Tarefa aoPrazo)
+{
+    prazo = segundos;
+    this->aoPrazo = std::move(aoPrazo);
+
+    if (lendo) {
+        loop.armaTimer(timer, prazo, true);
+    }
+}
+
+/*
+ * Aguarda numBytes, somente uma leitura por vez. Com zero bytes o callback é chamado imediatamente
+ */
+void Canal::recebe(uint32_t numBytes, Recebido recebido)
+{
+    if (!aberto) {
+        return;
+    }
+
+    if (lendo) {
+        throw std::runtime_error("Canal: Erro já existe uma leitura em andamento!");
+    }
+
+    if (numBytes == 0) {
+        recebido(nullptr, 0);
+        return;
+    }
+
+    entrada.resize(numBytes);
+    recebidos = 0;
+    this->recebido = std::move(recebido);
+    lendo = true;
+
+    loop.armaTimer(timer, prazo, true);
+    atualizaEventos();
+}
+
+/*
+ * Aguarda um vetor no formato do Device::sendVectorByte, o tamanho em 4 bytes Big-Endian seguido dos dados
+ */
+void Canal::recebeVetor(Recebido recebido)
+{
+    recebe(sizeof(uint32_t), [this, recebido](const Raspberry::Byte* dados, uint32_t) {
+        recebe(Protocolo::le32(dados), recebido);
+    });
+}
+
+/*
+ * Aguarda uma mensagem do Protocolo, o cabeçalho e depois o corpo. Uma versão diferente encerra o canal
+ */
+void Canal::recebeMensagem(Mensagem mensagem)
+{
+    recebe(PROTOCOLO_CABECALHO, [this, mensagem](const Raspberry::Byte* dados, uint32_t) {
+        Protocolo::Cabecalho cabecalho = Protocolo::leCabecalho(dados);
+
+        try {
+            Protocolo::verifica(cabecalho);
+        }
+        catch (const std::exception& e) {
+            falha(e.what());
+            return;
+        }
+
+        recebe(cabecalho.tamanho, [cabecalho, mensagem](const Raspberry::Byte* dados, uint32_t numBytes) {
+            mensagem(cabecalho, dados, numBytes);
+        });
+    });
+}
+
+/*
+ * Coloca os bytes na fila de transmissão, o que o socket não aceitar agora vai quando ele estiver livre
+ */
+void Canal::envia(const Raspberry::Byte* dados, uint32_t numBytes)
+{
+    if (!aberto) {
+        return;
+    }
+
+    saida.insert(saida.end(), dados, dados + numBytes);
+    escreve();
+}
+
+void Canal::enviaUInt(uint32_t value)
+{
+    Raspberry::Byte buf[sizeof(uint32_t)];
+    Raspberry::Byte* p = buf;
+    Protocolo::escreve32(p, value);
+    envia(buf, sizeof(buf));
+}
+
+/*
+ * Interesse no socket: leitura enquanto houver uma leitura pedida, escrita enquanto houver bytes na fila
+ */
+void Canal::atualizaEventos()
+{
+    if (!aberto) {
+        return;
+    }
+
+    uint32_t novos = 0;
+    if (lendo) {
+        novos |= EPOLLIN;
+    }
+    if (enviados < saida.size()) {
+        novos |= EPOLLOUT;
+    }
+
+    if (novos != eventos) {
+        loop.modifica(fd, novos);
+        eventos = novos;
+    }
+}
+
+void Canal::aoEvento(uint32_t ocorridos)
+{
+    if (ocorridos & EPOLLERR) {
+        falha("erro no socket");
+        return;
+    }
+
+    if (ocorridos & EPOLLOUT) {
+        escreve();
+    }
+
+    // Com EPOLLHUP ainda pode haver bytes a ler, o fim da conexão aparece na leitura
+    if (ocorridos & (EPOLLIN | EPOLLHUP)) {
+        le();
+    }
+}
+
+/*
+ * Máquina de estados da leitura: lê o disponível e entrega cada leitura completa, que pode encadear a próxima
+ */
+void Canal::le()
+{
+    while (aberto && lendo) {
+        ssize_t numRecv = read(fd, entrada.data() + recebidos, std::min(CHUNK_SIZE, entrada.size() - recebidos));
+
+        if (numRecv == 0) {
+            falha("conexão fechada");
+            return;
+        }
+        else if (numRecv < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            else if (errno == EINTR) {
+                continue;
+            }
+            falha("erro ao receber os dados, código de erro: " + std::to_string(errno));
+            return;
+        }
+
+        // Os bytes novos renovam o prazo
+        recebidos += numRecv;
+        loop.armaTimer(timer, prazo, true);
+
+        if (recebidos < entrada.size()) {
+            continue;
+        }
+
+        lendo = false;
+        loop.armaTimer(timer, 0.0);
+
+        std::swap(entrada, entregue);
+        Recebido callback = std::move(recebido);
+        callback(entregue.data(), entregue.size());
+
+        atualizaEventos();
+    }
+}
+
+void Canal::escreve()
+{
+    while (aberto && enviados < saida.size()) {
+        ssize_t numSend = send(fd, saida.data() + enviados, std::min(CHUNK_SIZE, saida.size() - enviados), MSG_NOSIGNAL);
+
+        if (numSend < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            else if (errno == EINTR) {
+                continue;
+            }
+            falha("erro ao transmitir os dados, código de erro: " + std::to_string(errno));
+            return;
+        }
+
+        enviados += numSend;
+    }
+
+    if (enviados == saida.size()) {
+        saida.clear();
+        enviados = 0;
+    }
+
+    atualizaEventos();
+}
+
+/*
+ * Encerra o canal, nenhuma leitura pendente é entregue
+ */
+void Canal::falha(const std::string& motivo)
+{
+    if (!aberto) {
+        return;
+    }
+
+    aberto = false;
+    lendo = false;
+    loop.remove(fd);
+    loop.armaTimer(timer, 0.0);
+
+    if (aoErro) {
+        aoErro(motivo);
+    }
+}
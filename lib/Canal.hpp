@@ -0,0 +1,69 @@
+#ifndef CANAL_HPP
+#define CANAL_HPP
+
+#include "Device.hpp"
+#include "EventLoop.hpp"
+
+#include <fcntl.h>
+
+/*
+ * Transferência não bloqueante sobre o socket de um Device, dentro do laço de eventos. As leituras são encadeadas:
+ * cada recebe aguarda numBytes e entrega eles ao callback, que pode pedir a próxima leitura. Se uma leitura fica
+ * sem bytes novos por prazo segundos o aoPrazo é chamado, e continua sendo a cada prazo até ela andar.
+ * O socket passa a ser não bloqueante, então os métodos bloqueantes do Device não devem mais ser usados com ele.
+ */
+class Canal
+{
+    public:
+        using Recebido = std::function<void(const Raspberry::Byte* dados, uint32_t numBytes)>;
+        using Erro = std::function<void(const std::string& motivo)>;
+        using Mensagem = std::function<void(const Protocolo::Cabecalho& cabecalho, const Raspberry::Byte* corpo, uint32_t tamanho)>;
+
+    private:
+        EventLoop& loop;
+        int fd;
+        int timer;
+        bool aberto = true;
+
+        // Leitura em andamento, o buffer entregue ao callback é outro para ele poder pedir a próxima leitura
+        bool lendo = false;
+        size_t recebidos = 0;
+        std::vector<Raspberry::Byte> entrada;
+        std::vector<Raspberry::Byte> entregue;
+        Recebido recebido;
+
+        // Bytes ainda não transmitidos
+        std::vector<Raspberry::Byte> saida;
+        size_t enviados = 0;
+
+        double prazo = 0.0;
+        EventLoop::Tarefa aoPrazo;
+        Erro aoErro;
+
+        uint32_t eventos = 0;
+
+        void atualizaEventos();
+        void aoEvento(uint32_t ocorridos);
+        void le();
+        void escreve();
+        void falha(const std::string& motivo);
+    public:
+        Canal(EventLoop& loop, Device& device, Erro aoErro);
+        ~Canal();
+
+        Canal(const Canal&) = delete;
+        Canal& operator=(const Canal&) = delete;
+
+        void setPrazo(double segundos, EventLoop::Tarefa aoPrazo);
+
+        void recebe(uint32_t numBytes, Recebido recebido);
+        void recebeVetor(Recebido recebido);
+        void recebeMensagem(Mensagem mensagem);
+
+        void envia(const Raspberry::Byte* dados, uint32_t numBytes);
+        void enviaUInt(uint32_t value);
+
+        bool isAberto() const { return aberto; }
+};
+
+#endif
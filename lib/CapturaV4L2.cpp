@@ -0,0 +1,247 @@
+#include "CapturaV4L2.hpp"
+
+#ifdef RASP
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+/*
+ * Abre o dispositivo (ex: /dev/video0), negocia o formato e a taxa e inicia o streaming com os buffers mapeados.
+ * Com mjpeg o MJPEG é pedido primeiro, e se o driver não o aceitar a captura cai para YUYV
+ */
+CapturaV4L2::CapturaV4L2(const std::string& dispositivo, int largura, int altura, int fps, bool mjpeg)
+{
+    fd = open(dispositivo.c_str(), O_RDWR);
+    if (fd < 0) {
+        throw std::runtime_error("CapturaV4L2: Erro ao abrir " + dispositivo + "! Código de erro: " + std::to_string(errno));
+    }
+
+    try {
+        struct v4l2_capability capacidades;
+        memset(&capacidades, 0, sizeof(capacidades));
+        ioctlOuErro(VIDIOC_QUERYCAP, &capacidades, "consultar o dispositivo");
+
+        uint32_t caps = (capacidades.capabilities & V4L2_CAP_DEVICE_CAPS) ? capacidades.device_caps : capacidades.capabilities;
+        if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+            throw std::runtime_error("CapturaV4L2: " + dispositivo + " não é um dispositivo de captura com streaming!");
+        }
+
+        // O driver devolve o formato que ele de fato usará, que pode não ser o pedido
+        if (mjpeg) {
+            configuraFormato(V4L2_PIX_FMT_MJPEG, largura, altura);
+        }
+        if (formato != V4L2_PIX_FMT_MJPEG) {
+            configuraFormato(V4L2_PIX_FMT_YUYV, largura, altura);
+        }
+        if (formato != V4L2_PIX_FMT_MJPEG && formato != V4L2_PIX_FMT_YUYV) {
+            throw std::runtime_error("CapturaV4L2: " + dispositivo + " não suporta MJPEG nem YUYV!");
+        }
+
+        configuraFps(fps);
+
+        // Buffers do driver, mapeados uma vez e reaproveitados em todos os quadros
+        struct v4l2_requestbuffers requisicao;
+        memset(&requisicao, 0, sizeof(requisicao));
+        requisicao.count = V4L2_NUM_BUFFERS;
+        requisicao.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        requisicao.memory = V4L2_MEMORY_MMAP;
+        ioctlOuErro(VIDIOC_REQBUFS, &requisicao, "alocar os buffers");
+
+        if (requisicao.count < 2) {
+            throw std::runtime_error("CapturaV4L2: Buffers insuficientes em " + dispositivo + "!");
+        }
+
+        for (uint32_t i = 0; i < requisicao.count; i++) {
+            struct v4l2_buffer buffer;
+            memset(&buffer, 0, sizeof(buffer));
+            buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buffer.memory = V4L2_MEMORY_MMAP;
+            buffer.index = i;
+            ioctlOuErro(VIDIOC_QUERYBUF, &buffer, "consultar o buffer");
+
+            void* inicio = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buffer.m.offset);
+            if (inicio == MAP_FAILED) {
+                throw std::runtime_error("CapturaV4L2: Erro ao mapear o buffer! Código de erro: " + std::to_string(errno));
+            }
+            buffers.push_back(Buffer{inicio, buffer.length});
+
+            ioctlOuErro(VIDIOC_QBUF, &buffer, "enfileirar o buffer");
+        }
+
+        int tipo = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        ioctlOuErro(VIDIOC_STREAMON, &tipo, "iniciar o streaming");
+    }
+    catch (...) {
+        for (const auto& buffer : buffers) {
+            munmap(buffer.inicio, buffer.tamanho);
+        }
+        close(fd);
+        throw;
+    }
+}
+
+CapturaV4L2::~CapturaV4L2()
+{
+    int tipo = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    ioctl(fd, VIDIOC_STREAMOFF, &tipo);
+
+    for (const auto& buffer : buffers) {
+        munmap(buffer.inicio, buffer.tamanho);
+    }
+
+    close(fd);
+}
+
+/*
+ * ioctl repetido quando interrompido por um sinal, nos demais erros joga uma exceção
+ */
+void CapturaV4L2::ioctlOuErro(unsigned long requisicao, void* arg, const char* descricao)
+{
+    int r;
+    do {
+        r = ioctl(fd, requisicao, arg);
+    } while (r < 0 && errno == EINTR);
+
+    if (r < 0) {
+        throw std::runtime_error(std::string("CapturaV4L2: Erro ao ") + descricao + "! Código de erro: " + std::to_string(errno));
+    }
+}
+
+void CapturaV4L2::configuraFormato(uint32_t pixelformat, int largura, int altura)
+{
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = largura;
+    fmt.fmt.pix.height = altura;
+    fmt.fmt.pix.pixelformat = pixelformat;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+
+    // Um formato recusado não é erro, o chamador tenta o próximo
+    if (ioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
+        return;
+    }
+
+    formato = fmt.fmt.pix.pixelformat;
+    this->largura = fmt.fmt.pix.width;
+    this->altura = fmt.fmt.pix.height;
+    bytesPorLinha = fmt.fmt.pix.bytesperline;
+}
+
+/*
+ * Pede a taxa de quadros, a obtida fica em fps. Nem todo driver permite escolher a taxa, então a recusa não é erro
+ */
+void CapturaV4L2::configuraFps(int fps)
+{
+    struct v4l2_streamparm parametros;
+    memset(&parametros, 0, sizeof(parametros));
+    parametros.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (fps > 0 && ioctl(fd, VIDIOC_G_PARM, &parametros) == 0 && (parametros.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+        parametros.parm.capture.timeperframe.numerator = 1;
+        parametros.parm.capture.timeperframe.denominator = fps;
+        ioctl(fd, VIDIOC_S_PARM, &parametros);
+    }
+
+    memset(&parametros, 0, sizeof(parametros));
+    parametros.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (ioctl(fd, VIDIOC_G_PARM, &parametros) == 0 && parametros.parm.capture.timeperframe.numerator > 0) {
+        const struct v4l2_fract& periodo = parametros.parm.capture.timeperframe;
+        this->fps = int(double(periodo.denominator) / periodo.numerator + 0.5);
+    }
+}
+
+/*
+ * Devolve à fila do driver o buffer do quadro anterior
+ */
+void CapturaV4L2::devolve()
+{
+    if (emUso) {
+        emUso = false;
+        ioctlOuErro(VIDIOC_QBUF, &atual, "devolver o buffer");
+    }
+}
+
+/*
+ * Aguarda o próximo quadro e retorna os seus bytes, direto do buffer mapeado: o JPEG inteiro no MJPEG ou a imagem YUYV.
+ * Os bytes valem até a próxima chamada, quando o buffer volta para o driver
+ */
+const Raspberry::Byte* CapturaV4L2::proximo(uint32_t& tamanho)
+{
+    devolve();
+
+    memset(&atual, 0, sizeof(atual));
+    atual.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    atual.memory = V4L2_MEMORY_MMAP;
+    ioctlOuErro(VIDIOC_DQBUF, &atual, "receber o quadro");
+    emUso = true;
+
+    tamanho = atual.bytesused;
+    return static_cast<const Raspberry::Byte*>(buffers[atual.index].inicio);
+}
+
+/*
+ * Quadro atual em BGR, para a detecção e o portão de movimento. No MJPEG ele é decodificado, no YUYV somente convertido.
+ * Retorna falso quando o JPEG da câmera não decodifica (quadro truncado ou corrompido), o chamador pula para o próximo
+ * e o buffer volta para o driver no proximo
+ */
+bool CapturaV4L2::getQuadro(Mat_<Raspberry::Cor>& quadro) const
+{
+    if (!emUso) {
+        throw std::runtime_error("CapturaV4L2: Nenhum quadro capturado!");
+    }
+
+    void* dados = buffers[atual.index].inicio;
+
+    if (isMjpeg()) {
+        if (atual.bytesused == 0) {
+            return false;
+        }
+
+        quadro = imdecode(Mat(1, atual.bytesused, CV_8UC1, dados), IMREAD_COLOR);
+        return !quadro.empty();
+    }
+
+    cvtColor(Mat(altura, largura, CV_8UC2, dados, bytesPorLinha), quadro, COLOR_YUV2BGR_YUYV);
+    return true;
+}
+
+/*
+ * Quadros já capturados esperando na fila do driver, com a fila cheia a câmera começa a descartar quadros
+ */
+uint32_t CapturaV4L2::getProntos() const
+{
+    uint32_t prontos = 0;
+
+    for (uint32_t i = 0; i < buffers.size(); i++) {
+        struct v4l2_buffer buffer;
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = i;
+
+        if (ioctl(fd, VIDIOC_QUERYBUF, &buffer) == 0 && (buffer.flags & V4L2_BUF_FLAG_DONE)) {
+            prontos++;
+        }
+    }
+
+    return prontos;
+}
+
+/*
+ * Formato negociado, ex: "MJPG 320x240 a 30 fps"
+ */
+std::string CapturaV4L2::getFormato() const
+{
+    std::string fourcc;
+    for (auto i = 0; i < 4; i++) {
+        fourcc += char((formato >> 8*i) & 0xff);
+    }
+
+    return fourcc + " " + std::to_string(largura) + "x" + std::to_string(altura) + (fps > 0 ? " a " + std::to_string(fps) + " fps" : "");
+}
+#endif // RASP
@@ -0,0 +1,62 @@
+#ifndef CAPTURA_V4L2_HPP
+#define CAPTURA_V4L2_HPP
+
+#include "Raspberry.hpp"
+
+#ifdef RASP
+#include <linux/videodev2.h>
+
+#define V4L2_NUM_BUFFERS    4   // Buffers mapeados na fila do driver, com menos a câmera descarta quadros enquanto a Pi processa
+
+/*
+ * Captura direto do V4L2, com os buffers do driver mapeados na memória (mmap). Quando a câmera entrega MJPEG o quadro
+ * é transmitido como veio, sem a decodificação e a recompressão do VideoCapture. Sem MJPEG a captura cai para YUYV,
+ * convertido para BGR somente quando necessário.
+ * Testável sem câmera: o vivid (modprobe vivid) entrega YUYV, e o v4l2loopback alimentado pelo ffmpeg com -c:v mjpeg
+ * entrega MJPEG.
+ */
+class CapturaV4L2
+{
+    private:
+        typedef struct
+        {
+            void* inicio;
+            size_t tamanho;
+        } Buffer;
+
+        int fd = -1;
+        std::vector<Buffer> buffers;
+        uint32_t formato = 0;
+        int largura = 0;
+        int altura = 0;
+        int bytesPorLinha = 0;
+        int fps = 0;
+
+        // Buffer com o último quadro, fica com a Pi até o próximo e depois volta à fila do driver
+        struct v4l2_buffer atual;
+        bool emUso = false;
+
+        void ioctlOuErro(unsigned long requisicao, void* arg, const char* descricao);
+        void configuraFormato(uint32_t pixelformat, int largura, int altura);
+        void configuraFps(int fps);
+        void devolve();
+    public:
+        CapturaV4L2(const std::string& dispositivo, int largura, int altura, int fps, bool mjpeg = true);
+        ~CapturaV4L2();
+
+        CapturaV4L2(const CapturaV4L2&) = delete;
+        CapturaV4L2& operator=(const CapturaV4L2&) = delete;
+
+        const Raspberry::Byte* proximo(uint32_t& tamanho);
+        bool getQuadro(Mat_<Raspberry::Cor>& quadro) const;
+        uint32_t getProntos() const;
+
+        bool isMjpeg() const { return formato == V4L2_PIX_FMT_MJPEG; }
+        int getLargura() const { return largura; }
+        int getAltura() const { return altura; }
+        int getFps() const { return fps; }
+        std::string getFormato() const;
+};
+
+#endif // RASP
+#endif
@@ -1,16 +1,11 @@
 #include "Client.hpp"
 
 /*
- * Construi um client TCP-IP IPv4, caso não seja possivel joga uma excessão
+ * Construi um client TCP-IP IPv4, caso não seja possivel joga uma excessão. O endereço é resolvido uma única vez,
+ * e as reconexões não dependem do DNS
  */
 Client::Client(const char* serverName, const char* port)
 {
-    // Obtem um socket
-    transferSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (transferSocket == SOCKET_ERROR) {
-        throw std::runtime_error("Client: Erro ao obter o socket! Código de erro: " + std::to_string(errno));       
-    }
-
     // Obtem o endereço do server
     struct hostent *server = gethostbyname(serverName);
     if (server == NULL) {
@@ -32,14 +27,56 @@ Client::~Client()
 }
 
 /*
- * Espera até conectar-se ao servidor correspondete ao endereço e porta passados no construtor, caso não seja possivel, joga um excessão
+ * Espera até conectar-se ao servidor correspondete ao endereço e porta passados no construtor, caso não seja possivel, joga um excessão.
+ * Cada chamada usa um socket novo, a conexão anterior é fechada, então ela serve também para reconectar
  */
 void Client::waitConnection()
 {
-    // Conecta ao servidor
+    if (transferSocket != SOCKET_ERROR) {
+        close(transferSocket);
+    }
+    conectado = false;
+
+    // Obtem um socket
+    transferSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (transferSocket == SOCKET_ERROR) {
+        throw std::runtime_error("Client: Erro ao obter o socket! Código de erro: " + std::to_string(errno));       
+    }
+
+    // Conecta ao servidor sem bloquear, com a espera limitada a CLIENT_PRAZO_CONEXAO
+    int flags = fcntl(transferSocket, F_GETFL);
+    fcntl(transferSocket, F_SETFL, flags | O_NONBLOCK);
+
     if (connect(transferSocket, (struct sockaddr *)&transferAddr, sizeof(transferAddr)) < 0) {
-        throw std::runtime_error("Client: Erro ao conectar-se ao servidor! Código de erro: " + std::to_string(errno));
+        if (errno != EINPROGRESS) {
+            throw std::runtime_error("Client: Erro ao conectar-se ao servidor! Código de erro: " + std::to_string(errno));
+        }
+
+        struct pollfd fd = {transferSocket, POLLOUT, 0};
+        int prontos;
+        do {
+            prontos = poll(&fd, 1, CLIENT_PRAZO_CONEXAO*1000);
+        } while (prontos < 0 && errno == EINTR);
+
+        if (prontos == 0) {
+            throw std::runtime_error("Client: Timeout para conectar-se ao servidor!");
+        }
+
+        int erro = 0;
+        socklen_t tamanho = sizeof(erro);
+        if (prontos < 0 || getsockopt(transferSocket, SOL_SOCKET, SO_ERROR, &erro, &tamanho) < 0 || erro != 0) {
+            throw std::runtime_error("Client: Erro ao conectar-se ao servidor! Código de erro: " + std::to_string(erro != 0 ? erro : errno));
+        }
     }
+
+    fcntl(transferSocket, F_SETFL, flags);
+
+    struct timeval tv;
+    tv.tv_sec = CLIENT_PRAZO_RECEPCAO;
+    tv.tv_usec = 0;
+    setsockopt(transferSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
+
+    conectado = true;
 }
 
 /*
@@ -54,6 +91,10 @@ void Client::sendBytes(uint32_t numBytes, const Raspberry::Byte* txBuffer)
 
         // Verifica se não ouve algum erro na transmissão
         if (numSend == SOCKET_ERROR) {
+            if (errno == EINTR) {
+                continue;
+            }
+            conectado = false;
             throw std::runtime_error("Client: Erro ao transmitir os dados! Código de erro: " + std::to_string(errno));                  
         }
 
@@ -62,7 +103,7 @@ void Client::sendBytes(uint32_t numBytes, const Raspberry::Byte* txBuffer)
 }
 
 /*
- * Recebe um buffer de bytes, caso não seja possivel, joga um excessão
+ * Recebe um buffer de bytes, caso não seja possivel ou a conexão feche antes de recebe-lo por completo, joga um excessão
  */
 void Client::receiveBytes(uint32_t numBytes, Raspberry::Byte* rxBuffer)
 {
@@ -71,11 +112,19 @@ void Client::receiveBytes(uint32_t numBytes, Raspberry::Byte* rxBuffer)
         size_t chunk_size = std::min(CHUNK_SIZE, numBytes - totalRecv);
         ssize_t numRecv = read(transferSocket, &rxBuffer[totalRecv], chunk_size);
 
-        if (numRecv == 0 && numBytes > 0) {
-            Raspberry::print("Client: Timeout para receber.");
-            break;
+        // Um buffer parcial não pode seguir adiante, ex: para o imdecode
+        if (numRecv == 0) {
+            conectado = false;
+            throw std::runtime_error("Client: Conexão fechada pelo servidor com " + std::to_string(totalRecv) + " de " + std::to_string(numBytes) + " bytes recebidos!");
         }
         else if (numRecv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            conectado = false;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                throw std::runtime_error("Client: Timeout para receber!");
+            }
             throw std::runtime_error("Client: Erro ao receber os dados! Código de erro: " + std::to_string(errno));
         }  
 
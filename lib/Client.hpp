@@ -3,6 +3,12 @@
 
 #include "Device.hpp"
 
+#include <poll.h>
+#include <fcntl.h>
+
+#define CLIENT_PRAZO_CONEXAO    2       // [s] Espera máxima pelo connect, sem ele um host inalcançável segura por minutos
+#define CLIENT_PRAZO_RECEPCAO   5       // [s] Espera máxima por bytes nas recepções bloqueantes
+
 class Client : public Device
 {
     public:
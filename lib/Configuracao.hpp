@@ -0,0 +1,61 @@
+// Configuracao.hpp
+#ifndef CONFIGURACAO_HPP
+#define CONFIGURACAO_HPP
+
+/*
+ *  Parâmetros da detecção e do controle, comuns aos programas da Base e à detecção feita na Pi.
+ *  Todos podem ser trocados na compilação (-DNUM_ESCALAS=24, ou a opção CONFIGURACAO do CMake), as escalas
+ *  e os kernels da correlação especializados para os tamanhos do modelo são gerados a partir deles.
+ */
+
+/* -------- Defines -------- */
+#ifndef TEMPLATE_SIZE
+#define TEMPLATE_SIZE   401
+#endif
+#ifndef NUM_SIZE
+#define NUM_SIZE        150
+#endif
+
+#ifndef NUM_ESCALAS
+#define NUM_ESCALAS     32      // Em progressão geométrica de ESCALA_MIN até ESCALA_MAX
+#endif
+#ifndef ESCALA_MAX
+#define ESCALA_MAX      0.4f 
+#endif
+#ifndef ESCALA_MIN
+#define ESCALA_MIN      0.03f
+#endif
+#ifndef THRESHOLD
+#define THRESHOLD       0.6f
+#endif
+
+#ifndef BUSCA_CONFIANCA
+#define BUSCA_CONFIANCA 0.9f    // Busca adaptativa: correlação que encerra a busca
+#endif
+#ifndef BUSCA_MARGEM
+#define BUSCA_MARGEM    0.15f   // Quanto a correlação completa pode superar a grossa
+#endif
+
+#ifndef ESCALA_DIST_MIN
+#define ESCALA_DIST_MIN 0.085f
+#endif
+
+#ifndef ADAPTA_TAXA
+#define ADAPTA_TAXA     0.1f    // Modelo adaptativo: peso do recorte da detecção na mistura
+#endif
+#ifndef ADAPTA_PERDA_MAX
+#define ADAPTA_PERDA_MAX 30     // Quadros sem o alvo até voltar ao modelo original
+#endif
+
+#ifndef MOVIMENTO_LIMIAR
+#define MOVIMENTO_LIMIAR 4.0    // Portão de movimento: diferença média de um bloco, em níveis de cinza, que conta como mudança
+#endif
+#ifndef MOVIMENTO_REUTILIZADOS_MAX
+#define MOVIMENTO_REUTILIZADOS_MAX 15   // Quadros seguidos que reutilizam o resultado anterior
+#endif
+
+#ifndef PREVIEW_PERIODO
+#define PREVIEW_PERIODO 30      // Detecção na Pi: quadros entre dois previews enviados à Base
+#endif
+
+#endif  // CONFIGURACAO_HPP
@@ -0,0 +1,206 @@
+#include "ControleAutomatico.hpp"
+
+#ifdef BASE
+namespace ControleAutomatico
+{
+    double Pid::atualiza(double erro, double dt)
+    {
+        double derivada = 0.0;
+
+        if (!primeiro && dt > 0.0) {
+            integral = std::clamp(integral + erro*dt, -1.0, 1.0);
+            derivada = (erro - erroAnterior)/dt;
+        }
+
+        erroAnterior = erro;
+        primeiro = false;
+        return kp*erro + ki*integral + kd*derivada;
+    }
+
+    void Pid::reinicia()
+    {
+        integral = 0.0;
+        erroAnterior = 0.0;
+        primeiro = true;
+    }
+
+    /*
+     * Converte a velocidade normalizada [-1, 1] de um motor nos PWMs dos seus dois canais (frente, trás)
+     */
+    void velocidadeParaPWM(double velocidade, int velocidadeMax, int& pwmFrente, int& pwmTras)
+    {
+        int pwm = 0;
+        if (std::abs(velocidade) > 0.05) {
+            pwm = PWM_MIN_MOVIMENTO + (velocidadeMax - PWM_MIN_MOVIMENTO)*std::min(std::abs(velocidade), 1.0);
+        }
+
+        pwmFrente = velocidade > 0.0 ? pwm : 0;
+        pwmTras = velocidade < 0.0 ? pwm : 0;
+    }
+
+    void ControleProporcional::reinicia()
+    {
+        pidGiro.reinicia();
+        pidAvanco.reinicia();
+        instanteAnterior = -1.0;
+    }
+
+    /*
+     * Retorna os PWMs (M1_A, M1_B, M2_A, M2_B) para o alvo encontrado em um quadro de largura passada
+     */
+    void ControleProporcional::atualiza(const Raspberry::FindPos& alvo, int largura, int velocidadesPWM[])
+    {
+        double agora = relogio();
+        double dt = instanteAnterior < 0.0 ? 0.0 : agora - instanteAnterior;
+        instanteAnterior = agora;
+
+        // Erros normalizados: positivo quando o alvo está à direita e quando ainda está longe
+        double meio = 0.5*largura;
+        double erroHorizontal = (alvo.ponto.posicao.x - meio)/meio;
+        double erroEscala = (escalaAlvo - alvo.escala)/escalaAlvo;
+
+        double giro = std::clamp(pidGiro.atualiza(erroHorizontal, dt), -1.0, 1.0);
+        double avanco = std::clamp(pidAvanco.atualiza(erroEscala, dt), 0.0, 1.0);
+
+        // O motor 2 é o da esquerda e o motor 1 o da direita
+        double esquerda = avanco + giro;
+        double direita = avanco - giro;
+        double maior = std::max(std::abs(esquerda), std::abs(direita));
+        if (maior > 1.0) {
+            esquerda /= maior;
+            direita /= maior;
+        }
+
+        velocidadeParaPWM(direita, VEL_MAX_M1, velocidadesPWM[1], velocidadesPWM[0]);
+        velocidadeParaPWM(esquerda, VEL_MAX_M2, velocidadesPWM[3], velocidadesPWM[2]);
+    }
+
+    /*
+     * Volta para a busca, descartando as temporizações em andamento
+     */
+    void Controlador::reinicia()
+    {
+        estado = Estados::BUSCA;
+        inicioDelayFoca = true;
+        inicioDelayFinaliza = true;
+        proporcional.reinicia();
+    }
+
+    /*
+     * Máquina de estado do controle automático, retorna o comando para o quadro atual
+     */
+    Raspberry::Comando Controlador::atualiza(bool enquadrado, int numPredito) 
+    {
+        switch (estado) {
+            case Estados::BUSCA:
+            case Estados::APROXIMA: {
+                comando = Raspberry::Comando::FRENTE;
+                estado = Estados::BUSCA;
+
+                if (enquadrado) {
+                    estado = Estados::FOCA;
+                }
+                break;
+            }
+
+            case Estados::FOCA: {
+                if (inicioDelayFoca) {
+                    timer = relogio();
+                    inicioDelayFoca = false;
+                }
+
+                comando = Raspberry::Comando::PARADO;
+
+                double tempoDecorrido = relogio() - timer;
+                if (tempoDecorrido > 2.0) {
+                    estado = Estados::IDENTIFICA;
+                    inicioDelayFoca = true;
+                }
+                break;
+            }
+
+            case Estados::IDENTIFICA: {
+                if (verboso) {
+                    std::cout << numPredito << std::endl;
+                }
+
+                switch (numPredito) {
+                    case 2:
+                        comando = Raspberry::Comando::AUTO_180_ESQUERDA;
+                        break;
+                    case 3:
+                        comando = Raspberry::Comando::AUTO_180_DIREITA;
+                        break;
+                    case 4:
+                    case 5:
+                        comando = Raspberry::Comando::AUTO_FRENTE;
+                        break;
+                    case 6:
+                    case 7:
+                        comando = Raspberry::Comando::AUTO_90_ESQUERDA;
+                        break;
+                    case 8:
+                    case 9:
+                        comando = Raspberry::Comando::AUTO_90_DIREITA;
+                        break;
+                    case 0:
+                    case 1:
+                    default:
+                        comando = Raspberry::Comando::AUTO_PARADO;
+                        break;
+                }
+
+                timer = relogio();
+                estado = Estados::FINALIZA;
+                break;
+            }
+
+            case Estados::FINALIZA: {
+                if (inicioDelayFinaliza) {
+                    timer = relogio();
+                    inicioDelayFinaliza = false;
+                }
+
+                comando = Raspberry::Comando::PARADO;
+                double tempoDecorrido = relogio() - timer;
+
+                if (tempoDecorrido > 2.0) {
+                    estado = Estados::BUSCA;
+                    inicioDelayFinaliza = true;
+                }
+                break;
+            }
+
+            default: {
+                comando = Raspberry::Comando::PARADO;               
+                estado = Estados::BUSCA;
+                break;
+            }
+        }
+
+        return comando;
+    }
+
+    /*
+     * Máquina de estado com aproximação contínua, enquanto o alvo é visto mas ainda não está enquadrado
+     * as rodas são comandadas pelo controle proporcional (AUTO_VELOCIDADE)
+     */
+    Raspberry::Comando Controlador::atualizaContinuo(const Raspberry::FindPos* alvo, int largura, bool enquadrado, int numPredito, int velocidadesPWM[])
+    {
+        bool aproximando = estado == Estados::BUSCA || estado == Estados::APROXIMA;
+
+        if (aproximando && alvo != nullptr && !enquadrado) {
+            if (estado == Estados::BUSCA) {
+                proporcional.reinicia();
+            }
+
+            estado = Estados::APROXIMA;
+            comando = Raspberry::Comando::AUTO_VELOCIDADE;
+            proporcional.atualiza(*alvo, largura, velocidadesPWM);
+            return comando;
+        }
+
+        return atualiza(enquadrado, numPredito);
+    }
+} // namespace ControleAutomatico
+#endif // BASE
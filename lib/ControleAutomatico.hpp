@@ -0,0 +1,95 @@
+#ifndef CONTROLE_AUTOMATICO_HPP
+#define CONTROLE_AUTOMATICO_HPP
+
+#include "Raspberry.hpp"
+
+#ifdef BASE
+#include <functional>
+
+/*
+ * Controle automático do robô: máquina de estados da busca e identificação do alvo e a aproximação contínua por PID
+ */
+namespace ControleAutomatico
+{
+    typedef enum 
+    {
+        BUSCA = 0,
+        FOCA,
+        IDENTIFICA,
+        FINALIZA,
+        APROXIMA,
+    } Estados;
+
+    /*
+     * Controlador PID de uma variável, com a integral saturada para evitar windup
+     */
+    class Pid
+    {
+        private:
+            double kp, ki, kd;
+            double integral = 0.0;
+            double erroAnterior = 0.0;
+            bool primeiro = true;
+        public:
+            Pid(double kp, double ki, double kd) : kp(kp), ki(ki), kd(kd) {}
+
+            double atualiza(double erro, double dt);
+            void reinicia();
+    };
+
+    void velocidadeParaPWM(double velocidade, int velocidadeMax, int& pwmFrente, int& pwmTras);
+
+    // Fonte do tempo [s], injetável para simular ou reproduzir o controle fora do tempo real
+    using Relogio = std::function<double()>;
+
+    /*
+     * Controle contínuo da aproximação, PID no deslocamento horizontal (giro) e na escala aparente (avanço) do alvo,
+     * gera as velocidades diferenciais das rodas
+     */
+    class ControleProporcional
+    {
+        private:
+            Pid pidGiro{0.6, 0.05, 0.08};
+            Pid pidAvanco{1.5, 0.1, 0.0};
+            double escalaAlvo;
+            Relogio relogio;
+            double instanteAnterior = -1.0;
+        public:
+            ControleProporcional(double escalaAlvo, Relogio relogio = Raspberry::timeSinceEpoch) : escalaAlvo(escalaAlvo), relogio(relogio) {}
+
+            void reinicia();
+            void atualiza(const Raspberry::FindPos& alvo, int largura, int velocidadesPWM[]);
+    };
+
+    /*
+     * Controle automático de um robô, cada instância tem a sua máquina de estados, temporizações e controle proporcional.
+     * Todo o tempo vem do relógio injetado, então vários robôs podem ser controlados, ou simulados, no mesmo processo.
+     */
+    class Controlador
+    {
+        private:
+            Relogio relogio;
+            ControleProporcional proporcional;
+            bool verboso;
+
+            Estados estado = Estados::BUSCA;
+            Raspberry::Comando comando = Raspberry::Comando::NAO_SELECIONADO;
+            double timer;
+            bool inicioDelayFoca = true;
+            bool inicioDelayFinaliza = true;
+        public:
+            Controlador(double escalaAlvo, Relogio relogio = Raspberry::timeSinceEpoch, bool verboso = true) 
+                : relogio(relogio), proporcional(escalaAlvo, relogio), verboso(verboso), timer(this->relogio()) {}
+
+            void reinicia();
+
+            Estados getEstado() const { return estado; }
+            Raspberry::Comando getComando() const { return comando; }
+
+            Raspberry::Comando atualiza(bool enquadrado, int numPredito);
+            Raspberry::Comando atualizaContinuo(const Raspberry::FindPos* alvo, int largura, bool enquadrado, int numPredito, int velocidadesPWM[]);
+    };
+} // namespace ControleAutomatico
+#endif // BASE
+
+#endif
@@ -0,0 +1,65 @@
+#include "DetectorMovimento.hpp"
+
+/*
+ * limiar: diferença média de um bloco, em níveis de cinza, a partir da qual a cena mudou
+ */
+DetectorMovimento::DetectorMovimento(double limiar, int reutilizadosMax)
+    : limiar(limiar), reutilizadosMax(reutilizadosMax)
+{
+}
+
+/*
+ * Retorna se o quadro mudou em relação ao último processado. Quando não muda, o resultado anterior pode ser reutilizado
+ */
+bool DetectorMovimento::mudou(const Mat_<Raspberry::Cor>& quadro)
+{
+    quadros++;
+
+    // Reduz antes de converter para cinza, a conversão fica 16x mais barata
+    Mat_<Raspberry::Cor> reduzidoCor;
+    Mat_<Raspberry::Gry> reduzido;
+    resize(quadro, reduzidoCor, Size(std::max(1, quadro.cols/MOVIMENTO_REDUCAO), std::max(1, quadro.rows/MOVIMENTO_REDUCAO)), 0, 0, INTER_AREA);
+    cvtColor(reduzidoCor, reduzido, COLOR_BGR2GRAY);
+
+    bool mudanca = true;
+
+    if (!referencia.empty() && referencia.size() == reduzido.size() && seguidos < reutilizadosMax) {
+        Mat_<Raspberry::Gry> diferenca, blocos;
+        absdiff(reduzido, referencia, diferenca);
+
+        // Média da diferença em cada bloco
+        resize(diferenca, blocos, Size(std::max(1, diferenca.cols/MOVIMENTO_BLOCO), std::max(1, diferenca.rows/MOVIMENTO_BLOCO)), 0, 0, INTER_AREA);
+
+        double maior;
+        minMaxLoc(blocos, NULL, &maior);
+        mudanca = maior > limiar;
+    }
+
+    if (mudanca) {
+        referencia = reduzido;
+        seguidos = 0;
+    }
+    else {
+        seguidos++;
+        reutilizados++;
+    }
+
+    return mudanca;
+}
+
+/*
+ * Descarta a referência, o próximo quadro é dado como mudado
+ */
+void DetectorMovimento::reinicia()
+{
+    referencia.release();
+    seguidos = 0;
+}
+
+std::string DetectorMovimento::getEstatisticas() const
+{
+    std::ostringstream os;
+    os << "Quadros reutilizados sem mudança na cena: " << reutilizados << " de " << quadros
+       << " (" << (quadros > 0 ? 100.0*reutilizados/quadros : 0.0) << " %)";
+    return os.str();
+}
@@ -0,0 +1,39 @@
+#ifndef DETECTOR_MOVIMENTO_HPP
+#define DETECTOR_MOVIMENTO_HPP
+
+#include "Raspberry.hpp"
+
+/* -------- Defines -------- */
+#define MOVIMENTO_REDUCAO   4   // O quadro é comparado reduzido 4x em cada eixo (80x60)
+#define MOVIMENTO_BLOCO     8   // [pixels do quadro reduzido] Lado dos blocos em que a diferença é média
+
+/*
+ * Detector de mudança da cena por diferença de quadros, barato o bastante para rodar na Pi ou logo após a decodificação
+ * na Base. O quadro reduzido em cinza é comparado com a referência, o último quadro que mudou, pela diferença absoluta
+ * média em blocos. Basta um bloco acima do limiar para o quadro contar como mudado, assim um alvo pequeno se movendo
+ * não se perde na média do quadro inteiro. Como a referência só é trocada quando muda, uma deriva lenta também acaba
+ * detectada, e após reutilizadosMax quadros seguidos sem mudança um quadro é dado como mudado de qualquer forma.
+ */
+class DetectorMovimento
+{
+    private:
+        double limiar;
+        int reutilizadosMax;
+
+        Mat_<Raspberry::Gry> referencia;
+        int seguidos = 0;
+
+        uint64_t quadros = 0;
+        uint64_t reutilizados = 0;
+    public:
+        DetectorMovimento(double limiar, int reutilizadosMax);
+
+        bool mudou(const Mat_<Raspberry::Cor>& quadro);
+        void reinicia();
+
+        uint64_t getQuadros() const { return quadros; }
+        uint64_t getReutilizados() const { return reutilizados; }
+        std::string getEstatisticas() const;
+};
+
+#endif
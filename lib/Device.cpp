@@ -1,12 +1,17 @@
 #include "Device.hpp"
 
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+
 /*
  * Envia um número inteiro sem sinal de 32 bits (4 bytes) na forma Big-Endian
  */
 void Device::sendUInt(const uint32_t value)
 {
-    uint32_t net_value = htonl(value);
-    this->sendBytes(sizeof(uint32_t), (const Raspberry::Byte*) &net_value);
+    Raspberry::Byte buf[sizeof(uint32_t)];
+    Raspberry::Byte* p = buf;
+    Protocolo::escreve32(p, value);
+    this->sendBytes(sizeof(uint32_t), buf);
 }
 
 /*
@@ -14,21 +19,29 @@ void Device::sendUInt(const uint32_t value)
  */
 void Device::receiveUInt(uint32_t& value)
 {
-    uint32_t net_value;
-    this->receiveBytes(sizeof(uint32_t), (Raspberry::Byte*) &net_value);
-    value = ntohl(net_value);
+    Raspberry::Byte buf[sizeof(uint32_t)];
+    const Raspberry::Byte* p = buf;
+    this->receiveBytes(sizeof(uint32_t), buf);
+    value = Protocolo::le32(p);
 }
 
 /*
  * Transmite um vector de bytes
  */
 void Device::sendVectorByte(const std::vector<Raspberry::Byte>& vec)
+{
+    this->sendVectorByte(vec.data(), vec.size());
+}
+
+/*
+ * Transmite numBytes bytes no mesmo formato do vector, ex: o JPEG direto do buffer da câmera
+ */
+void Device::sendVectorByte(const Raspberry::Byte* dados, uint32_t numBytes)
 {
     // Primeiro transmite o tamanho do vector
-    uint32_t vecSize = vec.size(); 
-    this->sendUInt(vecSize);
-    
-    this->sendBytes(vecSize, vec.data());
+    this->sendUInt(numBytes);
+
+    this->sendBytes(numBytes, dados);
 }
 
 /*
@@ -84,7 +97,8 @@ void Device::receiveImage(Mat_<Raspberry::Cor>& image)
  */
 void Device::sendImageCompactada(const Mat_<Raspberry::Cor>& image)
 {
-    // Comprime a imagem
+    // Comprime a imagem, com um reinício por linha de MCUs para a Base decodificar em fatias paralelas
+    compressaoParam[3] = JpegParalelo::getIntervaloReinicio(image.cols);
     imencode(".jpeg", image, imgBuf, compressaoParam);
 
     // Transfere o buffer
@@ -98,7 +112,279 @@ void Device::receiveImageCompactada(Mat_<Raspberry::Cor>& image)
 {
     // Recebe a imagem
     this->receiveVectorByte(imgBuf);
-    image = imdecode(imgBuf, 1);
+    decodificador.decodifica(imgBuf, image);
+}
+
+/*
+ * Transmite as partes em sequência com um único writev, sem juntá-las antes em um buffer. Envios parciais continuam
+ * de onde pararam
+ */
+void Device::sendPartes(struct iovec* partes, int numPartes)
+{
+    while (numPartes > 0) {
+        ssize_t numSend = writev(transferSocket, partes, numPartes);
+
+        if (numSend == SOCKET_ERROR) {
+            if (errno == EINTR) {
+                continue;
+            }
+            conectado = false;
+            throw std::runtime_error("Device: Erro ao transmitir os dados! Código de erro: " + std::to_string(errno));
+        }
+
+        // Descarta as partes já transmitidas e avança dentro da parcial
+        size_t enviados = numSend;
+        while (numPartes > 0 && enviados >= partes->iov_len) {
+            enviados -= partes->iov_len;
+            partes++;
+            numPartes--;
+        }
+
+        if (numPartes > 0) {
+            partes->iov_base = (Raspberry::Byte*) partes->iov_base + enviados;
+            partes->iov_len -= enviados;
+        }
+    }
+}
+
+/*
+ * Envia uma mensagem do Protocolo com o corpo formado pelos dados seguidos do extra, ambos transmitidos direto dos
+ * buffers do chamador
+ */
+void Device::sendMensagem(Protocolo::Tipo tipo, const Raspberry::Byte* dados, uint32_t numBytes, const Raspberry::Byte* extra, uint32_t numExtra)
+{
+    Protocolo::escreveCabecalho(cabecalho, tipo, numBytes + numExtra);
+
+    struct iovec partes[3] = {
+        {cabecalho, PROTOCOLO_CABECALHO},
+        {const_cast<Raspberry::Byte*>(dados), numBytes},
+        {const_cast<Raspberry::Byte*>(extra), numExtra},
+    };
+    this->sendPartes(partes, numExtra > 0 ? 3 : 2);
+}
+
+/*
+ * Recebe a próxima mensagem, com o corpo em corpo - Aguarda até o recebimento ou timeout do servidor
+ */
+Protocolo::Cabecalho Device::receiveMensagem(std::vector<Raspberry::Byte>& corpo)
+{
+    this->receiveBytes(PROTOCOLO_CABECALHO, cabecalho);
+    Protocolo::Cabecalho recebido = Protocolo::leCabecalho(cabecalho);
+
+    // Com outra versão, ou o fluxo fora de sincronia, a conexão não tem mais uso
+    try {
+        Protocolo::verifica(recebido);
+    }
+    catch (const std::exception&) {
+        conectado = false;
+        throw;
+    }
+
+    corpo.resize(recebido.tamanho);
+    this->receiveBytes(recebido.tamanho, corpo.data());
+
+    return recebido;
+}
+
+/*
+ * Envia um quadro já compactado em JPEG, ex: direto do buffer da câmera
+ */
+void Device::sendQuadro(const Protocolo::Quadro& quadro, const Raspberry::Byte* jpeg, uint32_t numBytes)
+{
+    Raspberry::Byte identificacao[PROTOCOLO_QUADRO];
+    Protocolo::escreveQuadro(identificacao, quadro);
+
+    this->sendMensagem(Protocolo::QUADRO, identificacao, sizeof(identificacao), jpeg, numBytes);
+}
+
+/*
+ * Envia um quadro compactado em jpeg, com o fator e os reinícios do sendImageCompactada
+ */
+void Device::sendQuadro(const Protocolo::Quadro& quadro, const Mat_<Raspberry::Cor>& image)
+{
+    compressaoParam[3] = JpegParalelo::getIntervaloReinicio(image.cols);
+    imencode(".jpeg", image, imgBuf, compressaoParam);
+
+    this->sendQuadro(quadro, imgBuf.data(), imgBuf.size());
+}
+
+/*
+ * Envia um lote de amostras de telemetria, já codificado pela Telemetria
+ */
+void Device::sendTelemetria(const std::vector<Raspberry::Byte>& lote)
+{
+    this->sendMensagem(Protocolo::TELEMETRIA, lote.data(), lote.size());
+}
+
+/*
+ * Abre ou retoma a sessão, enviado pela Base logo após conectar e respondido pela Pi
+ */
+void Device::sendSessao(const Protocolo::Sessao& sessao)
+{
+    Raspberry::Byte corpo[PROTOCOLO_SESSAO];
+    Protocolo::escreveSessao(corpo, sessao);
+
+    this->sendMensagem(Protocolo::SESSAO, corpo, sizeof(corpo));
+}
+
+void Device::receiveSessao(Protocolo::Sessao& sessao)
+{
+    Protocolo::Cabecalho recebido;
+    do {
+        recebido = this->receiveMensagem(msgBuf);
+    } while (recebido.tipo != Protocolo::SESSAO);
+
+    sessao = Protocolo::leSessao(msgBuf.data(), msgBuf.size());
+}
+
+/*
+ * Recebe o próximo comando, as mensagens de outros tipos são puladas
+ */
+void Device::receiveComando(Protocolo::Comando& comando)
+{
+    Protocolo::Cabecalho recebido;
+    do {
+        recebido = this->receiveMensagem(msgBuf);
+    } while (recebido.tipo != Protocolo::COMANDO);
+
+    comando = Protocolo::leComando(msgBuf.data(), msgBuf.size());
+}
+
+/*
+ * Bytes na fila de transmissão do socket, ainda não confirmados pelo outro lado
+ */
+uint32_t Device::getFilaEnvio() const
+{
+    int fila = 0;
+    if (transferSocket == SOCKET_ERROR || ioctl(transferSocket, SIOCOUTQ, &fila) < 0) {
+        return 0;
+    }
+    return fila;
+}
+
+/*
+ * Envia as detecções de um quadro feitas na Pi em uma mensagem DETECCOES, seguidas do preview compactado ou de tamanho
+ * zero quando ele estiver vazio. Cada detecção tem a posição, a escala, a correlação e o recorte MNIST_SIZE x MNIST_SIZE
+ * do número
+ */
+void Device::sendDeteccoes(const Protocolo::Quadro& quadro, const std::vector<Raspberry::Deteccao>& deteccoes, const Mat_<Raspberry::Cor>& preview)
+{
+    imgBuf.clear();
+    if (!preview.empty()) {
+        compressaoParam[3] = JpegParalelo::getIntervaloReinicio(preview.cols);
+        imencode(".jpeg", preview, imgBuf, compressaoParam);
+    }
+
+    detBuf.resize(PROTOCOLO_QUADRO + 2*sizeof(uint32_t) + deteccoes.size()*DETECCAO_BYTES);
+    Raspberry::Byte* buf = detBuf.data();
+
+    Protocolo::escreveQuadro(buf, quadro);
+    buf += PROTOCOLO_QUADRO;
+
+    if (deteccoes.size() > DETECCOES_MAX) {
+        throw std::runtime_error("Device: Erro " + std::to_string(deteccoes.size()) + " detecções em um quadro!");
+    }
+
+    Protocolo::escreve32(buf, deteccoes.size());
+    for (const auto& deteccao : deteccoes) {
+        if (deteccao.recorte.rows != MNIST_SIZE || deteccao.recorte.cols != MNIST_SIZE || !deteccao.recorte.isContinuous()) {
+            throw std::runtime_error("Device: Erro o recorte da detecção não está no formato MNIST!");
+        }
+
+        uint32_t escala, correlacao;
+        float correlacaoFlt = deteccao.alvo.ponto.correlacao;
+        memcpy(&escala, &deteccao.alvo.escala, sizeof(uint32_t));
+        memcpy(&correlacao, &correlacaoFlt, sizeof(uint32_t));
+
+        Protocolo::escreve32(buf, deteccao.alvo.ponto.posicao.x);
+        Protocolo::escreve32(buf, deteccao.alvo.ponto.posicao.y);
+        Protocolo::escreve32(buf, escala);
+        Protocolo::escreve32(buf, correlacao);
+
+        memcpy(buf, deteccao.recorte.data, MNIST_SIZE*MNIST_SIZE);
+        buf += MNIST_SIZE*MNIST_SIZE;
+    }
+    Protocolo::escreve32(buf, imgBuf.size());
+
+    // As detecções e o preview saem do seu próprio buffer, em um único envio
+    this->sendMensagem(Protocolo::DETECCOES, detBuf.data(), detBuf.size(), imgBuf.data(), imgBuf.size());
+}
+
+/*
+ * Recebe as detecções de um quadro, pulando as mensagens de outros tipos. Retorna verdadeiro quando veio um preview junto
+ */
+bool Device::receiveDeteccoes(Protocolo::Quadro& quadro, std::vector<Raspberry::Deteccao>& deteccoes, Mat_<Raspberry::Cor>& preview)
+{
+    Protocolo::Cabecalho recebido;
+    do {
+        recebido = this->receiveMensagem(msgBuf);
+    } while (recebido.tipo != Protocolo::DETECCOES);
+
+    const Raspberry::Byte* jpeg;
+    uint32_t numJpeg;
+    if (!leDeteccoes(msgBuf.data(), msgBuf.size(), quadro, deteccoes, jpeg, numJpeg)) {
+        return false;
+    }
+
+    decodificador.decodifica(jpeg, numJpeg, preview);
+    return true;
+}
+
+/*
+ * Lê o corpo de uma mensagem DETECCOES no lugar, o preview aponta para o JPEG dentro do próprio corpo.
+ * Retorna verdadeiro quando veio um preview, e joga uma exceção se o corpo não tem o tamanho indicado nele ou traz
+ * mais de DETECCOES_MAX detecções, o que também mantém numDeteccoes*DETECCAO_BYTES longe do estouro
+ */
+bool Device::leDeteccoes(const Raspberry::Byte* corpo, uint32_t tamanho, Protocolo::Quadro& quadro, std::vector<Raspberry::Deteccao>& deteccoes,
+                         const Raspberry::Byte*& preview, uint32_t& numPreview)
+{
+    quadro = Protocolo::leQuadro(corpo, tamanho);
+    const Raspberry::Byte* buf = corpo + PROTOCOLO_QUADRO;
+    const Raspberry::Byte* fim = corpo + tamanho;
+
+    if (fim - buf < ptrdiff_t(2*sizeof(uint32_t))) {
+        throw std::runtime_error("Device: Erro mensagem de detecções inválida!");
+    }
+
+    uint32_t numDeteccoes = Protocolo::le32(buf);
+    uint32_t restante = uint32_t(fim - buf) - sizeof(uint32_t);     // Sem o tamanho do preview
+    if (numDeteccoes > DETECCOES_MAX || numDeteccoes*DETECCAO_BYTES > restante) {
+        throw std::runtime_error("Device: Erro mensagem de detecções inválida!");
+    }
+
+    decodificaDeteccoes(buf, numDeteccoes, deteccoes);
+    buf += numDeteccoes*DETECCAO_BYTES;
+
+    numPreview = Protocolo::le32(buf);
+    if (numPreview != uint32_t(fim - buf)) {
+        throw std::runtime_error("Device: Erro mensagem de detecções inválida!");
+    }
+
+    preview = buf;
+    return numPreview > 0;
+}
+
+/*
+ * Lê numDeteccoes registros no formato do sendDeteccoes, o buffer deve ter numDeteccoes*DETECCAO_BYTES bytes
+ */
+void Device::decodificaDeteccoes(const Raspberry::Byte* buf, uint32_t numDeteccoes, std::vector<Raspberry::Deteccao>& deteccoes)
+{
+    deteccoes.resize(numDeteccoes);
+
+    for (auto& deteccao : deteccoes) {
+        deteccao.alvo.ponto.posicao.x = int32_t(Protocolo::le32(buf));
+        deteccao.alvo.ponto.posicao.y = int32_t(Protocolo::le32(buf));
+
+        uint32_t escala = Protocolo::le32(buf), correlacao = Protocolo::le32(buf);
+        float correlacaoFlt;
+        memcpy(&deteccao.alvo.escala, &escala, sizeof(uint32_t));
+        memcpy(&correlacaoFlt, &correlacao, sizeof(uint32_t));
+        deteccao.alvo.ponto.correlacao = correlacaoFlt;
+
+        deteccao.recorte.create(MNIST_SIZE, MNIST_SIZE);
+        memcpy(deteccao.recorte.data, buf, MNIST_SIZE*MNIST_SIZE);
+        buf += MNIST_SIZE*MNIST_SIZE;
+    }
 }
 
 /*
@@ -9,21 +9,33 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h> 
+#include <sys/uio.h>
 #include <exception>
 
 #include "Raspberry.hpp"
+#include "JpegParalelo.hpp"
+#include "Protocolo.hpp"
 
 #define SOCKET_ERROR -1
 #define CHUNK_SIZE  (size_t) 65535
+#define DETECCAO_BYTES  (4*sizeof(uint32_t) + MNIST_SIZE*MNIST_SIZE)    // x, y, escala, correlação e o recorte
+#define DETECCOES_MAX   UINT8_MAX   // Por mensagem DETECCOES, o comando resume os alvos em 8 bits
 
 class Device
 {
     protected:
         struct sockaddr_in transferAddr;
         int transferSocket = SOCKET_ERROR;
+        bool conectado = false;     // Falso desde a última falha de transmissão ou recepção, até a próxima conexão
 
         std::vector<Raspberry::Byte> imgBuf;
-        std::vector<int> compressaoParam{IMWRITE_JPEG_QUALITY, 80};
+        std::vector<Raspberry::Byte> detBuf;
+        std::vector<Raspberry::Byte> msgBuf;
+        Raspberry::Byte cabecalho[PROTOCOLO_CABECALHO];
+        std::vector<int> compressaoParam{IMWRITE_JPEG_QUALITY, 80, IMWRITE_JPEG_RST_INTERVAL, 0};
+        JpegParalelo decodificador;
+
+        void sendPartes(struct iovec* partes, int numPartes);
     public:
         virtual void waitConnection() = 0;
         
@@ -32,10 +44,18 @@ class Device
 
         void setCompressaoQualidade(int8_t porcentagemComp);
 
+        int getSocket() const { return transferSocket; }
+        bool isConectado() const { return conectado; }
+        uint32_t getFilaEnvio() const;
+
         void sendUInt(const uint32_t value);
         void receiveUInt(uint32_t& value);
 
+        void sendSessao(const Protocolo::Sessao& sessao);
+        void receiveSessao(Protocolo::Sessao& sessao);
+
         void sendVectorByte(const std::vector<Raspberry::Byte>& vec);
+        void sendVectorByte(const Raspberry::Byte* dados, uint32_t numBytes);
         void receiveVectorByte(std::vector<Raspberry::Byte>& vec);
 
         void sendImage(const Mat_<Raspberry::Cor>& image);
@@ -43,6 +63,21 @@ class Device
 
         void sendImageCompactada(const Mat_<Raspberry::Cor>& image);
         void receiveImageCompactada(Mat_<Raspberry::Cor>& image);
+
+        void sendMensagem(Protocolo::Tipo tipo, const Raspberry::Byte* dados, uint32_t numBytes, const Raspberry::Byte* extra = nullptr, uint32_t numExtra = 0);
+        Protocolo::Cabecalho receiveMensagem(std::vector<Raspberry::Byte>& corpo);
+
+        void sendQuadro(const Protocolo::Quadro& quadro, const Raspberry::Byte* jpeg, uint32_t numBytes);
+        void sendQuadro(const Protocolo::Quadro& quadro, const Mat_<Raspberry::Cor>& image);
+
+        void sendDeteccoes(const Protocolo::Quadro& quadro, const std::vector<Raspberry::Deteccao>& deteccoes, const Mat_<Raspberry::Cor>& preview);
+        bool receiveDeteccoes(Protocolo::Quadro& quadro, std::vector<Raspberry::Deteccao>& deteccoes, Mat_<Raspberry::Cor>& preview);
+        static bool leDeteccoes(const Raspberry::Byte* corpo, uint32_t tamanho, Protocolo::Quadro& quadro, std::vector<Raspberry::Deteccao>& deteccoes,
+                                const Raspberry::Byte*& preview, uint32_t& numPreview);
+        static void decodificaDeteccoes(const Raspberry::Byte* buf, uint32_t numDeteccoes, std::vector<Raspberry::Deteccao>& deteccoes);
+
+        void sendTelemetria(const std::vector<Raspberry::Byte>& lote);
+        void receiveComando(Protocolo::Comando& comando);
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "Escalonador.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <sched.h>
+#include <opencv2/core.hpp>
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+#define ESCALONADOR_OPENCV
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#endif
+
+#ifdef BASE
+#include <torch/script.h>
+#endif
+
+#ifdef ESCALONADOR_OPENCV
+/*
+ * Backend do parallel_for_ do OpenCV sobre o pool global
+ */
+class BackendOpenCV : public cv::parallel::ParallelForAPI
+{
+    public:
+        void parallel_for(int tarefas, FN_parallel_for_body_cb_t corpo, void* dados) override
+        {
+            ThreadPool::global().paraleloPara(tarefas, 1, [&](size_t inicio, size_t fim) {
+                corpo(inicio, fim, dados);
+            });
+        }
+
+        // Fora do pool a thread que chama o parallel_for_ também executa partes dele, ela fica com o índice depois
+        // das threads do pool para não dividir com a primeira os buffers que o OpenCV separa por thread
+        int getThreadNum() const override
+        {
+            int indice = ThreadPool::getIndiceAtual();
+            return indice >= 0 ? indice : int(ThreadPool::global().getNumThreads());
+        }
+        int getNumThreads() const override { return ThreadPool::global().getNumThreads() + 1; }
+        int setNumThreads(int) override { return getNumThreads(); }
+        const char* getName() const override { return "ThreadPool"; }
+};
+#endif
+
+/*
+ * Converte uma lista de cpus no formato "0-3,6" no vetor de índices, recusa as que o processo não pode usar
+ * (fora do sched_getaffinity, que já exclui as offline)
+ */
+std::vector<int> Escalonador::getCpus(const std::string& lista)
+{
+    cpu_set_t permitidas;
+    CPU_ZERO(&permitidas);
+    if (sched_getaffinity(0, sizeof(permitidas), &permitidas) < 0) {
+        throw std::runtime_error("Escalonador: Erro ao ler a afinidade do processo! Código de erro: " + std::to_string(errno));
+    }
+
+    std::vector<int> cpus;
+    std::istringstream entrada(lista);
+    std::string item;
+
+    while (std::getline(entrada, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+
+        size_t traco = item.find('-');
+        int inicio = std::stoi(item.substr(0, traco));
+        int fim = traco == std::string::npos ? inicio : std::stoi(item.substr(traco + 1));
+
+        if (inicio < 0 || fim < inicio) {
+            throw std::runtime_error("Escalonador: Lista de cpus inválida: " + lista);
+        }
+
+        for (auto cpu = inicio; cpu <= fim; cpu++) {
+            if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &permitidas)) {
+                throw std::runtime_error("Escalonador: Cpu " + std::to_string(cpu) + " indisponível em " + lista);
+            }
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+/*
+ * Configura o pool global (zero threads usa uma por núcleo) e liga as bibliotecas a ele, chamar uma vez no início
+ */
+void Escalonador::configura(unsigned numThreads, const std::string& afinidade)
+{
+    std::vector<int> cpus = getCpus(afinidade);
+
+    if (numThreads == 0) {
+        numThreads = cpus.empty() ? std::thread::hardware_concurrency() : cpus.size();
+    }
+
+    ThreadPool::configuraGlobal(numThreads, cpus);
+
+#ifdef ESCALONADOR_OPENCV
+    cv::parallel::setParallelForBackend(std::make_shared<BackendOpenCV>(), false);
+#else
+    // Sem backend plugável o OpenCV não pode usar o pool, então fica sequencial
+    cv::setNumThreads(1);
+#endif
+
+#ifdef BASE
+    at::set_num_threads(1);
+    at::set_num_interop_threads(1);
+#endif
+}
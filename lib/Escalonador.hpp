@@ -0,0 +1,20 @@
+#ifndef ESCALONADOR_HPP
+#define ESCALONADOR_HPP
+
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+/*
+ * Escalonador único do processo: o pool global executa as tarefas do programa e também os laços paralelos
+ * do OpenCV (decodificação, conversões), enquanto o libtorch fica com uma thread, rodando dentro das tarefas.
+ * Assim não há pools concorrendo pelos mesmos núcleos.
+ */
+namespace Escalonador
+{
+    std::vector<int> getCpus(const std::string& lista);
+    void configura(unsigned numThreads = 0, const std::string& afinidade = "");
+} // namespace Escalonador
+
+#endif
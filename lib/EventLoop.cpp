@@ -0,0 +1,196 @@
+#include "EventLoop.hpp"
+
+#define EVENT_LOOP_MAX_EVENTOS  64
+
+EventLoop::EventLoop()
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        throw std::runtime_error("EventLoop: Erro ao criar o epoll! Código de erro: " + std::to_string(errno));
+    }
+
+    eventoFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventoFd < 0) {
+        throw std::runtime_error("EventLoop: Erro ao criar o evento! Código de erro: " + std::to_string(errno));
+    }
+
+    struct epoll_event evento{};
+    evento.events = EPOLLIN;
+    evento.data.fd = eventoFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, eventoFd, &evento) < 0) {
+        throw std::runtime_error("EventLoop: Erro ao registrar o evento! Código de erro: " + std::to_string(errno));
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    if (eventoFd >= 0) {
+        close(eventoFd);
+    }
+
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
+}
+
+/*
+ * Registra o descritor com os eventos de interesse (EPOLLIN, EPOLLOUT...) e o callback chamado quando ocorrerem
+ */
+void EventLoop::adiciona(int fd, uint32_t eventos, Callback callback)
+{
+    struct epoll_event evento{};
+    evento.events = eventos;
+    evento.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &evento) < 0) {
+        throw std::runtime_error("EventLoop: Erro ao registrar o descritor! Código de erro: " + std::to_string(errno));
+    }
+
+    callbacks[fd] = std::move(callback);
+}
+
+/*
+ * Troca os eventos de interesse do descritor, zero suspende o descritor sem remove-lo
+ */
+void EventLoop::modifica(int fd, uint32_t eventos)
+{
+    struct epoll_event evento{};
+    evento.events = eventos;
+    evento.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &evento) < 0) {
+        throw std::runtime_error("EventLoop: Erro ao modificar o descritor! Código de erro: " + std::to_string(errno));
+    }
+}
+
+/*
+ * Remove o descritor, eventos dele já retornados pelo epoll nesta iteração são descartados
+ */
+void EventLoop::remove(int fd)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    callbacks.erase(fd);
+}
+
+/*
+ * Agenda uma tarefa para rodar na thread do laço, pode ser chamado de qualquer thread
+ */
+void EventLoop::posta(Tarefa tarefa)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexPostadas);
+        postadas.push_back(std::move(tarefa));
+    }
+
+    uint64_t um = 1;
+    if (write(eventoFd, &um, sizeof(um)) < 0 && errno != EAGAIN) {
+        throw std::runtime_error("EventLoop: Erro ao sinalizar o evento! Código de erro: " + std::to_string(errno));
+    }
+}
+
+/*
+ * Cria um timer desarmado, a tarefa roda na thread do laço a cada vez que ele expira
+ */
+int EventLoop::criaTimer(Tarefa tarefa)
+{
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timer < 0) {
+        throw std::runtime_error("EventLoop: Erro ao criar o timer! Código de erro: " + std::to_string(errno));
+    }
+
+    adiciona(timer, EPOLLIN, [timer, tarefa](uint32_t) {
+        uint64_t expiracoes;
+        if (read(timer, &expiracoes, sizeof(expiracoes)) > 0) {
+            tarefa();
+        }
+    });
+
+    return timer;
+}
+
+/*
+ * Arma o timer para expirar daqui a segundos, periódico repete com o mesmo intervalo, zero desarma
+ */
+void EventLoop::armaTimer(int timer, double segundos, bool periodico)
+{
+    struct itimerspec valor{};
+    if (segundos > 0.0) {
+        valor.it_value.tv_sec = time_t(segundos);
+        valor.it_value.tv_nsec = long((segundos - time_t(segundos))*1e9);
+
+        // Zero em it_value desarmaria o timer
+        if (valor.it_value.tv_sec == 0 && valor.it_value.tv_nsec == 0) {
+            valor.it_value.tv_nsec = 1;
+        }
+
+        if (periodico) {
+            valor.it_interval = valor.it_value;
+        }
+    }
+
+    if (timerfd_settime(timer, 0, &valor, nullptr) < 0) {
+        throw std::runtime_error("EventLoop: Erro ao armar o timer! Código de erro: " + std::to_string(errno));
+    }
+}
+
+void EventLoop::removeTimer(int timer)
+{
+    remove(timer);
+    close(timer);
+}
+
+void EventLoop::executaPostadas()
+{
+    uint64_t contador;
+    while (read(eventoFd, &contador, sizeof(contador)) > 0) {}
+
+    std::vector<Tarefa> tarefas;
+    {
+        std::lock_guard<std::mutex> lock(mutexPostadas);
+        tarefas.swap(postadas);
+    }
+
+    for (auto& tarefa : tarefas) {
+        tarefa();
+    }
+}
+
+/*
+ * Aguarda até timeoutMs pelos eventos e despacha os callbacks e as tarefas postadas
+ */
+void EventLoop::executaUmaVez(int timeoutMs)
+{
+    struct epoll_event eventos[EVENT_LOOP_MAX_EVENTOS];
+
+    int numEventos = epoll_wait(epollFd, eventos, EVENT_LOOP_MAX_EVENTOS, timeoutMs);
+    if (numEventos < 0) {
+        if (errno == EINTR) {
+            return;
+        }
+        throw std::runtime_error("EventLoop: Erro ao aguardar os eventos! Código de erro: " + std::to_string(errno));
+    }
+
+    for (auto i = 0; i < numEventos; i++) {
+        int fd = eventos[i].data.fd;
+
+        if (fd == eventoFd) {
+            executaPostadas();
+            continue;
+        }
+
+        // O callback pode remover o próprio descritor, por isso é copiado antes de ser chamado
+        auto it = callbacks.find(fd);
+        if (it != callbacks.end()) {
+            Callback callback = it->second;
+            callback(eventos[i].events);
+        }
+    }
+}
+
+/*
+ * Roda o laço até run ser falso
+ */
+void EventLoop::executa(const std::atomic<bool>& run, int timeoutMs)
+{
+    while (run) {
+        executaUmaVez(timeoutMs);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include <stdexcept>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/*
+ * Laço de eventos de E/S sobre o epoll, os callbacks rodam sempre na thread que chama executa.
+ * Outras threads entregam trabalho para esta thread por posta, que acorda o laço por um eventfd.
+ * Os timers são timerfds registrados no mesmo epoll.
+ */
+class EventLoop
+{
+    public:
+        using Callback = std::function<void(uint32_t eventos)>;
+        using Tarefa = std::function<void()>;
+
+    private:
+        int epollFd = -1;
+        int eventoFd = -1;
+
+        std::unordered_map<int, Callback> callbacks;
+
+        std::mutex mutexPostadas;
+        std::vector<Tarefa> postadas;
+
+        void executaPostadas();
+    public:
+        EventLoop();
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        void adiciona(int fd, uint32_t eventos, Callback callback);
+        void modifica(int fd, uint32_t eventos);
+        void remove(int fd);
+
+        void posta(Tarefa tarefa);
+
+        int criaTimer(Tarefa tarefa);
+        void armaTimer(int timer, double segundos, bool periodico = false);
+        void removeTimer(int timer);
+
+        void executaUmaVez(int timeoutMs);
+        void executa(const std::atomic<bool>& run, int timeoutMs = 100);
+};
+
+#endif
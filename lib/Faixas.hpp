@@ -0,0 +1,79 @@
+#ifndef FAIXAS_HPP
+#define FAIXAS_HPP
+
+#include "Raspberry.hpp"
+
+/*
+ * Divisão da correlação multi-escala em faixas de linhas para o pool, comum à busca em float da Base e à busca em
+ * ponto fixo da Pi. O modelo de cada escala informa o seu tamanho pelo getTamanho, que a busca em ponto fixo
+ * sobrecarrega para o PontoFixo::Modelo
+ */
+namespace Faixas
+{
+    /*
+     * Faixa de linhas [inicio, fim) da região válida da correlação de uma escala
+     */
+    typedef struct
+    {
+        int escala;
+        int inicio;
+        int fim;
+        double custo;
+    } Faixa;
+
+    template <typename T>
+    inline Size getTamanho(const Mat_<T>& modelo)
+    {
+        return modelo.size();
+    }
+
+    /*
+     * Custo da correlação de um modelo: as posições da região válida vezes a área do modelo, zero quando ele não cabe
+     */
+    template <typename Pixel>
+    inline double getCusto(const Mat_<Pixel>& imagem, Size modelo)
+    {
+        int linhas = imagem.rows - modelo.height + 1;
+        int colunas = imagem.cols - modelo.width + 1;
+
+        return linhas > 0 && colunas > 0 ? double(linhas)*colunas*modelo.area() : 0.0;
+    }
+
+    /*
+     * Divide a correlação de cada escala selecionada em faixas de linhas de custo parecido, o custo de uma escala cresce
+     * com a área do modelo, então as escalas grandes viram várias faixas e as pequenas uma só. Retorna em ordem decrescente de custo.
+     */
+    template <typename Pixel, typename Modelo>
+    std::vector<Faixa> getFaixas(const Mat_<Pixel>& imagem, const Modelo modelos[], const std::vector<int>& selecionadas, unsigned numThreads)
+    {
+        double custoTotal = 0.0;
+        for (int n : selecionadas) {
+            custoTotal += getCusto(imagem, getTamanho(modelos[n]));
+        }
+
+        double custoAlvo = custoTotal / (FAIXAS_POR_THREAD*std::max(1u, numThreads));
+
+        std::vector<Faixa> faixas;
+        for (int n : selecionadas) {
+            Size tamanho = getTamanho(modelos[n]);
+            double custo = getCusto(imagem, tamanho);
+            if (custo <= 0.0) {
+                continue;
+            }
+
+            int linhas = imagem.rows - tamanho.height + 1;
+            int numFaixas = std::clamp(int(std::ceil(custo / custoAlvo)), 1, std::max(1, linhas / FAIXA_LINHAS_MIN));
+
+            for (auto k = 0; k < numFaixas; k++) {
+                int inicio = linhas*k / numFaixas;
+                int fim = linhas*(k + 1) / numFaixas;
+                faixas.push_back(Faixa{n, inicio, fim, custo*(fim - inicio)/linhas});
+            }
+        }
+
+        std::sort(faixas.begin(), faixas.end(), [](const Faixa& a, const Faixa& b) { return a.custo > b.custo; });
+        return faixas;
+    }
+} // namespace Faixas
+
+#endif
@@ -0,0 +1,568 @@
+#include "ImageProcessing.hpp"
+
+#ifdef BASE
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace ImageProcessing
+{
+    /*
+     * Torna a somatoria absoluta da imagem dar dois
+     */
+    Mat_<Flt> modulo2(Mat_<Flt> imagem) 
+    {
+        Mat_<Flt> clone = imagem.clone();
+        
+        double soma = 0.0;
+        for (auto it = clone.begin(); it != clone.end(); it++) {
+            soma += abs(*it);
+        }
+
+        if (soma < epsilon) {
+            throw std::runtime_error("Erro: Divisao por zero");
+        }
+
+        soma = 2.0/(soma);
+
+        for (auto it = clone.begin(); it != clone.end(); it++) {
+            (*it) *= soma;
+        }
+              
+        return clone;
+    }
+
+    /*
+     * Elimina nivel DC (subtrai media)
+     */
+    Mat_<Flt> dcReject(Mat_<Flt> imagem) 
+    { 
+        return imagem - mean(imagem)[0];;
+    }
+
+    /*
+     * Elimina nivel DC (subtrai media) com dontcare
+     */
+    Mat_<Flt> dcReject(Mat_<Flt> imagem, Flt dontcare) 
+    {
+        Mat_<uchar> naodontcare = (imagem != dontcare); 
+        Scalar media = mean(imagem, naodontcare);
+        subtract(imagem, media[0], imagem, naodontcare);
+        Mat_<uchar> simdontcare = (imagem == dontcare); 
+        subtract(imagem, dontcare, imagem, simdontcare);
+        return imagem;
+    }
+    
+    /*
+     * Kernels vetorizados (universal intrinsics do OpenCV) de uma linha do pré-processamento, com o resto escalar.
+     * Usam as funções v_add, v_mul... e o VTraits, que também valem nos backends de largura variável (CV_SIMD_SCALABLE)
+     */
+    namespace Simd
+    {
+        /*
+         * Acumula a soma e a quantidade dos pixels diferentes de dontcare
+         */
+        void somaValidos(const Flt* linha, int n, Flt dontcare, double& soma, double& validos)
+        {
+            int x = 0;
+        #if (CV_SIMD || CV_SIMD_SCALABLE)
+            v_float32 vDontcare = vx_setall_f32(dontcare), vUm = vx_setall_f32(1.0f);
+            v_float32 vSoma = vx_setzero_f32(), vValidos = vx_setzero_f32();
+            const int passo = VTraits<v_float32>::vlanes();
+
+            for (; x + passo <= n; x += passo) {
+                v_float32 v = vx_load(linha + x);
+                v_float32 mascara = v_ne(v, vDontcare);
+                vSoma = v_add(vSoma, v_and(v, mascara));
+                vValidos = v_add(vValidos, v_and(vUm, mascara));
+            }
+
+            soma += v_reduce_sum(vSoma);
+            validos += v_reduce_sum(vValidos);
+        #endif
+            for (; x < n; x++) {
+                if (linha[x] != dontcare) {
+                    soma += linha[x];
+                    validos++;
+                }
+            }
+        }
+
+        /*
+         * Subtrai a média dos pixels válidos e zera os dontcare, retorna a soma absoluta do resultado
+         */
+        double subtraiMedia(Flt* linha, int n, Flt dontcare, Flt media)
+        {
+            double somaAbs = 0.0;
+            int x = 0;
+        #if (CV_SIMD || CV_SIMD_SCALABLE)
+            v_float32 vDontcare = vx_setall_f32(dontcare), vMedia = vx_setall_f32(media);
+            v_float32 vSomaAbs = vx_setzero_f32();
+            const int passo = VTraits<v_float32>::vlanes();
+
+            for (; x + passo <= n; x += passo) {
+                v_float32 v = vx_load(linha + x);
+                v_float32 r = v_and(v_sub(v, vMedia), v_ne(v, vDontcare));
+                v_store(linha + x, r);
+                vSomaAbs = v_add(vSomaAbs, v_abs(r));
+            }
+
+            somaAbs += v_reduce_sum(vSomaAbs);
+        #endif
+            for (; x < n; x++) {
+                linha[x] = linha[x] != dontcare ? linha[x] - media : 0.0f;
+                somaAbs += std::abs(linha[x]);
+            }
+
+            return somaAbs;
+        }
+
+        /*
+         * Multiplica a linha pelo fator
+         */
+        void multiplica(Flt* linha, int n, Flt fator)
+        {
+            int x = 0;
+        #if (CV_SIMD || CV_SIMD_SCALABLE)
+            v_float32 vFator = vx_setall_f32(fator);
+            const int passo = VTraits<v_float32>::vlanes();
+
+            for (; x + passo <= n; x += passo) {
+                v_store(linha + x, v_mul(vx_load(linha + x), vFator));
+            }
+        #endif
+            for (; x < n; x++) {
+                linha[x] *= fator;
+            }
+        }
+    } // namespace Simd
+
+    /*
+     * modulo2 no próprio buffer, sem cópia
+     */
+    void modulo2NoLugar(Mat_<Flt>& imagem)
+    {
+        double soma = norm(imagem, NORM_L1);
+        if (soma < epsilon) {
+            throw std::runtime_error("Erro: Divisao por zero");
+        }
+
+        for (auto y = 0; y < imagem.rows; y++) {
+            Simd::multiplica(imagem[y], imagem.cols, 2.0/soma);
+        }
+    }
+
+    /*
+     * dcReject com dontcare no próprio buffer, a máscara é calculada junto com a soma, sem as imagens de máscara
+     */
+    void dcRejectNoLugar(Mat_<Flt>& imagem, Flt dontcare)
+    {
+        double soma = 0.0, validos = 0.0;
+        for (auto y = 0; y < imagem.rows; y++) {
+            Simd::somaValidos(imagem[y], imagem.cols, dontcare, soma, validos);
+        }
+
+        Flt media = validos > 0.0 ? soma/validos : 0.0;
+        for (auto y = 0; y < imagem.rows; y++) {
+            Simd::subtraiMedia(imagem[y], imagem.cols, dontcare, media);
+        }
+    }
+
+    /*
+     * modulo2(dcReject(imagem, dontcare)) fundidos no próprio buffer: a soma absoluta sai da mesma passada que subtrai a média
+     */
+    void preProcessa(Mat_<Flt>& imagem, Flt dontcare)
+    {
+        double soma = 0.0, validos = 0.0;
+        for (auto y = 0; y < imagem.rows; y++) {
+            Simd::somaValidos(imagem[y], imagem.cols, dontcare, soma, validos);
+        }
+
+        Flt media = validos > 0.0 ? soma/validos : 0.0;
+        double somaAbs = 0.0;
+        for (auto y = 0; y < imagem.rows; y++) {
+            somaAbs += Simd::subtraiMedia(imagem[y], imagem.cols, dontcare, media);
+        }
+
+        if (somaAbs < epsilon) {
+            throw std::runtime_error("Erro: Divisao por zero");
+        }
+
+        for (auto y = 0; y < imagem.rows; y++) {
+            Simd::multiplica(imagem[y], imagem.cols, 2.0/somaAbs);
+        }
+    }
+
+    /*
+     * Converte uma imagem de Cor (Vec3b) para Float em escala de cinza
+     */
+    void Cor2Flt(Mat_<Cor> entrada, Mat_<Flt>& saida) 
+    {
+        Mat_<Vec3f> temp; 
+        entrada.convertTo(temp, CV_32F, 1.0/255.0, 0.0);
+        cvtColor(temp, saida, COLOR_BGR2GRAY);
+    }
+
+    namespace TemplateMatching
+    {
+        /*
+        * Realiza a busca do modelo na imagem, retorna uma imagem de correlação de mesma dimensão.
+        */
+        Mat_<Flt> matchTemplateSame(Mat_<Flt> imagem, Mat_<Flt> modelo, int metodo, Flt backgroundColor)
+        {
+            Mat_<Flt> resultado{imagem.size(), backgroundColor};
+            Rect rect{(modelo.cols-1)/2, (modelo.rows-1)/2, imagem.cols - modelo.cols + 1, imagem.rows - modelo.rows + 1};
+            Mat_<Flt> roi{resultado, rect};
+            matchTemplate(imagem, modelo, roi, metodo);
+            return resultado;
+        }
+        
+        /*
+         * Índices de todas as escalas, em ordem
+         */
+        std::vector<int> getTodasEscalas(int numEscalas)
+        {
+            std::vector<int> todas(numEscalas);
+            for (auto n = 0; n < numEscalas; n++) {
+                todas[n] = n;
+            }
+            return todas;
+        }
+
+        /*
+         * Correlação das linhas da faixa, a linha i do resultado corresponde ao modelo centrado na linha inicio + i + (modelo.rows-1)/2
+         */
+        void matchTemplateFaixa(const Mat_<Flt>& imagem, const Mat_<Flt>& modelo, const Faixa& faixa, Mat_<Flt>& resultado, int metodo)
+        {
+            Mat_<Flt> linhas = imagem.rowRange(faixa.inicio, faixa.fim + modelo.rows - 1);
+            matchTemplate(linhas, modelo, resultado, metodo);
+        }
+
+        /*
+         * Retorna o modelo a ser buscado pré-processado e em diferêntes escalas
+         */
+        void getModeloPreProcessados(Mat_<Flt>& modelo, Mat_<Flt> modelosPreProcessados[], uint8_t numEscalas, float escalas[])
+        {
+            ThreadPool::global().paraleloPara(numEscalas, 1, [&](size_t primeiro, size_t fim) {
+                for (auto i = primeiro; i < fim; i++) {
+                    Mat_<Raspberry::Flt> temp;
+
+                    resize(modelo, temp, Size(), escalas[i], escalas[i], INTER_NEAREST);
+                            
+                    // Para poder usar o metodo de Correlação cruzada é nescessário pre-processar o modelo
+                    ImageProcessing::preProcessa(temp, 1.0);
+                    modelosPreProcessados[i] = temp;
+                }
+            });
+        }
+
+        /*
+         * Maior correlação de cada escala selecionada, calculada em faixas no pool. As escalas com o modelo maior que a imagem
+         * ficam com correlação -1, as não selecionadas não são alteradas.
+         */
+        void avaliaEscalas(const Mat_<Raspberry::Flt>& imagem, const Mat_<Raspberry::Flt> modelos[], const std::vector<int>& selecionadas, 
+                                  float escalas[], Raspberry::FindPos corrBuf[])
+        {
+            ThreadPool& pool = ThreadPool::global();
+            std::vector<Faixa> faixas = Faixas::getFaixas(imagem, modelos, selecionadas, pool.getNumThreads());
+
+            // Realiza o template matching pelas faixas das diferentes escalas, cada faixa guarda o seu máximo
+            std::vector<Raspberry::CorrelacaoPonto> maximos(faixas.size());
+
+            pool.paraleloPara(faixas.size(), 1, [&](size_t primeira, size_t fim) {
+                for (auto f = primeira; f < fim; f++) {
+                    const Faixa& faixa = faixas[f];
+                    const Mat_<Raspberry::Flt>& modelo = modelos[faixa.escala];
+
+                    Mat_<Raspberry::Flt> correlacao;
+                    matchTemplateFaixa(imagem, modelo, faixa, correlacao, TM_CCOEFF_NORMED);
+                    minMaxLoc(correlacao, NULL, &maximos[f].correlacao, NULL, &maximos[f].posicao);
+
+                    // Coordenadas da imagem, com o modelo centrado
+                    maximos[f].posicao += Point((modelo.cols - 1)/2, faixa.inicio + (modelo.rows - 1)/2);
+                }
+            });
+
+            for (int n : selecionadas) {
+                corrBuf[n] = Raspberry::FindPos{escalas[n], {-1.0, Point(0, 0)}};
+            }
+
+            for (size_t f = 0; f < faixas.size(); f++) {
+                Raspberry::FindPos& escala = corrBuf[faixas[f].escala];
+                if (maximos[f].correlacao > escala.ponto.correlacao) {
+                    escala.ponto = maximos[f];
+                }
+            }
+        }
+
+        /*
+         * Retorna a posição da maior correlação encontrada
+         */
+        Raspberry::FindPos getMaxCorrelacao(Mat_<Raspberry::Flt>& frameBufFlt, Mat_<Raspberry::Flt> modelos[], Raspberry::FindPos corrBuf[], int numEscalas, float escalas[])
+        {
+            avaliaEscalas(frameBufFlt, modelos, getTodasEscalas(numEscalas), escalas, corrBuf);
+
+            Raspberry::FindPos maxCorr = corrBuf[0];
+            for (auto i = 1; i < numEscalas; i++) {
+                if (corrBuf[i].ponto.correlacao > maxCorr.ponto.correlacao) {
+                    maxCorr = corrBuf[i];
+                }
+            }  
+
+            return maxCorr; 
+        }
+
+        BuscaAdaptativa::BuscaAdaptativa(Mat_<Raspberry::Flt>& modelo, int numEscalas, float escalas[], float confianca, float margem)
+            : numEscalas(numEscalas), escalas(escalas), confianca(confianca), margem(margem), modelosGrossos(numEscalas)
+        {
+            std::vector<float> escalasGrossas(numEscalas);
+            for (auto n = 0; n < numEscalas; n++) {
+                escalasGrossas[n] = 0.5f*escalas[n];
+            }
+            getModeloPreProcessados(modelo, modelosGrossos.data(), numEscalas, escalasGrossas.data());
+        }
+
+        /*
+         * Mesmo resultado do getMaxCorrelacao quando nenhuma escala é descartada, em corrBuf as escalas não avaliadas
+         * ficam com correlação -1. Em avaliadas retorna quantas escalas foram correlacionadas na resolução completa.
+         */
+        Raspberry::FindPos BuscaAdaptativa::busca(Mat_<Raspberry::Flt>& frameBufFlt, Mat_<Raspberry::Flt> modelos[], Raspberry::FindPos corrBuf[], int* avaliadas) const
+        {
+            std::vector<int> todas = getTodasEscalas(numEscalas);
+
+            // Passada grossa
+            Mat_<Raspberry::Flt> quadroGrosso;
+            resize(frameBufFlt, quadroGrosso, Size(), 0.5, 0.5, INTER_AREA);
+
+            std::vector<Raspberry::FindPos> grossos(numEscalas);
+            avaliaEscalas(quadroGrosso, modelosGrossos.data(), todas, escalas, grossos.data());
+
+            std::vector<int> ordem = todas;
+            std::sort(ordem.begin(), ordem.end(), [&](int a, int b) {
+                if (grossos[a].ponto.correlacao != grossos[b].ponto.correlacao) {
+                    return grossos[a].ponto.correlacao > grossos[b].ponto.correlacao;
+                }
+                return modelos[a].total() < modelos[b].total();
+            });
+
+            for (auto n = 0; n < numEscalas; n++) {
+                corrBuf[n] = Raspberry::FindPos{escalas[n], {-1.0, Point(0, 0)}};
+            }
+
+            // Resolução completa, um lote com uma escala por thread do pool
+            Raspberry::FindPos melhor = corrBuf[0];
+            size_t lote = ThreadPool::global().getNumThreads();
+            size_t proxima = 0;
+            int numAvaliadas = 0;
+
+            while (proxima < ordem.size() && melhor.ponto.correlacao < confianca) {
+                std::vector<int> selecionadas;
+
+                // Em ordem decrescente de estimativa, a primeira descartada encerra a busca
+                while (proxima < ordem.size() && selecionadas.size() < lote &&
+                       grossos[ordem[proxima]].ponto.correlacao + margem > melhor.ponto.correlacao) {
+                    selecionadas.push_back(ordem[proxima++]);
+                }
+
+                if (selecionadas.empty()) {
+                    break;
+                }
+
+                avaliaEscalas(frameBufFlt, modelos, selecionadas, escalas, corrBuf);
+                numAvaliadas += selecionadas.size();
+
+                for (int n : selecionadas) {
+                    if (corrBuf[n].ponto.correlacao > melhor.ponto.correlacao) {
+                        melhor = corrBuf[n];
+                    }
+                }
+            }
+
+            if (avaliadas != nullptr) {
+                *avaliadas = numAvaliadas;
+            }
+            return melhor;
+        }
+
+        /*
+         * Troca o modelo grosso da escala n pelo modelo da escala (antes do pré-processamento) reduzido à metade
+         */
+        void BuscaAdaptativa::atualizaEscala(int n, const Mat_<Raspberry::Flt>& modeloEscala)
+        {
+            resize(modeloEscala, modelosGrossos[n], Size(), 0.5, 0.5, INTER_NEAREST);
+            preProcessa(modelosGrossos[n], 1.0);
+        }
+
+        ModeloAdaptativo::ModeloAdaptativo(Mat_<Raspberry::Flt>& modelo, int numEscalas, float escalas[], float taxa, int perdaMax, BuscaAdaptativa* busca)
+            : numEscalas(numEscalas), escalas(escalas), taxa(taxa), perdaMax(perdaMax), busca(busca),
+              originais(numEscalas), atuais(numEscalas), adaptadas(numEscalas, false)
+        {
+            for (auto n = 0; n < numEscalas; n++) {
+                resize(modelo, originais[n], Size(), escalas[n], escalas[n], INTER_NEAREST);
+                atuais[n] = originais[n].clone();
+            }
+        }
+
+        void ModeloAdaptativo::atualizaEscala(int n, Mat_<Raspberry::Flt> modelos[])
+        {
+            atuais[n].copyTo(modelos[n]);
+            preProcessa(modelos[n], 1.0);
+
+            if (busca != nullptr) {
+                busca->atualizaEscala(n, atuais[n]);
+            }
+        }
+
+        /*
+         * Mistura o recorte da detecção na sua escala, nullptr conta um quadro sem o alvo. Retorna a escala adaptada ou -1
+         */
+        int ModeloAdaptativo::atualiza(const Mat_<Raspberry::Flt>& frameBufFlt, const Raspberry::FindPos* deteccao, Mat_<Raspberry::Flt> modelos[])
+        {
+            if (deteccao == nullptr) {
+                if (++perdidos >= perdaMax) {
+                    reinicia(modelos);
+                }
+                return -1;
+            }
+            perdidos = 0;
+
+            int n = std::find(escalas, escalas + numEscalas, deteccao->escala) - escalas;
+            if (n == numEscalas) {
+                return -1;
+            }
+
+            // Mesma janela da correlação, a posição é o centro do modelo
+            Mat_<Raspberry::Flt>& atual = atuais[n];
+            Rect janela(deteccao->ponto.posicao - Point((atual.cols - 1)/2, (atual.rows - 1)/2), atual.size());
+            if ((janela & Rect(0, 0, frameBufFlt.cols, frameBufFlt.rows)) != janela) {
+                return -1;
+            }
+
+            // Os dontcare (1.0) do original são mantidos e os demais pixels não podem chegar a 1.0
+            const Mat_<Raspberry::Flt> recorte = frameBufFlt(janela);
+            for (auto y = 0; y < atual.rows; y++) {
+                for (auto x = 0; x < atual.cols; x++) {
+                    if (originais[n](y, x) != 1.0f) {
+                        atual(y, x) = std::min((1.0f - taxa)*atual(y, x) + taxa*recorte(y, x), 1.0f - FLT_EPSILON);
+                    }
+                }
+            }
+
+            adaptadas[n] = true;
+            atualizaEscala(n, modelos);
+            return n;
+        }
+
+        /*
+         * Volta as escalas adaptadas ao modelo original
+         */
+        void ModeloAdaptativo::reinicia(Mat_<Raspberry::Flt> modelos[])
+        {
+            for (auto n = 0; n < numEscalas; n++) {
+                if (adaptadas[n]) {
+                    originais[n].copyTo(atuais[n]);
+                    atualizaEscala(n, modelos);
+                    adaptadas[n] = false;
+                }
+            }
+            perdidos = 0;
+        }
+
+        /*
+         * Retorna todas as detecções acima do limiar em ordem decrescente de correlação. São extraídos os máximos locais
+         * de cada escala e depois suprimidos os não-máximos entre todas as escalas, pela sobreposição relativa à menor caixa
+         */
+        std::vector<Raspberry::FindPos> getDeteccoes(Mat_<Raspberry::Flt>& frameBufFlt, Mat_<Raspberry::Flt> modelos[], int numEscalas, float escalas[],
+                                                     float limiar, float sobreposicaoMax, size_t maxDeteccoes)
+        {
+            typedef struct
+            {
+                Raspberry::FindPos pos;
+                Rect caixa;
+            } Candidato;
+
+            std::vector<std::vector<Candidato>> candidatosEscala(numEscalas);
+            std::vector<Mat_<Raspberry::Flt>> correlacoes(numEscalas);
+
+            ThreadPool& pool = ThreadPool::global();
+            std::vector<Faixa> faixas = Faixas::getFaixas(frameBufFlt, modelos, getTodasEscalas(numEscalas), pool.getNumThreads());
+
+            // Correlação completa de cada escala, as faixas escrevem em linhas disjuntas
+            for (auto n = 0; n < numEscalas; n++) {
+                correlacoes[n] = Mat_<Raspberry::Flt>{frameBufFlt.size(), 0.0f};
+            }
+
+            pool.paraleloPara(faixas.size(), 1, [&](size_t primeira, size_t fim) {
+                for (auto f = primeira; f < fim; f++) {
+                    const Faixa& faixa = faixas[f];
+                    const Mat_<Raspberry::Flt>& modelo = modelos[faixa.escala];
+
+                    Rect rect{(modelo.cols - 1)/2, faixa.inicio + (modelo.rows - 1)/2, frameBufFlt.cols - modelo.cols + 1, faixa.fim - faixa.inicio};
+                    Mat_<Raspberry::Flt> roi{correlacoes[faixa.escala], rect};
+                    matchTemplateFaixa(frameBufFlt, modelo, faixa, roi, TM_CCOEFF_NORMED);
+                }
+            });
+
+            pool.paraleloPara(numEscalas, 1, [&](size_t primeira, size_t fim) {
+                for (auto n = primeira; n < fim; n++) {
+                    const Mat_<Raspberry::Flt>& correlacao = correlacoes[n];
+
+                    // Máximo local: igual ao máximo da vizinhança de meio modelo
+                    int raio = std::max(1, std::min(modelos[n].cols, modelos[n].rows)/4);
+                    Mat_<Raspberry::Flt> vizinhanca;
+                    dilate(correlacao, vizinhanca, getStructuringElement(MORPH_RECT, Size(2*raio + 1, 2*raio + 1)));
+
+                    for (auto y = 0; y < correlacao.rows; y++) {
+                        const Raspberry::Flt* c = correlacao[y];
+                        const Raspberry::Flt* v = vizinhanca[y];
+
+                        for (auto x = 0; x < correlacao.cols; x++) {
+                            if (c[x] > limiar && c[x] >= v[x]) {
+                                Rect caixa{x - modelos[n].cols/2, y - modelos[n].rows/2, modelos[n].cols, modelos[n].rows};
+                                candidatosEscala[n].push_back(Candidato{Raspberry::FindPos{escalas[n], {c[x], Point(x, y)}}, caixa});
+                            }
+                        }
+                    }
+                }
+            });
+
+            std::vector<Candidato> candidatos;
+            for (const auto& escala : candidatosEscala) {
+                candidatos.insert(candidatos.end(), escala.begin(), escala.end());
+            }
+
+            std::sort(candidatos.begin(), candidatos.end(), [](const Candidato& a, const Candidato& b) {
+                return a.pos.ponto.correlacao > b.pos.ponto.correlacao;
+            });
+
+            // Supressão dos não-máximos entre as escalas
+            std::vector<Candidato> mantidos;
+            for (const auto& candidato : candidatos) {
+                bool suprimido = false;
+
+                for (const auto& mantido : mantidos) {
+                    double intersecao = (candidato.caixa & mantido.caixa).area();
+                    double menor = std::min(candidato.caixa.area(), mantido.caixa.area());
+
+                    if (intersecao > sobreposicaoMax*menor) {
+                        suprimido = true;
+                        break;
+                    }
+                }
+
+                if (!suprimido) {
+                    mantidos.push_back(candidato);
+                    if (mantidos.size() == maxDeteccoes) {
+                        break;
+                    }
+                }
+            }
+
+            std::vector<Raspberry::FindPos> deteccoes;
+            for (const auto& mantido : mantidos) {
+                deteccoes.push_back(mantido.pos);
+            }
+
+            return deteccoes;
+        }
+    } // namespace TemplateMatching
+} // namespace ImageProcessing
+#endif // BASE
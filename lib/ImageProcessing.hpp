@@ -0,0 +1,112 @@
+#ifndef IMAGE_PROCESSING_HPP
+#define IMAGE_PROCESSING_HPP
+
+#include "Raspberry.hpp"
+#include "Faixas.hpp"
+
+#ifdef BASE
+/*
+ * Pré-processamento e busca multi-escala do modelo em float, feitas na Base
+ */
+namespace ImageProcessing
+{
+    using namespace Raspberry;
+
+    Mat_<Flt> modulo2(Mat_<Flt> imagem);
+    Mat_<Flt> dcReject(Mat_<Flt> imagem);
+    Mat_<Flt> dcReject(Mat_<Flt> imagem, Flt dontcare);
+
+    namespace Simd
+    {
+        void somaValidos(const Flt* linha, int n, Flt dontcare, double& soma, double& validos);
+        double subtraiMedia(Flt* linha, int n, Flt dontcare, Flt media);
+        void multiplica(Flt* linha, int n, Flt fator);
+    } // namespace Simd
+
+    void modulo2NoLugar(Mat_<Flt>& imagem);
+    void dcRejectNoLugar(Mat_<Flt>& imagem, Flt dontcare);
+    void preProcessa(Mat_<Flt>& imagem, Flt dontcare);
+
+    void Cor2Flt(Mat_<Cor> entrada, Mat_<Flt>& saida);
+
+    /*
+     * Adiciona a imagem um retangulo não preenchido centralizado no ponto passado
+     */
+    template <typename T>
+    inline void ploteRetangulo(Mat_<T>& image, Point center, float size, Raspberry::Cor color = Paleta::red, float espessura = 1.5)
+    {
+        Point a {max(center.x - (int) (size*0.5), 0), max(center.y - (int) (size*0.5), 0)};
+        Point b {min(center.x + (int) (size*0.5), image.cols), min(center.y + (int) (size*0.5), image.rows)};
+        rectangle(image, a, b, color, espessura);
+    }
+
+    namespace TemplateMatching
+    {
+        using Faixas::Faixa;
+        using Raspberry::getEscalasGeometricas;
+
+        Mat_<Flt> matchTemplateSame(Mat_<Flt> imagem, Mat_<Flt> modelo, int metodo, Flt backgroundColor = 0.0f);
+
+        std::vector<int> getTodasEscalas(int numEscalas);
+        void matchTemplateFaixa(const Mat_<Flt>& imagem, const Mat_<Flt>& modelo, const Faixa& faixa, Mat_<Flt>& resultado, int metodo);
+
+        void getModeloPreProcessados(Mat_<Flt>& modelo, Mat_<Flt> modelosPreProcessados[], uint8_t numEscalas, float escalas[]);
+        void avaliaEscalas(const Mat_<Flt>& imagem, const Mat_<Flt> modelos[], const std::vector<int>& selecionadas, float escalas[], FindPos corrBuf[]);
+        FindPos getMaxCorrelacao(Mat_<Flt>& frameBufFlt, Mat_<Flt> modelos[], FindPos corrBuf[], int numEscalas, float escalas[]);
+
+        std::vector<FindPos> getDeteccoes(Mat_<Flt>& frameBufFlt, Mat_<Flt> modelos[], int numEscalas, float escalas[],
+                                          float limiar, float sobreposicaoMax = 0.3f, size_t maxDeteccoes = 8);
+
+        /*
+         * Busca adaptativa das escalas: uma passada grossa, com o quadro e os modelos na metade da resolução, estima a
+         * correlação de cada escala. Na resolução completa as escalas são avaliadas em lotes, da maior estimativa para a menor
+         * (no empate a mais barata primeiro), até a estimativa mais a margem não superar a melhor correlação já encontrada
+         * ou a melhor atingir a confiança alvo. A margem é empírica, a correlação grossa não é um limite rigoroso.
+         */
+        class BuscaAdaptativa
+        {
+            private:
+                int numEscalas;
+                float* escalas;
+                float confianca;
+                float margem;
+                std::vector<Mat_<Flt>> modelosGrossos;
+            public:
+                BuscaAdaptativa(Mat_<Flt>& modelo, int numEscalas, float escalas[], float confianca, float margem);
+
+                FindPos busca(Mat_<Flt>& frameBufFlt, Mat_<Flt> modelos[], FindPos corrBuf[], int* avaliadas = nullptr) const;
+                void atualizaEscala(int n, const Mat_<Flt>& modeloEscala);
+        };
+
+        /*
+         * Adaptação do modelo à aparência atual do alvo: o recorte da detecção é misturado ao modelo somente na escala
+         * detectada, que é pré-processada de novo sozinha. Após perdaMax quadros sem detecção as escalas adaptadas
+         * voltam ao modelo original, assim o modelo não deriva para o fundo.
+         */
+        class ModeloAdaptativo
+        {
+            private:
+                int numEscalas;
+                float* escalas;
+                float taxa;
+                int perdaMax;
+                int perdidos = 0;
+                BuscaAdaptativa* busca;
+
+                // Modelo redimensionado de cada escala, antes do pré-processamento
+                std::vector<Mat_<Flt>> originais;
+                std::vector<Mat_<Flt>> atuais;
+                std::vector<bool> adaptadas;
+
+                void atualizaEscala(int n, Mat_<Flt> modelos[]);
+            public:
+                ModeloAdaptativo(Mat_<Flt>& modelo, int numEscalas, float escalas[], float taxa, int perdaMax, BuscaAdaptativa* busca = nullptr);
+
+                int atualiza(const Mat_<Flt>& frameBufFlt, const FindPos* deteccao, Mat_<Flt> modelos[]);
+                void reinicia(Mat_<Flt> modelos[]);
+        };
+    } // namespace TemplateMatching
+} // namespace ImageProcessing
+#endif // BASE
+
+#endif
@@ -0,0 +1,233 @@
+#include "JpegParalelo.hpp"
+
+/* -------- Defines -------- */
+#define JPEG_FATIA_LINHAS_MIN   4   // Linhas de MCUs por fatia, abaixo disso o cabeçalho de cada fatia pesa mais que o ganho
+
+static inline int le16(const Raspberry::Byte* p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+JpegParalelo::JpegParalelo(unsigned numFatias) : numFatias(numFatias)
+{
+}
+
+/*
+ * Intervalo de reinício, em MCUs, para o codificador: uma linha de MCUs, assim todo reinício começa uma linha
+ */
+int JpegParalelo::getIntervaloReinicio(int largura)
+{
+    return (largura + JPEG_MCU_LADO - 1) / JPEG_MCU_LADO;
+}
+
+/*
+ * Separa o JPEG em até numFatias JPEGs independentes, cortados em reinícios no início de linhas de MCUs.
+ * Retorna falso quando o JPEG não pode ser fatiado, nesse caso as fatias não têm significado
+ */
+bool JpegParalelo::fatia(const Raspberry::Byte* dados, size_t numBytes, unsigned numFatias, std::vector<Fatia>& fatias, int& largura, int& altura)
+{
+    if (numBytes < 4 || dados[0] != 0xFF || dados[1] != 0xD8) {
+        return false;
+    }
+
+    // Cabeçalho até o início da varredura: dimensões, amostragem e intervalo de reinício
+    size_t pos = 2, posAltura = 0, inicioEntropia = 0;
+    int intervalo = 0, componentes = 0, hMax = 1, vMax = 1;
+    largura = altura = 0;
+
+    while (inicioEntropia == 0) {
+        while (pos + 1 < numBytes && dados[pos] == 0xFF && dados[pos + 1] == 0xFF) {
+            pos++;
+        }
+        if (pos + 4 > numBytes || dados[pos] != 0xFF) {
+            return false;
+        }
+
+        Raspberry::Byte marcador = dados[pos + 1];
+        size_t tamanho = le16(dados + pos + 2);
+        if (tamanho < 2 || pos + 2 + tamanho > numBytes) {
+            return false;
+        }
+
+        // O tamanho conta os seus 2 bytes, cada segmento é lido somente depois de verificar os bytes que ele indexa
+        const Raspberry::Byte* segmento = dados + pos + 4;
+
+        switch (marcador) {
+            case 0xC0:  // Sequencial baseline e estendido com Huffman
+            case 0xC1:
+                // Precisão, altura, largura e componentes, seguidos de 3 bytes por componente
+                if (tamanho < 8) {
+                    return false;
+                }
+
+                componentes = segmento[5];
+                if (tamanho < 8u + 3*componentes) {
+                    return false;
+                }
+
+                altura = le16(segmento + 1);
+                largura = le16(segmento + 3);
+                posAltura = pos + 5;
+
+                for (auto c = 0; c < componentes; c++) {
+                    hMax = std::max(hMax, segmento[7 + 3*c] >> 4);
+                    vMax = std::max(vMax, segmento[7 + 3*c] & 0x0f);
+                }
+                break;
+            case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:     // Progressivo, sem perdas, hierárquico e aritmético
+            case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+                return false;
+            case 0xDD:
+                if (tamanho < 4) {
+                    return false;
+                }
+                intervalo = le16(segmento);
+                break;
+            case 0xDA:
+                // Uma única varredura com todas as componentes
+                if (posAltura == 0 || tamanho < 3 || segmento[0] != componentes) {
+                    return false;
+                }
+                inicioEntropia = pos + 2 + tamanho;
+                break;
+            default:
+                break;
+        }
+
+        pos += 2 + tamanho;
+    }
+
+    if (intervalo == 0 || largura == 0 || altura == 0) {
+        return false;
+    }
+
+    // Trechos entre os reinícios: [inicios[k], fins[k]), os bytes 0xFF 0x00 são dados e 0xFF 0xFF preenchimento
+    std::vector<size_t> inicios{inicioEntropia}, fins;
+    size_t fim = 0;
+
+    for (size_t i = inicioEntropia; i + 1 < numBytes; i++) {
+        if (dados[i] != 0xFF || dados[i + 1] == 0xFF) {
+            continue;
+        }
+
+        Raspberry::Byte b = dados[++i];
+        if (b >= 0xD0 && b <= 0xD7) {
+            fins.push_back(i - 1);
+            inicios.push_back(i + 1);
+        }
+        else if (b == 0xD9) {
+            fim = i - 1;
+            break;
+        }
+        else if (b != 0x00) {
+            return false;
+        }
+    }
+
+    if (fim == 0) {
+        return false;
+    }
+    fins.push_back(fim);
+
+    // Com uma componente o MCU é um único bloco 8x8
+    if (componentes == 1) {
+        hMax = vMax = 1;
+    }
+
+    const size_t mcusPorLinha = (largura + 8*hMax - 1) / (8*hMax);
+    const size_t linhasMcu = (altura + 8*vMax - 1) / (8*vMax);
+    const size_t numTrechos = inicios.size();
+
+    if (numTrechos != (mcusPorLinha*linhasMcu + intervalo - 1) / intervalo) {
+        return false;
+    }
+
+    // Cortes nos trechos que começam uma linha de MCUs, o mais perto possível de linhas iguais por fatia
+    numFatias = std::min<size_t>(numFatias, std::max<size_t>(1, linhasMcu / JPEG_FATIA_LINHAS_MIN));
+
+    std::vector<size_t> cortes{0};
+    for (size_t k = 1; k < numTrechos && cortes.size() < numFatias; k++) {
+        size_t mcu = k*intervalo;
+
+        if (mcu % mcusPorLinha == 0 && (mcu / mcusPorLinha)*numFatias >= cortes.size()*linhasMcu) {
+            cortes.push_back(k);
+        }
+    }
+
+    if (cortes.size() < 2) {
+        return false;
+    }
+    cortes.push_back(numTrechos);
+
+    // Cada fatia: o cabeçalho com a sua altura, os seus trechos com os RST renumerados e o fim da imagem
+    fatias.resize(cortes.size() - 1);
+
+    for (size_t f = 0; f < fatias.size(); f++) {
+        size_t a = cortes[f], b = cortes[f + 1];
+        int linhaFim = b == numTrechos ? altura : int(b*intervalo / mcusPorLinha)*8*vMax;
+
+        Fatia& fatia = fatias[f];
+        fatia.linha = int(a*intervalo / mcusPorLinha)*8*vMax;
+        fatia.linhas = linhaFim - fatia.linha;
+
+        fatia.jpeg.assign(dados, dados + inicioEntropia);
+        fatia.jpeg[posAltura] = Raspberry::Byte(fatia.linhas >> 8);
+        fatia.jpeg[posAltura + 1] = Raspberry::Byte(fatia.linhas & 0xff);
+
+        for (size_t k = a; k < b; k++) {
+            fatia.jpeg.insert(fatia.jpeg.end(), dados + inicios[k], dados + fins[k]);
+
+            if (k + 1 < b) {
+                fatia.jpeg.push_back(0xFF);
+                fatia.jpeg.push_back(Raspberry::Byte(0xD0 + ((k - a) & 7)));
+            }
+        }
+
+        fatia.jpeg.push_back(0xFF);
+        fatia.jpeg.push_back(0xD9);
+    }
+
+    return true;
+}
+
+/*
+ * Decodifica o JPEG em imagem, com as fatias em paralelo quando possível. A imagem é reaproveitada quando já tem o
+ * tamanho do quadro. Retorna verdadeiro quando a decodificação foi paralela
+ */
+bool JpegParalelo::decodifica(const Raspberry::Byte* dados, size_t numBytes, Mat_<Raspberry::Cor>& imagem)
+{
+    ThreadPool& pool = ThreadPool::global();
+    unsigned maxFatias = numFatias > 0 ? numFatias : pool.getNumThreads();
+    int largura, altura;
+
+    quadros++;
+
+    if (maxFatias > 1 && fatia(dados, numBytes, maxFatias, fatias, largura, altura)) {
+        imagem.create(altura, largura);
+        std::atomic<bool> ok{true};
+
+        pool.paraleloPara(fatias.size(), 1, [&](size_t inicio, size_t fim) {
+            for (auto f = inicio; f < fim; f++) {
+                // Com o tamanho certo o imdecode escreve direto na faixa do quadro
+                Mat destino = imagem.rowRange(fatias[f].linha, fatias[f].linha + fatias[f].linhas);
+                Mat saida = destino;
+                imdecode(fatias[f].jpeg, IMREAD_COLOR, &saida);
+
+                if (saida.rows != destino.rows || saida.cols != destino.cols || saida.type() != destino.type()) {
+                    ok = false;
+                }
+                else if (saida.data != destino.data) {
+                    saida.copyTo(destino);
+                }
+            }
+        });
+
+        if (ok) {
+            paralelos++;
+            return true;
+        }
+    }
+
+    imagem = imdecode(Mat(1, numBytes, CV_8U, const_cast<Raspberry::Byte*>(dados)), IMREAD_COLOR);
+    return false;
+}
@@ -0,0 +1,48 @@
+#ifndef JPEG_PARALELO_HPP
+#define JPEG_PARALELO_HPP
+
+#include "Raspberry.hpp"
+
+/* -------- Defines -------- */
+#define JPEG_MCU_LADO   16  // [pixels] Lado do MCU do JPEG 4:2:0, o padrão do imencode
+
+/*
+ * Decodificação paralela de JPEGs com marcadores de reinício (RST). Em cada reinício o codificador zera os preditores,
+ * então um trecho que começa em um reinício no início de uma linha de MCUs é decodificável sozinho: ele recebe o
+ * cabeçalho original, com a altura trocada pela do trecho, e os seus RST renumerados a partir de zero. Cada fatia é
+ * decodificada em uma tarefa do pool direto na sua faixa de linhas do quadro, que é reaproveitado entre os quadros.
+ * JPEGs sem reinícios alinhados às linhas, progressivos ou com mais de uma varredura usam o imdecode comum.
+ */
+class JpegParalelo
+{
+    public:
+        /*
+         * Fatia do quadro: linhas [linha, linha + linhas) e o JPEG que as contém
+         */
+        typedef struct
+        {
+            int linha;
+            int linhas;
+            std::vector<Raspberry::Byte> jpeg;
+        } Fatia;
+
+    private:
+        unsigned numFatias;
+        std::vector<Fatia> fatias;
+
+        uint64_t quadros = 0;
+        uint64_t paralelos = 0;
+    public:
+        explicit JpegParalelo(unsigned numFatias = 0);
+
+        bool decodifica(const Raspberry::Byte* dados, size_t numBytes, Mat_<Raspberry::Cor>& imagem);
+        bool decodifica(const std::vector<Raspberry::Byte>& jpeg, Mat_<Raspberry::Cor>& imagem) { return decodifica(jpeg.data(), jpeg.size(), imagem); }
+
+        uint64_t getQuadros() const { return quadros; }
+        uint64_t getParalelos() const { return paralelos; }
+
+        static int getIntervaloReinicio(int largura);
+        static bool fatia(const Raspberry::Byte* dados, size_t numBytes, unsigned numFatias, std::vector<Fatia>& fatias, int& largura, int& altura);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "MNIST.hpp"
+
+#ifdef BASE
+namespace MNIST
+{
+    /*
+     * Recorta a imagem para obter o numero MNIST no ponto passado, retorna ele no formato MNIST
+     */
+    Mat_<Raspberry::Flt> getMNIST(Mat_<Raspberry::Flt>& imagem, Point center, float size)
+    {
+        // Cálculo dos pontos de recorte
+        Point a {std::max(int(center.x - size*0.5), 0), std::max(int(center.y - size*0.5), 0)};      
+        Point b {std::min(int(center.x + size*0.5), imagem.cols), std::min(int(center.y + size*0.5), imagem.rows)};
+
+        // Recorte da imagem usando as coordenadas calculadas
+        Rect region(a.x, a.y, b.x - a.x, b.y - a.y); // Definir a região do recorte
+        Mat_<Raspberry::Flt> mnist_num = imagem(region);  
+        
+        // Redimendiona a imagem para o tamanho das imagens MNIST
+        resize(mnist_num, mnist_num, Size(MNIST_SIZE, MNIST_SIZE), INTER_CUBIC);    
+        
+        Mat mnist_int;
+        mnist_num.convertTo(mnist_int, CV_8UC1, 255.0);    
+
+        // Satura os pixeis de forma inteligente, isso torna o reconhecimento mais resistente a variações no brilho.
+        adaptiveThreshold(mnist_int, mnist_int, 255, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY_INV, 9, 2);        
+        
+        mnist_int.convertTo(mnist_num, CV_32F, 1.0 / 255.0);
+        return mnist_num;
+    }
+
+    /*
+     * Realiza a inferência do MNIST passado
+     */
+    int inferencia(Mat_<Raspberry::Flt>& imagem, torch::jit::script::Module& module)
+    {
+        // Converte o tipo para poder inserir no modelo
+        torch::jit::IValue numEncontradoTensor = torch::from_blob(imagem.data, {1, 1, MNIST_SIZE, MNIST_SIZE}, torch::kFloat);
+
+        torch::Tensor outputTensor = module.forward({numEncontradoTensor}).toTensor();
+
+        // Obtém o numero predito
+        return outputTensor.argmax(1).item<int>();
+    }
+
+    /*
+     * Realiza a inferência de vários MNIST em um único lote, retorna os números preditos na mesma ordem
+     */
+    std::vector<int> inferencia(std::vector<Mat_<Raspberry::Flt>>& imagens, torch::jit::script::Module& module)
+    {
+        std::vector<int> preditos;
+        if (imagens.empty()) {
+            return preditos;
+        }
+
+        // Monta o lote com as imagens contíguas
+        int64_t lote = imagens.size();
+        torch::Tensor loteTensor = torch::empty({lote, 1, MNIST_SIZE, MNIST_SIZE}, torch::kFloat);
+        float* dados = loteTensor.data_ptr<float>();
+
+        for (int64_t i = 0; i < lote; i++) {
+            Mat_<Raspberry::Flt> imagem = imagens[i].isContinuous() ? imagens[i] : imagens[i].clone();
+            memcpy(dados + i*MNIST_SIZE*MNIST_SIZE, imagem.data, MNIST_SIZE*MNIST_SIZE*sizeof(float));
+        }
+
+        torch::Tensor outputTensor = module.forward({loteTensor}).toTensor();
+        torch::Tensor numeros = outputTensor.argmax(1);
+
+        for (int64_t i = 0; i < lote; i++) {
+            preditos.push_back(numeros[i].item<int>());
+        }
+
+        return preditos;
+    }
+} // namespace MNIST
+#endif // BASE
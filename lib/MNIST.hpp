@@ -0,0 +1,21 @@
+#ifndef MNIST_HPP
+#define MNIST_HPP
+
+#include "Raspberry.hpp"
+
+#ifdef BASE
+#include <torch/script.h>
+
+/*
+ * Recorte e classificação dos números no formato MNIST, pelo LeNet-5 carregado com o torch::jit
+ */
+namespace MNIST
+{
+    Mat_<Raspberry::Flt> getMNIST(Mat_<Raspberry::Flt>& imagem, Point center, float size);
+
+    int inferencia(Mat_<Raspberry::Flt>& imagem, torch::jit::script::Module& module);
+    std::vector<int> inferencia(std::vector<Mat_<Raspberry::Flt>>& imagens, torch::jit::script::Module& module);
+} // namespace MNIST
+#endif // BASE
+
+#endif
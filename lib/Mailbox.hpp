@@ -0,0 +1,83 @@
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Caixa de último valor, lock-free, para um único produtor e um único consumidor (buffer triplo).
+ * Cada valor publicado recebe um número de sequência crescente, o consumidor sempre obtém o valor
+ * mais recente e os valores sobrescritos antes de serem lidos são contabilizados pelos saltos na sequência.
+ */
+template <typename T>
+class Mailbox
+{
+    private:
+        static constexpr uint8_t INDICE = 0x3;
+        static constexpr uint8_t NOVO   = 0x4;
+
+        typedef struct
+        {
+            T valor;
+            uint64_t sequencia;
+        } Slot;
+
+        Slot slots[3];
+
+        // Slot intermediário trocado entre produtor e consumidor, com o bit NOVO quando ainda não foi lido
+        alignas(64) std::atomic<uint8_t> meio{1};
+
+        // Estado do produtor
+        alignas(64) uint8_t escrita = 0;
+        uint64_t proximaSequencia = 1;
+
+        // Estado do consumidor
+        alignas(64) uint8_t leitura = 2;
+        uint64_t ultimaSequencia = 0;
+        uint64_t sobrescritos = 0;
+    public:
+        /*
+         * Publica um novo valor, retorna o seu número de sequência - somente o produtor
+         */
+        uint64_t publica(const T& valor)
+        {
+            slots[escrita].valor = valor;
+            slots[escrita].sequencia = proximaSequencia;
+            escrita = meio.exchange(escrita | NOVO, std::memory_order_acq_rel) & INDICE;
+            return proximaSequencia++;
+        }
+
+        /*
+         * Obtém o valor mais recente, caso não haja valor novo retorna falso - somente o consumidor
+         */
+        bool consome(T& valor, uint64_t* sequencia = nullptr)
+        {
+            if (!(meio.load(std::memory_order_relaxed) & NOVO)) {
+                return false;
+            }
+
+            leitura = meio.exchange(leitura, std::memory_order_acq_rel) & INDICE;
+
+            const Slot& slot = slots[leitura];
+            sobrescritos += slot.sequencia - ultimaSequencia - 1;
+            ultimaSequencia = slot.sequencia;
+            valor = slot.valor;
+
+            if (sequencia != nullptr) {
+                *sequencia = ultimaSequencia;
+            }
+            return true;
+        }
+
+        /*
+         * Quantidade de valores publicados que foram sobrescritos antes de serem lidos - somente o consumidor
+         */
+        uint64_t getSobrescritos() const { return sobrescritos; }
+
+        /*
+         * Sequência do último valor lido - somente o consumidor
+         */
+        uint64_t getUltimaSequencia() const { return ultimaSequencia; }
+};
+
+#endif
@@ -0,0 +1,127 @@
+# Configurações de otimização opcionais, comuns à Base e à Rasp. Sem nenhuma delas continua o Release com -Os.
+#   -DOTIMIZACAO_O3=ON  Release com -O3 no lugar do -Os
+#   -DLTO=ON            Otimização no link, entre a biblioteca Comum e os executáveis
+#   -DPGO=GERA          Compila instrumentado, o alvo pgo-treino roda o Replay e grava o perfil em PGO_DIR
+#   -DPGO=USA           Compila com o perfil de PGO_DIR, no mesmo diretório de build em que ele foi gerado
+#   -DCONFIGURACAO=...  Troca parâmetros do Configuracao.hpp, ex: "NUM_ESCALAS=24;ESCALA_MIN=0.05f". As escalas e os
+#                       kernels especializados da correlação são gerados na compilação a partir deles
+# Incluído depois das flags do Release e antes da pasta lib, para valer para a biblioteca e para os executáveis.
+option(OTIMIZACAO_O3 "Release com -O3 no lugar do -Os" OFF)
+option(LTO "Otimização no link" OFF)
+
+set(PGO "NAO" CACHE STRING "Otimização guiada por perfil: NAO, GERA ou USA")
+set_property(CACHE PGO PROPERTY STRINGS NAO GERA USA)
+set(PGO_DIR "${CMAKE_BINARY_DIR}/pgo" CACHE PATH "Diretório dos perfis do PGO")
+
+# Quadros do Replay, vídeo ou sequência de imagens (ex: <diretório do Base --grava>/quadro_%05d.jpg), vazio usa os sintéticos
+set(REPLAY_GRAVACAO "" CACHE STRING "Gravação reproduzida pelo replay e pelo pgo-treino")
+set(REPLAY_VOLTAS 3 CACHE STRING "Vezes que o replay e o pgo-treino percorrem os quadros")
+
+set(CONFIGURACAO "" CACHE STRING "Parâmetros do Configuracao.hpp trocados na compilação")
+
+if(CONFIGURACAO)
+    add_compile_definitions(${CONFIGURACAO})
+endif()
+
+if(OTIMIZACAO_O3)
+    string(REPLACE "-Os" "-O3" CMAKE_CXX_FLAGS_RELEASE "${CMAKE_CXX_FLAGS_RELEASE}")
+endif()
+
+if(LTO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT LTO_SUPORTADO OUTPUT LTO_ERRO LANGUAGES CXX)
+
+    if(NOT LTO_SUPORTADO)
+        message(FATAL_ERROR "LTO não suportado: ${LTO_ERRO}")
+    endif()
+
+    set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
+endif()
+
+if(PGO STREQUAL "GERA" OR PGO STREQUAL "USA")
+    if(NOT CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        message(FATAL_ERROR "PGO: somente com o GCC")
+    endif()
+
+    if(PGO STREQUAL "GERA")
+        # Contadores atômicos, o pool de threads executa os mesmos kernels ao mesmo tempo
+        add_compile_options(-fprofile-generate=${PGO_DIR} -fprofile-update=atomic)
+        add_link_options(-fprofile-generate=${PGO_DIR})
+    else()
+        if(NOT EXISTS ${PGO_DIR})
+            message(FATAL_ERROR "PGO: perfil não encontrado em ${PGO_DIR}, compile com -DPGO=GERA e rode o alvo pgo-treino")
+        endif()
+
+        # O código que o treino não executa continua otimizado normalmente, e não só para tamanho
+        add_compile_options(-fprofile-use=${PGO_DIR} -Wno-missing-profile)
+        CHECK_CXX_COMPILER_FLAG("-fprofile-partial-training" COMPILER_SUPPORTS_PARTIAL_TRAINING)
+
+        if(COMPILER_SUPPORTS_PARTIAL_TRAINING)
+            add_compile_options(-fprofile-partial-training)
+        endif()
+    endif()
+elseif(NOT PGO STREQUAL "NAO")
+    message(FATAL_ERROR "PGO deve ser NAO, GERA ou USA")
+endif()
+
+message(STATUS "Otimização: ${CMAKE_BUILD_TYPE} (${CMAKE_CXX_FLAGS_RELEASE}), LTO ${LTO}, PGO ${PGO}")
+
+# Alvo replay, que mede o tempo por quadro do programa, o replay-resolucoes, que repete a medida em cada resolução, o
+# replay-otimizacao, que compara as otimizações, e com PGO=GERA o pgo-treino, que coleta o perfil
+function(adiciona_replay programa)
+    set(argumentos --voltas ${REPLAY_VOLTAS})
+    if(REPLAY_GRAVACAO)
+        list(APPEND argumentos --quadros ${REPLAY_GRAVACAO})
+    endif()
+
+    add_custom_target(replay
+        COMMAND ${programa} ${argumentos}
+        DEPENDS ${programa}
+        USES_TERMINAL)
+
+    # Vazão do caminho do programa em função da resolução, as escalas acompanham a largura como na negociação com a Pi
+    add_custom_target(replay-resolucoes
+        COMMAND ${programa} ${argumentos} --resolucao 320x240
+        COMMAND ${programa} ${argumentos} --resolucao 640x480
+        COMMAND ${programa} ${argumentos} --resolucao 1280x720
+        DEPENDS ${programa}
+        USES_TERMINAL)
+
+    # Mede o ganho das otimizações: o replay compilado em diretórios próprios com o Release padrão (-Os), com -O3 e LTO,
+    # e com -O3, LTO e PGO, nos mesmos quadros. Cada um imprime o seu tempo por quadro depois do título
+    set(comparacao ${CMAKE_BINARY_DIR}/otimizacao)
+
+    # As configurações repassadas vão por um script de cache (-C), no COMMAND uma lista como o CONFIGURACAO seria
+    # dividida em argumentos a cada ';'
+    set(repassadas ${comparacao}/repassadas.cmake)
+    file(WRITE ${repassadas}
+        "set(CMAKE_BUILD_TYPE Release CACHE STRING \"\" FORCE)\n"
+        "set(REPLAY_GRAVACAO [==[${REPLAY_GRAVACAO}]==] CACHE STRING \"\" FORCE)\n"
+        "set(REPLAY_VOLTAS [==[${REPLAY_VOLTAS}]==] CACHE STRING \"\" FORCE)\n"
+        "set(CONFIGURACAO [==[${CONFIGURACAO}]==] CACHE STRING \"\" FORCE)\n")
+
+    add_custom_target(replay-otimizacao
+        COMMAND ${CMAKE_COMMAND} -S ${CMAKE_SOURCE_DIR} -B ${comparacao}/os -C ${repassadas}
+        COMMAND ${CMAKE_COMMAND} --build ${comparacao}/os --target ${programa}
+        COMMAND ${CMAKE_COMMAND} -S ${CMAKE_SOURCE_DIR} -B ${comparacao}/o3-lto -C ${repassadas} -DOTIMIZACAO_O3=ON -DLTO=ON
+        COMMAND ${CMAKE_COMMAND} --build ${comparacao}/o3-lto --target ${programa}
+        COMMAND ${CMAKE_COMMAND} -S ${CMAKE_SOURCE_DIR} -B ${comparacao}/pgo -C ${repassadas} -DOTIMIZACAO_O3=ON -DLTO=ON -DPGO=GERA
+        COMMAND ${CMAKE_COMMAND} --build ${comparacao}/pgo --target pgo-treino
+        COMMAND ${CMAKE_COMMAND} -S ${CMAKE_SOURCE_DIR} -B ${comparacao}/pgo -C ${repassadas} -DOTIMIZACAO_O3=ON -DLTO=ON -DPGO=USA
+        COMMAND ${CMAKE_COMMAND} --build ${comparacao}/pgo --target ${programa}
+        COMMAND ${CMAKE_COMMAND} -E echo "== Release -Os =="
+        COMMAND ${comparacao}/os/${programa} ${argumentos}
+        COMMAND ${CMAKE_COMMAND} -E echo "== -O3 e LTO =="
+        COMMAND ${comparacao}/o3-lto/${programa} ${argumentos}
+        COMMAND ${CMAKE_COMMAND} -E echo "== -O3, LTO e PGO =="
+        COMMAND ${comparacao}/pgo/${programa} ${argumentos}
+        USES_TERMINAL)
+
+    if(PGO STREQUAL "GERA")
+        add_custom_target(pgo-treino
+            COMMAND ${CMAKE_COMMAND} -E remove_directory ${PGO_DIR}
+            COMMAND ${programa} ${argumentos}
+            DEPENDS ${programa}
+            USES_TERMINAL)
+    endif()
+endfunction()
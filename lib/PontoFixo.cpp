@@ -0,0 +1,412 @@
+#include "PontoFixo.hpp"
+#include "Configuracao.hpp"
+
+#include <numeric>
+#include <utility>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+ * Converte o quadro colorido para cinza de 8 bits
+ */
+void PontoFixo::getCinza(const Mat_<Raspberry::Cor>& entrada, Mat_<Pixel>& saida)
+{
+    cvtColor(entrada, saida, COLOR_BGR2GRAY);
+}
+
+/*
+ * Pré-processa o modelo em cada escala: remove o nível DC dos pixels que não são dontcare, zera os dontcare
+ * e quantiza para que o maior coeficiente em módulo seja PONTO_FIXO_COEF_MAX
+ */
+void PontoFixo::getModelos(const Mat_<Pixel>& modelo, Modelo modelos[], int numEscalas, const float escalas[])
+{
+    // Os kernels somam cada linha do modelo em int32 antes de acumular em int64
+    for (auto i = 0; i < numEscalas; i++) {
+        if (std::lround(modelo.cols*escalas[i]) > PONTO_FIXO_COLUNAS_MAX) {
+            throw std::runtime_error("PontoFixo: Erro modelo com mais de " + std::to_string(PONTO_FIXO_COLUNAS_MAX) + " colunas na escala " + std::to_string(escalas[i]) + "!");
+        }
+    }
+
+    ThreadPool::global().paraleloPara(numEscalas, 1, [&](size_t primeiro, size_t fim) {
+        for (auto i = primeiro; i < fim; i++) {
+            Mat_<Pixel> temp;
+            resize(modelo, temp, Size(), escalas[i], escalas[i], INTER_NEAREST);
+
+            double soma = 0.0;
+            int numValidos = 0;
+            for (auto it = temp.begin(); it != temp.end(); it++) {
+                if (*it != PONTO_FIXO_DONTCARE) {
+                    soma += *it;
+                    numValidos++;
+                }
+            }
+            double media = numValidos > 0 ? soma / numValidos : 0.0;
+
+            double maximo = 0.0;
+            for (auto it = temp.begin(); it != temp.end(); it++) {
+                if (*it != PONTO_FIXO_DONTCARE) {
+                    maximo = std::max(maximo, std::abs(*it - media));
+                }
+            }
+            double fator = maximo > 0.0 ? PONTO_FIXO_COEF_MAX / maximo : 0.0;
+
+            Modelo& saida = modelos[i];
+            saida.coef.create(temp.size());
+            saida.somaCoef = 0;
+
+            int64_t norma2 = 0;
+            for (auto y = 0; y < temp.rows; y++) {
+                for (auto x = 0; x < temp.cols; x++) {
+                    Pixel p = temp(y, x);
+                    Coef c = p != PONTO_FIXO_DONTCARE ? std::lround((p - media)*fator) : 0;
+
+                    saida.coef(y, x) = c;
+                    saida.somaCoef += c;
+                    norma2 += int64_t(c)*c;
+                }
+            }
+            saida.norma = std::sqrt(double(norma2));
+        }
+    });
+}
+
+/*
+ * Imagens integrais da soma e da soma dos quadrados dos pixels
+ */
+void PontoFixo::getIntegrais(const Mat_<Pixel>& imagem, Integrais& integrais)
+{
+    integral(imagem, integrais.soma, integrais.somaQuadrados, CV_32S, CV_64F);
+}
+
+/*
+ * Chama f(u) para u de 0 a N-1, desenrolado na compilação
+ */
+template <typename F, int... U>
+static inline void desenrola(F&& f, std::integer_sequence<int, U...>)
+{
+    (f(U), ...);
+}
+
+/*
+ * Percorre as colunas do modelo, desenroladas quando a largura é fixa e pequena
+ */
+template <int COLUNAS, typename F>
+static inline void paraCadaColuna(int colunas, F&& f)
+{
+    if constexpr (COLUNAS > 0 && COLUNAS <= PONTO_FIXO_DESENROLA_MAX) {
+        desenrola(f, std::make_integer_sequence<int, COLUNAS>{});
+    }
+    else {
+        for (auto u = 0; u < colunas; u++) {
+            f(u);
+        }
+    }
+}
+
+/*
+ * Σ coef*pixel das janelas da linha y, para as posições [0, largura). Com LINHAS e COLUNAS maiores que zero
+ * o tamanho do modelo é fixo na compilação, com zero ele vem do modelo
+ */
+template <int LINHAS, int COLUNAS>
+static void somaProdutos(const Mat_<PontoFixo::Pixel>& imagem, const PontoFixo::Modelo& modelo, int y, int largura, int32_t* acc)
+{
+    const int linhasModelo = LINHAS > 0 ? LINHAS : modelo.coef.rows;
+    const int colunasModelo = COLUNAS > 0 ? COLUNAS : modelo.coef.cols;
+    int x = 0;
+
+#ifdef __ARM_NEON
+    // Oito posições por vez com os acumuladores em registradores, os coeficientes zero (dontcare) são pulados
+    for (; x + 8 <= largura; x += 8) {
+        int32x4_t a0 = vdupq_n_s32(0);
+        int32x4_t a1 = vdupq_n_s32(0);
+
+        for (auto v = 0; v < linhasModelo; v++) {
+            const PontoFixo::Pixel* linha = imagem[y + v] + x;
+            const PontoFixo::Coef* c = modelo.coef[v];
+
+            paraCadaColuna<COLUNAS>(colunasModelo, [&](int u) {
+                if (c[u] != 0) {
+                    int16x8_t p = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(linha + u)));
+                    a0 = vmlal_n_s16(a0, vget_low_s16(p), c[u]);
+                    a1 = vmlal_n_s16(a1, vget_high_s16(p), c[u]);
+                }
+            });
+        }
+
+        vst1q_s32(acc + x, a0);
+        vst1q_s32(acc + x + 4, a1);
+    }
+#endif
+
+    // Escalar, acumula a linha inteira por coeficiente, forma que o compilador consegue vetorizar
+    std::fill(acc + x, acc + largura, 0);
+
+    for (auto v = 0; v < linhasModelo; v++) {
+        const PontoFixo::Pixel* linha = imagem[y + v];
+        const PontoFixo::Coef* c = modelo.coef[v];
+
+        paraCadaColuna<COLUNAS>(colunasModelo, [&](int u) {
+            if (c[u] != 0) {
+                const int32_t coef = c[u];
+                const PontoFixo::Pixel* p = linha + u;
+                for (auto k = x; k < largura; k++) {
+                    acc[k] += coef*p[k];
+                }
+            }
+        });
+    }
+}
+
+/*
+ * Σ coef*pixel em int64, para os modelos acima de PONTO_FIXO_AREA_INT32, onde a soma em int32 pode estourar.
+ * Cada linha do modelo é somada em int32, o que sempre cabe (PONTO_FIXO_COLUNAS_MAX), e só então acumulada em int64
+ */
+static void somaProdutosLongo(const Mat_<PontoFixo::Pixel>& imagem, const PontoFixo::Modelo& modelo, int y, int largura, int64_t* acc)
+{
+    const int colunasModelo = modelo.coef.cols;
+    int x = 0;
+
+#ifdef __ARM_NEON
+    for (; x + 8 <= largura; x += 8) {
+        int64x2_t a[4] = {vdupq_n_s64(0), vdupq_n_s64(0), vdupq_n_s64(0), vdupq_n_s64(0)};
+
+        for (auto v = 0; v < modelo.coef.rows; v++) {
+            const PontoFixo::Pixel* linha = imagem[y + v] + x;
+            const PontoFixo::Coef* c = modelo.coef[v];
+            int32x4_t p0 = vdupq_n_s32(0);
+            int32x4_t p1 = vdupq_n_s32(0);
+
+            for (auto u = 0; u < colunasModelo; u++) {
+                if (c[u] != 0) {
+                    int16x8_t p = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(linha + u)));
+                    p0 = vmlal_n_s16(p0, vget_low_s16(p), c[u]);
+                    p1 = vmlal_n_s16(p1, vget_high_s16(p), c[u]);
+                }
+            }
+
+            a[0] = vaddw_s32(a[0], vget_low_s32(p0));
+            a[1] = vaddw_s32(a[1], vget_high_s32(p0));
+            a[2] = vaddw_s32(a[2], vget_low_s32(p1));
+            a[3] = vaddw_s32(a[3], vget_high_s32(p1));
+        }
+
+        for (auto k = 0; k < 4; k++) {
+            vst1q_s64(acc + x + 2*k, a[k]);
+        }
+    }
+#endif
+
+    std::fill(acc + x, acc + largura, 0);
+    std::vector<int32_t> parcial(largura - x);
+
+    for (auto v = 0; v < modelo.coef.rows; v++) {
+        const PontoFixo::Pixel* linha = imagem[y + v];
+        const PontoFixo::Coef* c = modelo.coef[v];
+        std::fill(parcial.begin(), parcial.end(), 0);
+
+        for (auto u = 0; u < colunasModelo; u++) {
+            if (c[u] != 0) {
+                const int32_t coef = c[u];
+                const PontoFixo::Pixel* p = linha + u + x;
+                for (size_t k = 0; k < parcial.size(); k++) {
+                    parcial[k] += coef*p[k];
+                }
+            }
+        }
+
+        for (size_t k = 0; k < parcial.size(); k++) {
+            acc[x + k] += parcial[k];
+        }
+    }
+}
+
+typedef void (*SomaProdutos)(const Mat_<PontoFixo::Pixel>&, const PontoFixo::Modelo&, int, int, int32_t*);
+
+// Escalas e lado do modelo em cada uma, como o resize do getModelos faz com um modelo TEMPLATE_SIZE x TEMPLATE_SIZE
+constexpr auto ESCALAS = Raspberry::getTabelaEscalas<NUM_ESCALAS>(ESCALA_MIN, ESCALA_MAX);
+
+constexpr int getLado(int n)
+{
+    return int(TEMPLATE_SIZE*double(ESCALAS[n]) + 0.5);
+}
+
+/*
+ * Erro relativo da última escala da tabela para ESCALA_MAX, mostra se a raiz do passo convergiu
+ */
+constexpr double getErroEscalaMax()
+{
+    double erro = (double(ESCALAS[NUM_ESCALAS - 1]) - ESCALA_MAX) / ESCALA_MAX;
+    return erro < 0.0 ? -erro : erro;
+}
+
+static_assert(NUM_ESCALAS > 0 && ESCALA_MIN > 0.0f && ESCALA_MIN <= ESCALA_MAX, "PontoFixo: faixa de escalas inválida");
+static_assert(ESCALAS[0] == ESCALA_MIN && getErroEscalaMax() < 1e-4, "PontoFixo: a tabela de escalas não vai de ESCALA_MIN a ESCALA_MAX");
+static_assert(getLado(0) > 0, "PontoFixo: a menor escala deixa o modelo vazio");
+
+/*
+ * Um kernel especializado por escala da configuração
+ */
+template <int... N>
+constexpr std::array<SomaProdutos, sizeof...(N)> getEspecializados(std::integer_sequence<int, N...>)
+{
+    return {&somaProdutos<getLado(N), getLado(N)>...};
+}
+
+constexpr auto ESPECIALIZADOS = getEspecializados(std::make_integer_sequence<int, NUM_ESCALAS>{});
+
+/*
+ * Kernel especializado no tamanho do modelo quando ele é o de uma das escalas da configuração, senão o genérico.
+ * Modelos que não são quadrados de lado getLado(n), como os de um quadro com largura diferente de CAMERA_FRAME_WIDTH
+ * (getFatorEscala) ou de um modelo que não é TEMPLATE_SIZE x TEMPLATE_SIZE, caem sempre no somaProdutos<0, 0>
+ */
+static SomaProdutos getSomaProdutos(const PontoFixo::Modelo& modelo, bool especializado)
+{
+    if (especializado && modelo.coef.rows == modelo.coef.cols) {
+        for (auto n = 0; n < NUM_ESCALAS; n++) {
+            if (modelo.coef.cols == getLado(n)) {
+                return ESPECIALIZADOS[n];
+            }
+        }
+    }
+
+    return &somaProdutos<0, 0>;
+}
+
+/*
+ * Correlação normalizada (TM_CCOEFF_NORMED) das linhas [inicio, fim) da região válida, o resultado tem fim - inicio linhas
+ * e a linha i corresponde ao canto superior esquerdo do modelo na linha inicio + i
+ */
+void PontoFixo::correlaciona(const Mat_<Pixel>& imagem, const Integrais& integrais, const Modelo& modelo, int inicio, int fim, Mat_<float>& resultado,
+                             bool especializado)
+{
+    const int linhasModelo = modelo.coef.rows;
+    const int colunasModelo = modelo.coef.cols;
+    const int largura = imagem.cols - colunasModelo + 1;
+    const double area = modelo.coef.total();
+    const bool longo = modelo.coef.total() > PONTO_FIXO_AREA_INT32;
+
+    resultado.create(fim - inicio, largura);
+    std::vector<int32_t> acc(longo ? 0 : largura);
+    std::vector<int64_t> accLongo(longo ? largura : 0);
+
+    SomaProdutos kernel = getSomaProdutos(modelo, especializado);
+
+    for (auto y = inicio; y < fim; y++) {
+        if (longo) {
+            somaProdutosLongo(imagem, modelo, y, largura, accLongo.data());
+        }
+        else {
+            kernel(imagem, modelo, y, largura, acc.data());
+        }
+
+        const int32_t* s0 = integrais.soma[y];
+        const int32_t* s1 = integrais.soma[y + linhasModelo];
+        const double* q0 = integrais.somaQuadrados[y];
+        const double* q1 = integrais.somaQuadrados[y + linhasModelo];
+        float* r = resultado[y - inicio];
+
+        for (auto x = 0; x < largura; x++) {
+            double soma = s1[x + colunasModelo] - s0[x + colunasModelo] - s1[x] + s0[x];
+            double somaQuadrados = q1[x + colunasModelo] - q0[x + colunasModelo] - q1[x] + q0[x];
+
+            // Σ coef*(pixel - média) e N*variância da janela
+            double numerador = (longo ? double(accLongo[x]) : double(acc[x])) - soma*modelo.somaCoef/area;
+            double variancia = somaQuadrados - soma*soma/area;
+            double denominador = modelo.norma*std::sqrt(std::max(variancia, 0.0));
+
+            r[x] = denominador > 1e-6 ? numerador/denominador : 0.0f;
+        }
+    }
+}
+
+/*
+ * Correlação de toda a região válida, mesmo formato do matchTemplate do OpenCV
+ */
+Mat_<float> PontoFixo::matchTemplate(const Mat_<Pixel>& imagem, const Modelo& modelo)
+{
+    Integrais integrais;
+    getIntegrais(imagem, integrais);
+
+    Mat_<float> resultado;
+    correlaciona(imagem, integrais, modelo, 0, imagem.rows - modelo.coef.rows + 1, resultado);
+    return resultado;
+}
+
+/*
+ * Retorna a posição (centro do modelo) da maior correlação entre todas as escalas, em corrBuf a maior de cada escala
+ */
+Raspberry::FindPos PontoFixo::getMaxCorrelacao(const Mat_<Pixel>& imagem, const Modelo modelos[], Raspberry::FindPos corrBuf[], int numEscalas, const float escalas[])
+{
+    Integrais integrais;
+    getIntegrais(imagem, integrais);
+
+    std::vector<int> todas(numEscalas);
+    std::iota(todas.begin(), todas.end(), 0);
+
+    ThreadPool& pool = ThreadPool::global();
+    std::vector<Faixas::Faixa> faixas = Faixas::getFaixas(imagem, modelos, todas, pool.getNumThreads());
+    std::vector<Raspberry::CorrelacaoPonto> maximos(faixas.size());
+
+    pool.paraleloPara(faixas.size(), 1, [&](size_t primeira, size_t fim) {
+        for (auto f = primeira; f < fim; f++) {
+            const Faixas::Faixa& faixa = faixas[f];
+            const Modelo& modelo = modelos[faixa.escala];
+
+            Mat_<float> correlacao;
+            correlaciona(imagem, integrais, modelo, faixa.inicio, faixa.fim, correlacao);
+            minMaxLoc(correlacao, NULL, &maximos[f].correlacao, NULL, &maximos[f].posicao);
+
+            maximos[f].posicao += Point((modelo.coef.cols - 1)/2, faixa.inicio + (modelo.coef.rows - 1)/2);
+        }
+    });
+
+    for (auto n = 0; n < numEscalas; n++) {
+        corrBuf[n] = Raspberry::FindPos{escalas[n], {-1.0, Point(0, 0)}};
+    }
+
+    for (size_t f = 0; f < faixas.size(); f++) {
+        Raspberry::FindPos& escala = corrBuf[faixas[f].escala];
+        if (maximos[f].correlacao > escala.ponto.correlacao) {
+            escala.ponto = maximos[f];
+        }
+    }
+
+    Raspberry::FindPos maxCorr = corrBuf[0];
+    for (auto i = 1; i < numEscalas; i++) {
+        if (corrBuf[i].ponto.correlacao > maxCorr.ponto.correlacao) {
+            maxCorr = corrBuf[i];
+        }
+    }
+
+    return maxCorr;
+}
+
+/*
+ * Recorta o número no ponto passado no formato MNIST, como o MNIST::getMNIST da Base, mas em 8 bits
+ */
+Mat_<PontoFixo::Pixel> PontoFixo::getRecorte(const Mat_<Pixel>& imagem, Point centro, float tamanho)
+{
+    Point a {std::max(int(centro.x - tamanho*0.5), 0), std::max(int(centro.y - tamanho*0.5), 0)};
+    Point b {std::min(int(centro.x + tamanho*0.5), imagem.cols), std::min(int(centro.y + tamanho*0.5), imagem.rows)};
+
+    Mat_<Pixel> recorte;
+    resize(imagem(Rect(a.x, a.y, b.x - a.x, b.y - a.y)), recorte, Size(MNIST_SIZE, MNIST_SIZE), 0, 0, INTER_CUBIC);
+
+    // Satura os pixeis de forma inteligente, isso torna o reconhecimento mais resistente a variações no brilho.
+    adaptiveThreshold(recorte, recorte, 255, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY_INV, 9, 2);
+    return recorte;
+}
+
+/*
+ * Kernel da correlação compilado
+ */
+const char* PontoFixo::getKernel()
+{
+#ifdef __ARM_NEON
+    return "NEON";
+#else
+    return "escalar";
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef PONTO_FIXO_HPP
+#define PONTO_FIXO_HPP
+
+#include "Raspberry.hpp"
+#include "Faixas.hpp"
+
+/* -------- Defines -------- */
+#define PONTO_FIXO_COEF_MAX     127     // |coef| máximo, com pixels de 8 bits a soma cabe em int32 para modelos de até 256x256
+#define PONTO_FIXO_AREA_INT32   (256*256)   // Modelos maiores, nas resoluções acima de 320x240, acumulam em int64
+#define PONTO_FIXO_COLUNAS_MAX  (INT32_MAX / (PONTO_FIXO_COEF_MAX*255))     // Uma linha do modelo sempre cabe em int32
+#define PONTO_FIXO_DONTCARE     255     // Branco do modelo, ignorado na correlação
+#define PONTO_FIXO_DESENROLA_MAX 32     // Lado máximo do modelo com as colunas desenroladas no kernel especializado
+
+/*
+ * Busca multi-escala em ponto fixo para a Pi: quadro em cinza de 8 bits e modelos sem nível DC quantizados em int16.
+ * A correlação é a mesma TM_CCOEFF_NORMED da busca em float, com as somas do quadro obtidas das imagens integrais.
+ * Os kernels usam NEON quando disponível (__ARM_NEON), senão um laço escalar equivalente. Os lados do modelo nas escalas
+ * da configuração (Configuracao.hpp) têm um kernel especializado, com o tamanho fixo na compilação.
+ */
+namespace PontoFixo
+{
+    typedef uint8_t Pixel;
+    typedef int16_t Coef;
+
+    // Modelo quantizado de uma escala
+    typedef struct
+    {
+        Mat_<Coef> coef;
+        int64_t somaCoef;   // Σ coef, quase zero, corrige o resíduo da quantização do nível DC
+        double norma;       // sqrt(Σ coef²)
+    } Modelo;
+
+    // Imagens integrais do quadro, para a média e a variância de cada janela
+    typedef struct
+    {
+        Mat_<int32_t> soma;
+        Mat_<double> somaQuadrados;
+    } Integrais;
+
+    // Tamanho do modelo para a divisão em faixas (Faixas::getFaixas)
+    inline Size getTamanho(const Modelo& modelo) { return modelo.coef.size(); }
+
+    void getCinza(const Mat_<Raspberry::Cor>& entrada, Mat_<Pixel>& saida);
+    void getModelos(const Mat_<Pixel>& modelo, Modelo modelos[], int numEscalas, const float escalas[]);
+    void getIntegrais(const Mat_<Pixel>& imagem, Integrais& integrais);
+
+    void correlaciona(const Mat_<Pixel>& imagem, const Integrais& integrais, const Modelo& modelo, int inicio, int fim, Mat_<float>& resultado,
+                      bool especializado = true);
+    Mat_<float> matchTemplate(const Mat_<Pixel>& imagem, const Modelo& modelo);
+
+    Raspberry::FindPos getMaxCorrelacao(const Mat_<Pixel>& imagem, const Modelo modelos[], Raspberry::FindPos corrBuf[], int numEscalas, const float escalas[]);
+    Mat_<Pixel> getRecorte(const Mat_<Pixel>& imagem, Point centro, float tamanho);
+
+    const char* getKernel();
+} // namespace PontoFixo
+
+#endif
@@ -0,0 +1,256 @@
+#include "Protocolo.hpp"
+
+#include <random>
+
+/*
+ * Escrevem/leem inteiros na forma Big-Endian no buffer e avançam o ponteiro, os de 32 bits são usados também pelo Device
+ */
+static void escreve8(Raspberry::Byte*& buf, uint8_t valor)
+{
+    *buf++ = valor;
+}
+
+static void escreve16(Raspberry::Byte*& buf, uint16_t valor)
+{
+    uint16_t net_value = htons(valor);
+    memcpy(buf, &net_value, sizeof(uint16_t));
+    buf += sizeof(uint16_t);
+}
+
+void Protocolo::escreve32(Raspberry::Byte*& buf, uint32_t valor)
+{
+    uint32_t net_value = htonl(valor);
+    memcpy(buf, &net_value, sizeof(uint32_t));
+    buf += sizeof(uint32_t);
+}
+
+static uint8_t le8(const Raspberry::Byte*& buf)
+{
+    return *buf++;
+}
+
+static uint16_t le16(const Raspberry::Byte*& buf)
+{
+    uint16_t net_value;
+    memcpy(&net_value, buf, sizeof(uint16_t));
+    buf += sizeof(uint16_t);
+    return ntohs(net_value);
+}
+
+uint32_t Protocolo::le32(const Raspberry::Byte*& buf)
+{
+    uint32_t net_value;
+    memcpy(&net_value, buf, sizeof(uint32_t));
+    buf += sizeof(uint32_t);
+    return ntohl(net_value);
+}
+
+/*
+ * Relógio monotônico em microssegundos, truncado em 32 bits. As diferenças entre dois carimbos continuam certas na
+ * virada, desde que sejam menores que ~71 min
+ */
+uint32_t Protocolo::getCarimbo()
+{
+    using namespace std::chrono;
+    return uint32_t(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+/*
+ * Token de uma sessão nova, aleatório e diferente de zero, que fica reservado para "sem sessão"
+ */
+uint64_t Protocolo::getToken()
+{
+    std::random_device aleatorio;
+    uint64_t token = 0;
+
+    while (token == 0) {
+        token = (uint64_t(aleatorio()) << 32) | aleatorio();
+    }
+    return token;
+}
+
+/*
+ * Intervalo em décimos de milissegundo, saturado em 16 bits (6.5 s)
+ */
+uint16_t Protocolo::getDecimosMs(uint32_t microssegundos)
+{
+    return uint16_t(std::min<uint32_t>(microssegundos / 100, UINT16_MAX));
+}
+
+void Protocolo::escreveCabecalho(Raspberry::Byte* buf, Tipo tipo, uint32_t tamanho)
+{
+    escreve8(buf, tipo);
+    escreve8(buf, PROTOCOLO_VERSAO);
+    escreve32(buf, tamanho);
+}
+
+/*
+ * Lê os PROTOCOLO_CABECALHO bytes do cabeçalho, sem verificá-lo
+ */
+Protocolo::Cabecalho Protocolo::leCabecalho(const Raspberry::Byte* buf)
+{
+    Cabecalho cabecalho;
+    cabecalho.tipo = le8(buf);
+    cabecalho.versao = le8(buf);
+    cabecalho.tamanho = le32(buf);
+    return cabecalho;
+}
+
+/*
+ * Joga uma exceção quando o outro lado fala outra versão ou o tamanho do corpo não faz sentido
+ */
+void Protocolo::verifica(const Cabecalho& cabecalho)
+{
+    if (cabecalho.versao != PROTOCOLO_VERSAO) {
+        throw std::runtime_error("Protocolo: Erro versão " + std::to_string(cabecalho.versao) + " do outro lado, a deste é " + std::to_string(PROTOCOLO_VERSAO) + "!");
+    }
+
+    if (cabecalho.tamanho > PROTOCOLO_CORPO_MAX) {
+        throw std::runtime_error("Protocolo: Erro corpo de " + std::to_string(cabecalho.tamanho) + " bytes, o fluxo está corrompido!");
+    }
+}
+
+void Protocolo::escreveQuadro(Raspberry::Byte* buf, const Quadro& quadro)
+{
+    escreve32(buf, quadro.sequencia);
+    escreve32(buf, quadro.carimbo);
+}
+
+Protocolo::Quadro Protocolo::leQuadro(const Raspberry::Byte* corpo, uint32_t tamanho)
+{
+    if (tamanho < PROTOCOLO_QUADRO) {
+        throw std::runtime_error("Protocolo: Erro mensagem de quadro com " + std::to_string(tamanho) + " bytes!");
+    }
+
+    Quadro quadro;
+    quadro.sequencia = le32(corpo);
+    quadro.carimbo = le32(corpo);
+    return quadro;
+}
+
+/*
+ * Escreve a mensagem de comando inteira, cabeçalho e corpo: PROTOCOLO_CABECALHO + PROTOCOLO_COMANDO bytes
+ */
+void Protocolo::escreveComando(Raspberry::Byte* buf, const Comando& comando)
+{
+    escreveCabecalho(buf, COMANDO, PROTOCOLO_COMANDO);
+    buf += PROTOCOLO_CABECALHO;
+
+    escreveQuadro(buf, comando.quadro);
+    buf += PROTOCOLO_QUADRO;
+
+    escreve8(buf, comando.comando);
+    for (auto i = 0; i < PROTOCOLO_PWMS; i++) {
+        escreve8(buf, comando.pwms[i]);
+    }
+    escreve8(buf, comando.numAlvos);
+    escreve8(buf, uint8_t(comando.numero));
+    escreve16(buf, comando.correlacao);
+    escreve16(buf, comando.escala);
+    escreve16(buf, comando.processamento);
+}
+
+/*
+ * Lê o corpo do comando, bytes além do PROTOCOLO_COMANDO são campos de versões futuras e ficam de fora. Um comando
+ * fora do enum Raspberry::Comando é um fluxo corrompido
+ */
+Protocolo::Comando Protocolo::leComando(const Raspberry::Byte* corpo, uint32_t tamanho)
+{
+    if (tamanho < PROTOCOLO_COMANDO) {
+        throw std::runtime_error("Protocolo: Erro mensagem de comando com " + std::to_string(tamanho) + " bytes!");
+    }
+
+    Comando comando;
+    comando.quadro = leQuadro(corpo, tamanho);
+    corpo += PROTOCOLO_QUADRO;
+
+    uint8_t codigo = le8(corpo);
+    if (codigo > Raspberry::Comando::AUTO_VELOCIDADE) {
+        throw std::runtime_error("Protocolo: Erro comando " + std::to_string(codigo) + " desconhecido!");
+    }
+
+    comando.comando = static_cast<Raspberry::Comando>(codigo);
+    for (auto i = 0; i < PROTOCOLO_PWMS; i++) {
+        comando.pwms[i] = le8(corpo);
+    }
+    comando.numAlvos = le8(corpo);
+    comando.numero = int8_t(le8(corpo));
+    comando.correlacao = le16(corpo);
+    comando.escala = le16(corpo);
+    comando.processamento = le16(corpo);
+    return comando;
+}
+
+/*
+ * Resumo das detecções do quadro no comando: quantos alvos, e a correlação, a escala e o número do principal
+ */
+void Protocolo::setAlvo(Comando& comando, const Raspberry::FindPos* alvo, size_t numAlvos, int numero)
+{
+    comando.numAlvos = uint8_t(std::min<size_t>(numAlvos, UINT8_MAX));
+    comando.numero = alvo != nullptr ? int8_t(numero) : -1;
+    comando.correlacao = alvo != nullptr ? uint16_t(std::clamp(alvo->ponto.correlacao, 0.0, 1.0)*UINT16_MAX + 0.5) : 0;
+    comando.escala = alvo != nullptr ? uint16_t(std::min(alvo->escala*1e4f + 0.5f, float(UINT16_MAX))) : 0;
+}
+
+void Protocolo::escreveSessao(Raspberry::Byte* buf, const Sessao& sessao)
+{
+    escreve32(buf, uint32_t(sessao.token >> 32));
+    escreve32(buf, uint32_t(sessao.token));
+    escreve32(buf, sessao.formato.largura);
+    escreve32(buf, sessao.formato.altura);
+    escreve32(buf, sessao.formato.fps);
+    escreve32(buf, sessao.sequencia);
+    escreve8(buf, sessao.retomada);
+}
+
+Protocolo::Sessao Protocolo::leSessao(const Raspberry::Byte* corpo, uint32_t tamanho)
+{
+    if (tamanho < PROTOCOLO_SESSAO) {
+        throw std::runtime_error("Protocolo: Erro mensagem de sessão com " + std::to_string(tamanho) + " bytes!");
+    }
+
+    Sessao sessao;
+    sessao.token = uint64_t(le32(corpo)) << 32;
+    sessao.token |= le32(corpo);
+    sessao.formato.largura = le32(corpo);
+    sessao.formato.altura = le32(corpo);
+    sessao.formato.fps = le32(corpo);
+    sessao.sequencia = le32(corpo);
+    sessao.retomada = le8(corpo);
+    return sessao;
+}
+
+void Protocolo::escreveAmostra(Raspberry::Byte* buf, const Amostra& amostra)
+{
+    escreve32(buf, amostra.carimbo);
+    escreve16(buf, amostra.cpu);
+    escreve16(buf, uint16_t(amostra.temperatura));
+    escreve16(buf, amostra.latencia);
+    escreve16(buf, amostra.processamento);
+    escreve8(buf, amostra.filaMotor);
+    escreve8(buf, amostra.filaCaptura);
+    escreve32(buf, amostra.filaSocket);
+}
+
+/*
+ * Lê o lote de amostras do corpo do TELEMETRIA e acrescenta elas em amostras
+ */
+void Protocolo::leTelemetria(const Raspberry::Byte* corpo, uint32_t tamanho, std::vector<Amostra>& amostras)
+{
+    if (tamanho % PROTOCOLO_AMOSTRA != 0) {
+        throw std::runtime_error("Protocolo: Erro mensagem de telemetria com " + std::to_string(tamanho) + " bytes!");
+    }
+
+    for (uint32_t i = 0; i < tamanho / PROTOCOLO_AMOSTRA; i++) {
+        Amostra amostra;
+        amostra.carimbo = le32(corpo);
+        amostra.cpu = le16(corpo);
+        amostra.temperatura = int16_t(le16(corpo));
+        amostra.latencia = le16(corpo);
+        amostra.processamento = le16(corpo);
+        amostra.filaMotor = le8(corpo);
+        amostra.filaCaptura = le8(corpo);
+        amostra.filaSocket = le32(corpo);
+        amostras.push_back(amostra);
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef PROTOCOLO_HPP
+#define PROTOCOLO_HPP
+
+#include "Raspberry.hpp"
+
+#include <arpa/inet.h>
+
+/* -------- Defines -------- */
+#define PROTOCOLO_VERSAO        1
+#define PROTOCOLO_CABECALHO     6       // Tipo, versão e o tamanho do corpo em 4 bytes Big-Endian
+#define PROTOCOLO_QUADRO        8       // Sequência e carimbo, no início do corpo do QUADRO e do DETECCOES
+#define PROTOCOLO_COMANDO       21      // Corpo do COMANDO: quadro ecoado, comando, PWMs, resumo do alvo e processamento
+#define PROTOCOLO_AMOSTRA       18      // Bytes por amostra no corpo do TELEMETRIA
+#define PROTOCOLO_SESSAO        25      // Corpo do SESSAO: token, formato da câmera, sequência e retomada
+#define PROTOCOLO_PWMS          4       // Canais da ponte H
+#define PROTOCOLO_CORPO_MAX     (1u << 26)  // Um corpo maior que isso é um fluxo corrompido
+#define PROTOCOLO_SEM_TEMPERATURA   INT16_MIN
+
+/*
+ * Mensagens trocadas entre a Pi e a Base. Cada uma é um cabeçalho [tipo][versão][tamanho] seguido do corpo:
+ *   SESSAO      Base -> Pi  [token][largura][altura][fps][0][0] logo após conectar, o formato é o pedido
+ *               Pi -> Base  [token][largura][altura][fps][próxima sequência][retomada] com o formato obtido
+ *   QUADRO      Pi -> Base  [sequência][carimbo][JPEG]
+ *   DETECCOES   Pi -> Base  [sequência][carimbo][n][n detecções][tamanho do preview][preview JPEG]
+ *   TELEMETRIA  Pi -> Base  [amostra]... um lote de amostras em cada mensagem
+ *   COMANDO     Base -> Pi  [sequência][carimbo][comando][PWMs][alvos][número][correlação][escala][processamento]
+ * Os inteiros vão em Big-Endian. O carimbo é o relógio monotônico da Pi na captura, ecoado no comando, então a Pi
+ * mede a latência do quadro ao comando sem sincronizar os relógios. Tipos desconhecidos são pulados pelo tamanho,
+ * e uma versão diferente encerra a conexão. Os campos são escritos e lidos direto nos buffers de transmissão e
+ * recepção, o JPEG nunca é copiado para montar a mensagem.
+ */
+namespace Protocolo
+{
+    typedef enum : uint8_t
+    {
+        COMANDO = 1,
+        QUADRO,
+        DETECCOES,
+        TELEMETRIA,
+        SESSAO,
+    } Tipo;
+
+    typedef struct
+    {
+        uint8_t tipo;
+        uint8_t versao;
+        uint32_t tamanho;   // Bytes do corpo
+    } Cabecalho;
+
+    // Identificação do quadro na Pi, devolvida pela Base no comando que ele gerou
+    typedef struct
+    {
+        uint32_t sequencia;
+        uint32_t carimbo;   // [us] Relógio monotônico da Pi, dá a volta a cada ~71 min
+    } Quadro;
+
+    typedef struct
+    {
+        Quadro quadro;
+        Raspberry::Comando comando;
+        uint8_t pwms[PROTOCOLO_PWMS];   // Somente com AUTO_VELOCIDADE
+        uint8_t numAlvos;
+        int8_t numero;                  // Número predito no alvo principal, -1 sem alvo
+        uint16_t correlacao;            // [1/65535] Do alvo principal
+        uint16_t escala;                // [1/10000] Do alvo principal
+        uint16_t processamento;         // [0.1 ms] Da chegada do quadro na Base ao envio do comando
+    } Comando;
+
+    typedef struct
+    {
+        uint32_t carimbo;       // [us] Relógio da Pi
+        uint16_t cpu;           // [0.1 %] Uso total da CPU desde a amostra anterior
+        int16_t temperatura;    // [0.1 °C] Do SoC, PROTOCOLO_SEM_TEMPERATURA sem sensor
+        uint16_t latencia;      // [0.1 ms] Da captura ao comando, no último quadro respondido
+        uint16_t processamento; // [0.1 ms] Parte da latência gasta na Base
+        uint8_t filaMotor;      // Comandos postados ainda não aplicados pelo AgendadorMotor
+        uint8_t filaCaptura;    // Quadros prontos esperando na fila do driver da câmera
+        uint32_t filaSocket;    // Bytes ainda não transmitidos no socket
+    } Amostra;
+
+    /*
+     * Sessão entre a Base e a Pi. O token é sorteado pela Base e reapresentado em cada reconexão, quando a Pi o
+     * reconhece ela continua a sequência dos quadros e mantém o seu estado, e responde com retomada
+     */
+    typedef struct
+    {
+        uint64_t token;
+        Raspberry::Formato formato;
+        uint32_t sequencia;     // Próximo quadro da Pi
+        uint8_t retomada;
+    } Sessao;
+
+    void escreve32(Raspberry::Byte*& buf, uint32_t valor);
+    uint32_t le32(const Raspberry::Byte*& buf);
+
+    uint32_t getCarimbo();
+    uint64_t getToken();
+    uint16_t getDecimosMs(uint32_t microssegundos);
+
+    void escreveCabecalho(Raspberry::Byte* buf, Tipo tipo, uint32_t tamanho);
+    Cabecalho leCabecalho(const Raspberry::Byte* buf);
+    void verifica(const Cabecalho& cabecalho);
+
+    void escreveQuadro(Raspberry::Byte* buf, const Quadro& quadro);
+    Quadro leQuadro(const Raspberry::Byte* corpo, uint32_t tamanho);
+
+    void escreveComando(Raspberry::Byte* buf, const Comando& comando);
+    Comando leComando(const Raspberry::Byte* corpo, uint32_t tamanho);
+    void setAlvo(Comando& comando, const Raspberry::FindPos* alvo, size_t numAlvos, int numero);
+
+    void escreveSessao(Raspberry::Byte* buf, const Sessao& sessao);
+    Sessao leSessao(const Raspberry::Byte* corpo, uint32_t tamanho);
+
+    void escreveAmostra(Raspberry::Byte* buf, const Amostra& amostra);
+    void leTelemetria(const Raspberry::Byte* corpo, uint32_t tamanho, std::vector<Amostra>& amostras);
+} // namespace Protocolo
+
+#endif
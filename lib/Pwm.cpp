@@ -0,0 +1,316 @@
+#include "Pwm.hpp"
+
+#ifdef RASP
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+
+/*
+ * Soma um intervalo em nanosegundos ao instante passado
+ */
+static struct timespec soma(const struct timespec& t, int64_t nanosegundos)
+{
+    struct timespec r;
+    int64_t nsec = t.tv_nsec + nanosegundos;
+    r.tv_sec = t.tv_sec + nsec / 1000000000;
+    r.tv_nsec = nsec % 1000000000;
+    return r;
+}
+
+/*
+ * Diferença a - b em segundos
+ */
+static double diferenca(const struct timespec& a, const struct timespec& b)
+{
+    return (a.tv_sec - b.tv_sec) + (a.tv_nsec - b.tv_nsec)*1e-9;
+}
+
+namespace Pwm
+{
+    /* -------- SoftPwm -------- */
+    SoftPwm::SoftPwm(const int pinos[PWM_NUM_CANAIS], int faixa) : faixa(faixa)
+    {
+        std::copy(pinos, pinos + PWM_NUM_CANAIS, this->pinos);
+    }
+
+    void SoftPwm::init()
+    {
+        wiringPiSetup();
+
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            if (softPwmCreate(pinos[i], 0, faixa)) {
+                throw std::runtime_error("Erro ao criar o PWM do pino " + std::to_string(pinos[i]));
+            }
+        }
+    }
+
+    void SoftPwm::write(const int valores[PWM_NUM_CANAIS])
+    {
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            softPwmWrite(pinos[i], valores[i]);
+        }
+    }
+
+    void SoftPwm::stop()
+    {
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            softPwmWrite(pinos[i], 0);
+            softPwmStop(pinos[i]);
+        }
+    }
+
+    /* -------- SoftPwmUnico -------- */
+    SoftPwmUnico::SoftPwmUnico(const int pinos[PWM_NUM_CANAIS], int faixa, long passoUs) : faixa(faixa), passoNs(passoUs*1000)
+    {
+        std::copy(pinos, pinos + PWM_NUM_CANAIS, this->pinos);
+
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            valores[i] = 0;
+        }
+    }
+
+    SoftPwmUnico::~SoftPwmUnico()
+    {
+        if (thread.joinable()) {
+            stop();
+        }
+    }
+
+    void SoftPwmUnico::init()
+    {
+        wiringPiSetup();
+
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            pinMode(pinos[i], OUTPUT);
+            digitalWrite(pinos[i], LOW);
+        }
+
+        run = true;
+        thread = std::thread(&SoftPwmUnico::executa, this);
+    }
+
+    void SoftPwmUnico::write(const int valores[PWM_NUM_CANAIS])
+    {
+        bool algumAtivo = false;
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            this->valores[i].store(std::clamp(valores[i], 0, faixa), std::memory_order_relaxed);
+            algumAtivo |= valores[i] > 0;
+        }
+
+        // Acorda a thread caso esteja bloqueada com todos os canais em zero
+        if (algumAtivo) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_one();
+        }
+    }
+
+    void SoftPwmUnico::stop()
+    {
+        const int zeros[PWM_NUM_CANAIS] = {0, 0, 0, 0};
+        write(zeros);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            run = false;
+            cv.notify_one();
+        }
+
+        if (thread.joinable()) {
+            thread.join();
+        }
+
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            digitalWrite(pinos[i], LOW);
+        }
+    }
+
+    /*
+     * Laço da thread do PWM, a cada período sobe os canais ativos e dorme até cada borda de descida (prazos absolutos)
+     */
+    void SoftPwmUnico::executa()
+    {
+        // Mesma prioridade de tempo real usada pelo softPwm, sem permissão segue com a prioridade normal
+        piHiPri(90);
+
+        const int64_t periodoNs = faixa*passoNs;
+        struct timespec inicio;
+        clock_gettime(CLOCK_MONOTONIC, &inicio);
+
+        while (run) {
+            int duty[PWM_NUM_CANAIS];
+            bool algumAtivo = false;
+            for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+                duty[i] = valores[i].load(std::memory_order_relaxed);
+                algumAtivo |= duty[i] > 0;
+            }
+
+            // Todos os canais em zero, bloqueia até o próximo valor
+            if (!algumAtivo) {
+                for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+                    digitalWrite(pinos[i], LOW);
+                }
+
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] {
+                    if (!run) {
+                        return true;
+                    }
+                    for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+                        if (valores[i].load(std::memory_order_relaxed) > 0) {
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+
+                clock_gettime(CLOCK_MONOTONIC, &inicio);
+                continue;
+            }
+
+            // Início do período
+            for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+                digitalWrite(pinos[i], duty[i] > 0 ? HIGH : LOW);
+            }
+
+            // Bordas de descida em ordem crescente de duty
+            int ordem[PWM_NUM_CANAIS] = {0, 1, 2, 3};
+            std::sort(ordem, ordem + PWM_NUM_CANAIS, [&duty](int a, int b) { return duty[a] < duty[b]; });
+
+            for (auto k : ordem) {
+                if (duty[k] == 0 || duty[k] >= faixa) {
+                    continue;
+                }
+
+                struct timespec borda = soma(inicio, duty[k]*passoNs);
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &borda, nullptr);
+                digitalWrite(pinos[k], LOW);
+            }
+
+            // Próximo período, caso tenha atrasado mais de um período ressincroniza ao invés de tentar compensar
+            inicio = soma(inicio, periodoNs);
+
+            struct timespec agora;
+            clock_gettime(CLOCK_MONOTONIC, &agora);
+            if (diferenca(agora, inicio) > periodoNs*1e-9) {
+                inicio = agora;
+            }
+
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &inicio, nullptr);
+        }
+    }
+
+    /* -------- Hardware -------- */
+    Hardware::Hardware(const int pinos[PWM_NUM_CANAIS], const int enables[2], int faixa) : faixa(faixa)
+    {
+        std::copy(pinos, pinos + PWM_NUM_CANAIS, this->pinos);
+        std::copy(enables, enables + 2, this->enables);
+    }
+
+    void Hardware::init()
+    {
+        wiringPiSetup();
+
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            pinMode(pinos[i], OUTPUT);
+            digitalWrite(pinos[i], LOW);
+        }
+
+        // Modo mark-space, 19.2 MHz / (192 * faixa) = 1 kHz para faixa de 100
+        for (auto i = 0; i < 2; i++) {
+            pinMode(enables[i], PWM_OUTPUT);
+        }
+        pwmSetMode(PWM_MODE_MS);
+        pwmSetRange(faixa);
+        pwmSetClock(192);
+
+        for (auto i = 0; i < 2; i++) {
+            pwmWrite(enables[i], 0);
+        }
+    }
+
+    void Hardware::write(const int valores[PWM_NUM_CANAIS])
+    {
+        for (auto m = 0; m < 2; m++) {
+            int a = valores[2*m];
+            int b = valores[2*m + 1];
+
+            digitalWrite(pinos[2*m], a > 0 ? HIGH : LOW);
+            digitalWrite(pinos[2*m + 1], b > 0 ? HIGH : LOW);
+            pwmWrite(enables[m], std::clamp(std::max(a, b), 0, faixa));
+        }
+    }
+
+    void Hardware::stop()
+    {
+        for (auto i = 0; i < 2; i++) {
+            pwmWrite(enables[i], 0);
+        }
+
+        for (auto i = 0; i < PWM_NUM_CANAIS; i++) {
+            digitalWrite(pinos[i], LOW);
+        }
+    }
+
+    /* -------- Mock -------- */
+    void Mock::write(const int valores[PWM_NUM_CANAIS])
+    {
+        std::copy(valores, valores + PWM_NUM_CANAIS, this->valores);
+        escritas++;
+    }
+
+    void Mock::stop()
+    {
+        std::fill(valores, valores + PWM_NUM_CANAIS, 0);
+        ativo = false;
+    }
+
+    /*
+     * Cria o backend pelo nome (soft, unico, hw ou mock), caso não exista joga uma excessão
+     */
+    std::unique_ptr<Backend> cria(const std::string& nome, const int pinos[PWM_NUM_CANAIS], const int enables[2], int faixa)
+    {
+        if (nome == "soft") {
+            return std::make_unique<SoftPwm>(pinos, faixa);
+        }
+        else if (nome == "unico") {
+            return std::make_unique<SoftPwmUnico>(pinos, faixa);
+        }
+        else if (nome == "hw") {
+            return std::make_unique<Hardware>(pinos, enables, faixa);
+        }
+        else if (nome == "mock") {
+            return std::make_unique<Mock>();
+        }
+
+        throw std::runtime_error("Pwm: Backend desconhecido: " + nome);
+    }
+
+    /*
+     * Mede o uso de CPU do processo (fração de um núcleo) com o backend gerando o PWM do comando FRENTE ajustado
+     */
+    double medeCpu(Backend& backend, double segundos)
+    {
+        const int frente[PWM_NUM_CANAIS] = {0, 68, 0, 80};
+
+        backend.init();
+        backend.write(frente);
+
+        struct timespec cpuInicio, cpuFim, inicio, fim;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuInicio);
+        clock_gettime(CLOCK_MONOTONIC, &inicio);
+
+        struct timespec prazo = soma(inicio, static_cast<int64_t>(segundos*1e9));
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &prazo, nullptr) == EINTR) {
+            ;;
+        }
+
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuFim);
+        clock_gettime(CLOCK_MONOTONIC, &fim);
+
+        backend.stop();
+
+        return diferenca(cpuFim, cpuInicio) / diferenca(fim, inicio);
+    }
+} // namespace Pwm
+
+#endif // RASP
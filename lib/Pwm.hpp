@@ -0,0 +1,124 @@
+#ifndef PWM_HPP
+#define PWM_HPP
+
+#ifdef RASP
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <time.h>
+#include <wiringPi.h>
+#include <softPwm.h>
+
+#define PWM_NUM_CANAIS  4
+
+namespace Pwm
+{
+    /*
+     * Interface dos PWMs da ponte H, os canais seguem a ordem M1_A, M1_B, M2_A, M2_B
+     */
+    class Backend
+    {
+        public:
+            virtual ~Backend() = default;
+
+            virtual void init() = 0;
+            virtual void write(const int valores[PWM_NUM_CANAIS]) = 0;
+            virtual void stop() = 0;
+            virtual const char* nome() const = 0;
+    };
+
+    /*
+     * PWM por software do wiringPi, uma thread por canal
+     */
+    class SoftPwm : public Backend
+    {
+        private:
+            int pinos[PWM_NUM_CANAIS];
+            int faixa;
+        public:
+            SoftPwm(const int pinos[PWM_NUM_CANAIS], int faixa);
+
+            void init();
+            void write(const int valores[PWM_NUM_CANAIS]);
+            void stop();
+            const char* nome() const { return "soft"; }
+    };
+
+    /*
+     * PWM por software com uma única thread para todos os canais, cada período acorda somente nas bordas de descida.
+     * Com todos os canais em zero a thread fica bloqueada, sem consumir CPU.
+     */
+    class SoftPwmUnico : public Backend
+    {
+        private:
+            int pinos[PWM_NUM_CANAIS];
+            int faixa;
+            int64_t passoNs;
+
+            std::atomic<int> valores[PWM_NUM_CANAIS];
+            std::atomic<bool> run{false};
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::thread thread;
+
+            void executa();
+        public:
+            SoftPwmUnico(const int pinos[PWM_NUM_CANAIS], int faixa, long passoUs = 100);
+            ~SoftPwmUnico();
+
+            void init();
+            void write(const int valores[PWM_NUM_CANAIS]);
+            void stop();
+            const char* nome() const { return "unico"; }
+    };
+
+    /*
+     * PWM por hardware do BCM2837 (PWM0 e PWM1), um canal por motor ligado no enable da ponte H,
+     * os pinos M*_A e M*_B passam a definir somente o sentido de rotação
+     */
+    class Hardware : public Backend
+    {
+        private:
+            int pinos[PWM_NUM_CANAIS];
+            int enables[2];
+            int faixa;
+        public:
+            Hardware(const int pinos[PWM_NUM_CANAIS], const int enables[2], int faixa);
+
+            void init();
+            void write(const int valores[PWM_NUM_CANAIS]);
+            void stop();
+            const char* nome() const { return "hw"; }
+    };
+
+    /*
+     * PWM falso, apenas registra os valores escritos, permite executar sem a ponte H
+     */
+    class Mock : public Backend
+    {
+        private:
+            int valores[PWM_NUM_CANAIS] = {0, 0, 0, 0};
+            uint64_t escritas = 0;
+            bool ativo = false;
+        public:
+            void init() { ativo = true; }
+            void write(const int valores[PWM_NUM_CANAIS]);
+            void stop();
+            const char* nome() const { return "mock"; }
+
+            int getValor(int canal) const { return valores[canal]; }
+            uint64_t getEscritas() const { return escritas; }
+            bool isAtivo() const { return ativo; }
+    };
+
+    std::unique_ptr<Backend> cria(const std::string& nome, const int pinos[PWM_NUM_CANAIS], const int enables[2], int faixa);
+
+    double medeCpu(Backend& backend, double segundos);
+} // namespace Pwm
+
+#endif // RASP
+#endif
@@ -3,7 +3,6 @@
 #define RASPBERRY_HPP
 
 #include <opencv2/opencv.hpp>
-#include <omp.h>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -11,31 +10,36 @@
 #include <sstream>
 #include <chrono>
 #include <vector>
+#include <array>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
-#ifdef BASE
-#include <torch/script.h>
-#include <memory>
-#endif
+#include "ThreadPool.hpp"
 
 #ifdef RASP
-#include <thread>
-#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <wiringPi.h>
-#include <softPwm.h>
+#include "Pwm.hpp"
 #endif
 
 /* -------- Defines -------- */
 #define CAMERA_VIDEO        0
-#define CAMERA_FRAME_HEIGHT     240
+#define CAMERA_FRAME_HEIGHT     240     // Resolução padrão, pedida quando a Base não escolhe outra, e de referência das escalas
 #define CAMERA_FRAME_WIDTH      320
-#define TECLADO_HEIGHT          CAMERA_FRAME_HEIGHT
+#define CAMERA_FPS              30
+#define TECLADO_HEIGHT          240
 #define TECLADO_WIDTH           TECLADO_HEIGHT      
 #define BUTTON_WIDTH            80
 #define BUTTON_HEIGHT           80
 #define PWM_MAX                 100
 #define MNIST_SIZE              28
+#define VEL_MAX_M1              68  // Mesmos PWMs do FRENTE ajustado, equilibra os dois motores
+#define VEL_MAX_M2              80
+#define PWM_MIN_MOVIMENTO       30  // Abaixo disso os motores não vencem o atrito
+#define FAIXAS_POR_THREAD       4   // Faixas de linhas da correlação por thread do pool, para equilibrar a carga
+#define FAIXA_LINHAS_MIN        8
 
 #define xdebug { string st = "File="+string(__FILE__)+" line="+to_string(__LINE__)+"\n"; cout << st; }
 #define xprint(x) { ostringstream os; os << #x " = " << x << '\n'; cout << os.str(); }
@@ -71,6 +75,7 @@ namespace Raspberry
         AUTO_180_DIREITA,
         AUTO_90_ESQUERDA,
         AUTO_90_DIREITA,
+        AUTO_VELOCIDADE,    // Seguido dos PWMs dos quatro canais da ponte H, o último: o Protocolo recusa códigos acima dele
     } Comando;
 
     typedef enum
@@ -91,6 +96,102 @@ namespace Raspberry
         CorrelacaoPonto ponto;
     } FindPos;
 
+    // Resolução e taxa da câmera, pedidas pela Base e confirmadas pela Pi ao conectar. Zero deixa a escolha para a Pi
+    typedef struct
+    {
+        uint32_t largura;
+        uint32_t altura;
+        uint32_t fps;
+    } Formato;
+
+    // Detecção feita na Pi: o alvo e o recorte do número já no formato MNIST
+    typedef struct
+    {
+        FindPos alvo;
+        Mat_<Byte> recorte;
+    } Deteccao;
+
+    /*
+     * Potência inteira, constexpr para as tabelas geradas na compilação
+     */
+    constexpr double potencia(double base, int expoente)
+    {
+        double resultado = 1.0;
+        for (auto i = 0; i < expoente; i++) {
+            resultado *= base;
+        }
+        return resultado;
+    }
+
+    /*
+     * Raiz de ordem n (valor positivo) pelo método de Newton, constexpr. Partindo de cima da raiz as iterações
+     * descem sem oscilar, então param quando não diminuem mais. Vale para valor > 0 e ordem >= 1, o PontoFixo confere
+     * na compilação que a tabela das escalas termina em ESCALA_MAX
+     */
+    constexpr double raiz(double valor, int ordem)
+    {
+        double r = valor > 1.0 ? valor : 1.0;
+
+        for (auto i = 0; i < 1000; i++) {
+            double proximo = r - (potencia(r, ordem) - valor)/(ordem*potencia(r, ordem - 1));
+            if (!(proximo < r)) {
+                break;
+            }
+            r = proximo;
+        }
+        return r;
+    }
+
+    /*
+     * Escalas em progressão geométrica de escalaMin até escalaMax, o passo relativo é constante,
+     * então a resolução em distância é a mesma para alvos próximos e distantes
+     */
+    constexpr void getEscalasGeometricas(float escalas[], int numEscalas, float escalaMin, float escalaMax)
+    {
+        double razao = numEscalas > 1 ? raiz(double(escalaMax)/escalaMin, numEscalas - 1) : 1.0;
+
+        for (auto n = 0; n < numEscalas; n++) {
+            escalas[n] = escalaMin*potencia(razao, n);
+        }
+    }
+
+    /*
+     * Tabela das escalas geométricas gerada na compilação, as mesmas do getEscalasGeometricas
+     */
+    template <int numEscalas>
+    constexpr std::array<float, numEscalas> getTabelaEscalas(float escalaMin, float escalaMax)
+    {
+        std::array<float, numEscalas> escalas{};
+        getEscalasGeometricas(escalas.data(), numEscalas, escalaMin, escalaMax);
+        return escalas;
+    }
+
+    /*
+     * Fator das escalas em um quadro com a largura passada: ESCALA_MIN, ESCALA_MAX e ESCALA_DIST_MIN valem para a largura
+     * de referência CAMERA_FRAME_WIDTH, e o alvo aparece proporcionalmente maior em resoluções maiores
+     */
+    inline float getFatorEscala(int largura)
+    {
+        return float(largura) / CAMERA_FRAME_WIDTH;
+    }
+
+    /*
+     * Lê uma resolução no formato "640x480", retorna falso quando o texto não está nesse formato
+     */
+    inline bool leResolucao(const std::string& texto, Formato& formato)
+    {
+        unsigned largura, altura;
+        char resto;
+
+        if (sscanf(texto.c_str(), "%ux%u%c", &largura, &altura, &resto) != 2 || largura == 0 || altura == 0) {
+            return false;
+        }
+
+        formato.largura = largura;
+        formato.altura = altura;
+        return true;
+    }
+
     /*
      * Retorna a quantidade de segundos desde a última vez que esta foi chamada
      */
@@ -105,6 +206,8 @@ namespace Raspberry
     #define M1_B    1
     #define M2_A    2
     #define M2_B    3
+    #define M1_EN   23  // PWM1 (BCM13), usado somente pelo backend hw
+    #define M2_EN   26  // PWM0 (BCM12), usado somente pelo backend hw
 
     namespace Motores
     {
@@ -200,24 +303,36 @@ namespace Raspberry
             }
         }
 
+        // Backend dos PWMs da ponte H, definido em initPwm
+        inline std::unique_ptr<Pwm::Backend> pwm;
+
         /*
-         * Inicializa os PWMs do controle da ponte H
+         * Inicializa os PWMs do controle da ponte H com o backend passado (soft, unico, hw ou mock)
          */
-        inline void initPwm()
+        inline void initPwm(const std::string& backend = "soft")
         {
-            wiringPiSetup();
-            
-            if (softPwmCreate(M1_A, 0, PWM_MAX))
-                throw std::runtime_error("Erro ao criar o PWM do M1_A");
+            const int pinos[PWM_NUM_CANAIS] = {M1_A, M1_B, M2_A, M2_B};
+            const int enables[2] = {M1_EN, M2_EN};
 
-            if (softPwmCreate(M1_B, 0, PWM_MAX))
-                throw std::runtime_error("Erro ao criar o PWM do M1_B");
+            pwm = Pwm::cria(backend, pinos, enables, PWM_MAX);
+            pwm->init();
+        }
 
-            if (softPwmCreate(M2_A, 0, PWM_MAX))
-                throw std::runtime_error("Erro ao criar o PWM do M2_A");
+        /*
+         * Seta a velocidae de rotação dos motores, conforme o comando passado
+         */
+        inline void setVelPWM(int velocidades[]) 
+        {        
+            pwm->write(velocidades);
+        }
 
-            if (softPwmCreate(M2_B, 0, PWM_MAX))
-                throw std::runtime_error("Erro ao criar o PWM do M2_B");
+        /*
+         * Escreve os PWMs dos quatro canais da ponte H
+         */
+        inline void setPWM(int m1A, int m1B, int m2A, int m2B) 
+        {
+            int velocidades[PWM_NUM_CANAIS] = {m1A, m1B, m2A, m2B};
+            setVelPWM(velocidades);
         }
 
         /*
@@ -227,59 +342,32 @@ namespace Raspberry
         {
             switch (comando) {
                 case FRENTE:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, velocidade);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, velocidade);
+                    setPWM(0, velocidade, 0, velocidade);
                     break;
                 case ATRAS:
-                    softPwmWrite(M1_A, velocidade);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, velocidade);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(velocidade, 0, velocidade, 0);
                     break;
                 case DIAGONAL_FRENTE_DIREITA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, velocidade);
+                    setPWM(0, 0, 0, velocidade);
                     break;
                 case DIAGONAL_FRENTE_ESQUERDA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, velocidade);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, velocidade, 0, 0);
                     break;
                 case DIAGONAL_ATRAS_DIREITA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, velocidade);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, 0, velocidade, 0);
                     break;
                 case DIAGONAL_ATRAS_ESQUERDA:
-                    softPwmWrite(M1_A, velocidade);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(velocidade, 0, 0, 0);
                     break;
                 case GIRA_ESQUERDA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, velocidade);
-                    softPwmWrite(M2_A, velocidade);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, velocidade, velocidade, 0);
                     break;
                 case GIRA_DIREITA:
-                    softPwmWrite(M1_A, velocidade);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, velocidade);
+                    setPWM(velocidade, 0, 0, velocidade);
                     break;
                 case PARADO:         
                 default:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, 0, 0, 0);
                     break;
             }
         }
@@ -291,88 +379,43 @@ namespace Raspberry
         {
             switch (comando) {
                 case FRENTE:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 68);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 80);
+                    setPWM(0, 68, 0, 80);
                     break;
                 case ATRAS:
-                    softPwmWrite(M1_A, 68);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 80);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(68, 0, 80, 0);
                     break;
                 case DIAGONAL_FRENTE_DIREITA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 100);
+                    setPWM(0, 0, 0, 100);
                     break;
                 case DIAGONAL_FRENTE_ESQUERDA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 100);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, 100, 0, 0);
                     break;
                 case DIAGONAL_ATRAS_DIREITA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 100);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, 0, 100, 0);
                     break;
                 case DIAGONAL_ATRAS_ESQUERDA:
-                    softPwmWrite(M1_A, 100);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(100, 0, 0, 0);
                     break;
                 case GIRA_ESQUERDA:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 100);
-                    softPwmWrite(M2_A, 100);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, 100, 100, 0);
                     break;
                 case GIRA_DIREITA:
-                    softPwmWrite(M1_A, 100);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 100);
+                    setPWM(100, 0, 0, 100);
                     break;
                 case PARADO:         
                 default:
-                    softPwmWrite(M1_A, 0);
-                    softPwmWrite(M1_B, 0);
-                    softPwmWrite(M2_A, 0);
-                    softPwmWrite(M2_B, 0);
+                    setPWM(0, 0, 0, 0);
                     break;
             }
         }
 
-        /*
-         * Seta a velocidae de rotação dos motores, conforme o comando passado
-         */
-        inline void setVelPWM(int velocidades[]) 
-        {        
-            softPwmWrite(M1_A, velocidades[0]);
-            softPwmWrite(M1_B, velocidades[1]);
-            softPwmWrite(M2_A, velocidades[2]);
-            softPwmWrite(M2_B, velocidades[3]);
-        }
-
         /*
          * Para os motores
          */
         inline void stopPWM() 
         {        
-            softPwmWrite(M1_A, 0);
-            softPwmWrite(M1_B, 0);
-            softPwmWrite(M2_A, 0);
-            softPwmWrite(M2_B, 0);
-
-            softPwmStop(M1_A);
-            softPwmStop(M1_B);
-            softPwmStop(M2_A);
-            softPwmStop(M2_B);
+            pwm->stop();
+            pwm.reset();
         }
     } // namespace Motores
     #endif
@@ -624,284 +667,4 @@ namespace Raspberry
     #endif // Base
 } // namespace Raspberry
 
-#ifdef BASE
-
-namespace ImageProcessing
-{
-    using namespace Raspberry;
-
-    /*
-     * Torna a somatoria absoluta da imagem dar dois
-     */
-    inline Mat_<Flt> modulo2(Mat_<Flt> imagem) 
-    {
-        Mat_<Flt> clone = imagem.clone();
-        
-        double soma = 0.0;
-        for (auto it = clone.begin(); it != clone.end(); it++) {
-            soma += abs(*it);
-        }
-
-        if (soma < epsilon) {
-            throw std::runtime_error("Erro: Divisao por zero");
-        }
-
-        soma = 2.0/(soma);
-
-        for (auto it = clone.begin(); it != clone.end(); it++) {
-            (*it) *= soma;
-        }
-              
-        return clone;
-    }
-
-    /*
-     * Elimina nivel DC (subtrai media)
-     */
-    inline Mat_<Flt> dcReject(Mat_<Flt> imagem) 
-    { 
-        return imagem - mean(imagem)[0];;
-    }
-
-    /*
-     * Elimina nivel DC (subtrai media) com dontcare
-     */
-    inline Mat_<Flt> dcReject(Mat_<Flt> imagem, Flt dontcare) 
-    {
-        Mat_<uchar> naodontcare = (imagem != dontcare); 
-        Scalar media = mean(imagem, naodontcare);
-        subtract(imagem, media[0], imagem, naodontcare);
-        Mat_<uchar> simdontcare = (imagem == dontcare); 
-        subtract(imagem, dontcare, imagem, simdontcare);
-        return imagem;
-    }
-    
-    /*
-     * Converte uma imagem de Cor (Vec3b) para Float em escala de cinza
-     */
-    inline void Cor2Flt(Mat_<Cor> entrada, Mat_<Flt>& saida) 
-    {
-        Mat_<Vec3f> temp; 
-        entrada.convertTo(temp, CV_32F, 1.0/255.0, 0.0);
-        cvtColor(temp, saida, COLOR_BGR2GRAY);
-    }
-
-    /*
-     * Adiciona a imagem um retangulo não preenchido centralizado no ponto passado
-     */
-    template <typename T>
-    inline void ploteRetangulo(Mat_<T>& image, Point center, float size, Raspberry::Cor color = Paleta::red, float espessura = 1.5)
-    {
-        Point a {max(center.x - (int) (size*0.5), 0), max(center.y - (int) (size*0.5), 0)};
-        Point b {min(center.x + (int) (size*0.5), CAMERA_FRAME_WIDTH), min(center.y + (int) (size*0.5), CAMERA_FRAME_HEIGHT)};    
-        rectangle(image, a, b, color, espessura);
-    }
-
-    namespace TemplateMatching
-    {
-        /*
-        * Realiza a busca do modelo na imagem, retorna uma imagem de correlação de mesma dimensão.
-        */
-        inline Mat_<Flt> matchTemplateSame(Mat_<Flt> imagem, Mat_<Flt> modelo, int metodo, Flt backgroundColor = 0.0f)
-        {
-            Mat_<Flt> resultado{imagem.size(), backgroundColor};
-            Rect rect{(modelo.cols-1)/2, (modelo.rows-1)/2, imagem.cols - modelo.cols + 1, imagem.rows - modelo.rows + 1};
-            Mat_<Flt> roi{resultado, rect};
-            matchTemplate(imagem, modelo, roi, metodo);
-            return resultado;
-        }
-        
-        /*
-         * Retorna o modelo a ser buscado pré-processado e em diferêntes escalas
-         */
-        inline void getModeloPreProcessados(Mat_<Flt>& modelo, Mat_<Flt> modelosPreProcessados[], uint8_t numEscalas, float escalas[])
-        {
-            #pragma omp parallel for
-            for (auto i = 0; i < numEscalas; i++) {
-                Mat_<Raspberry::Flt> temp;
-
-                resize(modelo, temp, Size(), escalas[i], escalas[i], INTER_NEAREST);
-                        
-                // Para poder usar o metodo de Correlação cruzada é nescessário pre-processar o modelo
-                modelosPreProcessados[i] = ImageProcessing::modulo2(ImageProcessing::dcReject(temp, 1.0));
-            }
-        }
-
-        /*
-         * Retorna a posição da maior correlação encontrada
-         */
-        inline Raspberry::FindPos getMaxCorrelacao(Mat_<Raspberry::Flt>& frameBufFlt, Mat_<Raspberry::Flt> modelos[], Raspberry::FindPos corrBuf[], int numEscalas, float escalas[])
-        {
-            // Realiza o template matching pelas diferentes escalas e captura a maior correlação
-            #pragma omp parallel for
-            for (auto n = 0; n < numEscalas; n++) {
-                Mat_<Raspberry::Flt> correlacao = ImageProcessing::TemplateMatching::matchTemplateSame(frameBufFlt, modelos[n], TM_CCOEFF_NORMED);
-
-                Raspberry::CorrelacaoPonto correlacaoPonto;
-                minMaxLoc(correlacao, NULL, &correlacaoPonto.correlacao, NULL, &correlacaoPonto.posicao);
-                
-                corrBuf[n] = Raspberry::FindPos{escalas[n], correlacaoPonto};
-            }
-
-            Raspberry::FindPos maxCorr = corrBuf[0];
-            for (auto i = 1; i < numEscalas; i++) {
-                if (corrBuf[i].ponto.correlacao > maxCorr.ponto.correlacao) {
-                    maxCorr = corrBuf[i];
-                }
-            }  
-
-            return maxCorr; 
-        }
-    } // namespace TemplateMatching
-} // namespace ImageProcessing
-
-namespace MNIST
-{
-    /*
-     * Recorta a imagem para obter o numero MNIST no ponto passado, retorna ele no formato MNIST
-     */
-    inline Mat_<Raspberry::Flt> getMNIST(Mat_<Raspberry::Flt>& imagem, Point center, float size)
-    {
-        // Cálculo dos pontos de recorte
-        Point a {std::max(int(center.x - size*0.5), 0), std::max(int(center.y - size*0.5), 0)};      
-        Point b {std::min(int(center.x + size*0.5), CAMERA_FRAME_WIDTH), std::min(int(center.y + size*0.5), CAMERA_FRAME_HEIGHT)};
-
-        // Recorte da imagem usando as coordenadas calculadas
-        Rect region(a.x, a.y, b.x - a.x, b.y - a.y); // Definir a região do recorte
-        Mat_<Raspberry::Flt> mnist_num = imagem(region);  
-        
-        // Redimendiona a imagem para o tamanho das imagens MNIST
-        resize(mnist_num, mnist_num, Size(MNIST_SIZE, MNIST_SIZE), INTER_CUBIC);    
-        
-        Mat mnist_int;
-        mnist_num.convertTo(mnist_int, CV_8UC1, 255.0);    
-
-        // Satura os pixeis de forma inteligente, isso torna o reconhecimento mais resistente a variações no brilho.
-        adaptiveThreshold(mnist_int, mnist_int, 255, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY_INV, 9, 2);        
-        
-        mnist_int.convertTo(mnist_num, CV_32F, 1.0 / 255.0);
-        return mnist_num;
-    }
-
-    /*
-     * Realiza a inferência do MNIST passado
-     */
-    inline int inferencia(Mat_<Raspberry::Flt>& imagem, torch::jit::script::Module& module)
-    {
-        // Converte o tipo para poder inserir no modelo
-        torch::jit::IValue numEncontradoTensor = torch::from_blob(imagem.data, {1, 1, MNIST_SIZE, MNIST_SIZE}, torch::kFloat);
-
-        torch::Tensor outputTensor = module.forward({numEncontradoTensor}).toTensor();
-
-        // Obtém o numero predito
-        return outputTensor.argmax(1).item<int>();
-    }
-} // namespace MNIST
-
-namespace ControleAutomatico
-{
-    typedef enum 
-    {
-        BUSCA = 0,
-        FOCA,
-        IDENTIFICA,
-        FINALIZA,
-    } Estados;
-
-    /*
-     * Máquina de estado do controle automático
-     */
-    inline void maquinaEstados(Estados& controleEstado, Raspberry::Comando& comando, bool enquadrado, int numPredito) 
-    {
-        static double timer = Raspberry::timeSinceEpoch();
-
-        switch (controleEstado) {
-            case Estados::BUSCA: {
-                comando = Raspberry::Comando::FRENTE;
-
-                if (enquadrado) {
-                    controleEstado = Estados::FOCA;
-                }
-                break;
-            }
-            
-            case Estados::FOCA: {
-                static bool inicioDelay = true;
-
-                if (inicioDelay) {
-                    timer = Raspberry::timeSinceEpoch();
-                    inicioDelay = false;
-                }
-
-                comando = Raspberry::Comando::PARADO;
-
-                double tempoDecorrido = Raspberry::timeSinceEpoch() - timer;
-                if (tempoDecorrido > 2.0) {
-                    controleEstado = Estados::IDENTIFICA;
-                    inicioDelay = true;
-                }
-                break;
-            }
-
-            case Estados::IDENTIFICA: {
-                std::cout << numPredito << std::endl;
-
-                switch (numPredito) {
-                    case 2:
-                        comando = Raspberry::Comando::AUTO_180_ESQUERDA;
-                        break;
-                    case 3:
-                        comando = Raspberry::Comando::AUTO_180_DIREITA;
-                        break;
-                    case 4:
-                    case 5:
-                        comando = Raspberry::Comando::AUTO_FRENTE;
-                        break;
-                    case 6:
-                    case 7:
-                        comando = Raspberry::Comando::AUTO_90_ESQUERDA;
-                        break;
-                    case 8:
-                    case 9:
-                        comando = Raspberry::Comando::AUTO_90_DIREITA;
-                        break;
-                    case 0:
-                    case 1:
-                    default:
-                        comando = Raspberry::Comando::AUTO_PARADO;
-                        break;
-                }
-
-                timer = Raspberry::timeSinceEpoch();
-                controleEstado = Estados::FINALIZA;
-                break;
-            }
-
-            case Estados::FINALIZA: {
-                static bool inicioDelay = true;
-
-                if (inicioDelay) {
-                    timer = Raspberry::timeSinceEpoch();
-                    inicioDelay = false;
-                }
-
-                comando = Raspberry::Comando::PARADO;
-                double tempoDecorrido = Raspberry::timeSinceEpoch() - timer;
-
-                if (tempoDecorrido > 2.0) {
-                    controleEstado = Estados::BUSCA;
-                    inicioDelay = true;
-                }
-                break;
-            }
-
-            default: {
-                comando = Raspberry::Comando::PARADO;               
-                controleEstado = Estados::BUSCA;
-                break;
-            }
-        }
-    }
-} // namespace ControleAutomatico
-#endif // Base
 #endif  // RASPBERRY_HPP
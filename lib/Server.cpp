@@ -1,6 +1,6 @@
 #include "Server.hpp"
 
-Server::Server(const char* port, time_t timeout)
+Server::Server(const char* port, time_t timeout) : timeout(timeout)
 {
     // Obtem um socket
     serverSocket = socket(AF_INET, SOCK_STREAM, 0);
@@ -54,14 +54,36 @@ Server::~Server()
     }
 }
 
+/*
+ * Aguarda a próxima conexão, até o timeout. Uma conexão anterior é fechada, assim o cliente pode reconectar
+ */
 void Server::waitConnection()
 {
+    if (transferSocket != SOCKET_ERROR) {
+        close(transferSocket);
+        transferSocket = SOCKET_ERROR;
+    }
+    conectado = false;
+
     socklen_t clientLen = sizeof(transferAddr);
-    transferSocket = accept(serverSocket, (struct sockaddr *) &transferAddr, &clientLen);
+    do {
+        transferSocket = accept(serverSocket, (struct sockaddr *) &transferAddr, &clientLen);
+    } while (transferSocket == SOCKET_ERROR && errno == EINTR);
 
     if (transferSocket == SOCKET_ERROR) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            throw std::runtime_error("Server: Timeout para aceitar a conexão!");
+        }
         throw std::runtime_error("Server: Erro ao aceitar a conexão! Código de erro: " + std::to_string(errno));                  
     }
+
+    // Um envio travado em um link parado também expira, e a conexão é dada como perdida
+    struct timeval tv;
+    tv.tv_sec = timeout;
+    tv.tv_usec = 0;
+    setsockopt(transferSocket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof tv);
+
+    conectado = true;
 }
 
 void Server::sendBytes(uint32_t numBytes, const Raspberry::Byte* txBuffer)
@@ -73,6 +95,10 @@ void Server::sendBytes(uint32_t numBytes, const Raspberry::Byte* txBuffer)
 
         // Verifica se não ouve algum erro na transmissão
         if (numSend == SOCKET_ERROR) {
+            if (errno == EINTR) {
+                continue;
+            }
+            conectado = false;
             throw std::runtime_error("Server: Erro ao transmitir os dados! Código de erro: " + std::to_string(errno));                  
         }
 
@@ -80,24 +106,48 @@ void Server::sendBytes(uint32_t numBytes, const Raspberry::Byte* txBuffer)
     }
 }
 
+/*
+ * Recebe um buffer de bytes. Enquanto aguarda, uma nova conexão pendente indica que o cliente reconectou, então a
+ * conexão atual é abandonada sem esperar o timeout dela
+ */
 void Server::receiveBytes(uint32_t numBytes, Raspberry::Byte* rxBuffer)
 {
     size_t totalRecv = 0;
     while (totalRecv < static_cast<size_t>(numBytes)) {
+        struct pollfd fds[2] = {{transferSocket, POLLIN, 0}, {serverSocket, POLLIN, 0}};
+        int prontos = poll(fds, 2, timeout*1000);
+
+        if (prontos < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            conectado = false;
+            throw std::runtime_error("Server: Erro ao aguardar os dados! Código de erro: " + std::to_string(errno));
+        } else if (prontos == 0) {
+            conectado = false;
+            throw std::runtime_error("Server: Timeout para receber!");
+        } else if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR)) && (fds[1].revents & POLLIN)) {
+            conectado = false;
+            throw std::runtime_error("Server: Nova conexão do cliente, a atual foi abandonada!");
+        }
+
         size_t chunk_size = std::min(CHUNK_SIZE, numBytes - totalRecv);
         ssize_t numRecv = read(transferSocket, &rxBuffer[totalRecv], chunk_size);
 
-        // Verifica se houve timeout
+        // Verifica se houve timeout, um buffer parcial não pode seguir adiante
         if (numRecv == SOCKET_ERROR) {
+            if (errno == EINTR) {
+                continue;
+            }
+            conectado = false;
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                Raspberry::print("Server: Timeout para receber.");
-                break;
+                throw std::runtime_error("Server: Timeout para receber!");
             } else {
                 throw std::runtime_error("Server: Erro ao receber os dados! Código de erro: " + std::to_string(errno));                
             }
         } else if (numRecv == 0) {
-            Raspberry::print("Server: Conexão fechada pelo cliente.");
-            break;
+            conectado = false;
+            throw std::runtime_error("Server: Conexão fechada pelo cliente!");
         }   
 
         totalRecv += numRecv;
@@ -3,10 +3,13 @@
 
 #include "Device.hpp"
 
+#include <poll.h>
+
 class Server : public Device
 {
     private:
         int serverSocket = SOCKET_ERROR;
+        time_t timeout;
     public:
         Server(const char* port, time_t timeout);
         ~Server();
@@ -0,0 +1,100 @@
+#include "Telemetria.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Sem os arquivos do /proc ou do /sys (fora do Linux, ou sem sensor) o campo correspondente fica zerado ou sem temperatura
+ */
+Telemetria::Telemetria(double periodo, size_t tamanhoLote) : periodo(periodo), tamanhoLote(std::max<size_t>(1, tamanhoLote))
+{
+    fdCpu = open(TELEMETRIA_CPU, O_RDONLY | O_CLOEXEC);
+    fdTemperatura = open(TELEMETRIA_TEMPERATURA, O_RDONLY | O_CLOEXEC);
+
+    lote.reserve(this->tamanhoLote*PROTOCOLO_AMOSTRA);
+
+    // A primeira leitura só marca o início, o uso é medido entre duas amostras
+    leCpu();
+}
+
+Telemetria::~Telemetria()
+{
+    if (fdCpu >= 0) {
+        close(fdCpu);
+    }
+
+    if (fdTemperatura >= 0) {
+        close(fdTemperatura);
+    }
+}
+
+/*
+ * Uso da CPU [0.1 %] desde a leitura anterior, pela primeira linha do /proc/stat: o tempo ocioso é o idle mais o iowait
+ */
+uint16_t Telemetria::leCpu()
+{
+    char buf[256];
+    ssize_t lidos = fdCpu >= 0 ? pread(fdCpu, buf, sizeof(buf) - 1, 0) : -1;
+    if (lidos <= 0) {
+        return 0;
+    }
+    buf[lidos] = '\0';
+
+    unsigned long long campos[8] = {0};
+    if (sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &campos[0], &campos[1], &campos[2], &campos[3],
+               &campos[4], &campos[5], &campos[6], &campos[7]) < 4) {
+        return 0;
+    }
+
+    uint64_t total = 0;
+    for (auto campo : campos) {
+        total += campo;
+    }
+    uint64_t ocupado = total - campos[3] - campos[4];
+
+    uint64_t deltaTotal = total - cpuTotal, deltaOcupado = ocupado - cpuOcupado;
+    cpuTotal = total;
+    cpuOcupado = ocupado;
+
+    return deltaTotal > 0 ? uint16_t(1000*deltaOcupado / deltaTotal) : 0;
+}
+
+/*
+ * Temperatura do SoC [0.1 °C], o sysfs entrega em miligraus
+ */
+int16_t Telemetria::leTemperatura()
+{
+    char buf[32];
+    ssize_t lidos = fdTemperatura >= 0 ? pread(fdTemperatura, buf, sizeof(buf) - 1, 0) : -1;
+    if (lidos <= 0) {
+        return PROTOCOLO_SEM_TEMPERATURA;
+    }
+    buf[lidos] = '\0';
+
+    return int16_t(std::clamp(atol(buf) / 100, long(INT16_MIN + 1), long(INT16_MAX)));
+}
+
+/*
+ * Acrescenta uma amostra ao lote, retorna verdadeiro quando o lote completou e deve ser transmitido
+ */
+bool Telemetria::amostra(uint16_t latencia, uint16_t processamento, uint8_t filaMotor, uint8_t filaCaptura, uint32_t filaSocket)
+{
+    // Mantém o período sem acumular atraso, e depois de uma pausa recomeça a partir de agora
+    double agora = Raspberry::timeSinceEpoch();
+    proxima = proxima + periodo > agora ? proxima + periodo : agora + periodo;
+
+    Protocolo::Amostra amostra;
+    amostra.carimbo = Protocolo::getCarimbo();
+    amostra.cpu = leCpu();
+    amostra.temperatura = leTemperatura();
+    amostra.latencia = latencia;
+    amostra.processamento = processamento;
+    amostra.filaMotor = filaMotor;
+    amostra.filaCaptura = filaCaptura;
+    amostra.filaSocket = filaSocket;
+
+    lote.resize(lote.size() + PROTOCOLO_AMOSTRA);
+    Protocolo::escreveAmostra(lote.data() + lote.size() - PROTOCOLO_AMOSTRA, amostra);
+
+    return lote.size() >= tamanhoLote*PROTOCOLO_AMOSTRA;
+}
@@ -0,0 +1,47 @@
+#ifndef TELEMETRIA_HPP
+#define TELEMETRIA_HPP
+
+#include "Protocolo.hpp"
+
+/* -------- Defines -------- */
+#define TELEMETRIA_PERIODO  0.1     // [s] Entre duas amostras
+#define TELEMETRIA_LOTE     10      // Amostras por mensagem, uma mensagem por segundo no período padrão
+#define TELEMETRIA_CPU          "/proc/stat"
+#define TELEMETRIA_TEMPERATURA  "/sys/class/thermal/thermal_zone0/temp"
+
+/*
+ * Amostragem da telemetria da Pi: uso da CPU, temperatura do SoC, latência do quadro ao comando e as filas.
+ * Os arquivos do /proc e do /sys ficam abertos e são relidos com pread a cada amostra. As amostras são acumuladas
+ * em um lote já codificado no formato do Protocolo, transmitido inteiro quando completa.
+ */
+class Telemetria
+{
+    private:
+        double periodo;
+        size_t tamanhoLote;
+        double proxima = 0.0;
+
+        int fdCpu = -1;
+        int fdTemperatura = -1;
+        uint64_t cpuOcupado = 0;
+        uint64_t cpuTotal = 0;
+
+        std::vector<Raspberry::Byte> lote;
+
+        uint16_t leCpu();
+        int16_t leTemperatura();
+    public:
+        Telemetria(double periodo = TELEMETRIA_PERIODO, size_t tamanhoLote = TELEMETRIA_LOTE);
+        ~Telemetria();
+
+        Telemetria(const Telemetria&) = delete;
+        Telemetria& operator=(const Telemetria&) = delete;
+
+        bool isHora() const { return Raspberry::timeSinceEpoch() >= proxima; }
+        bool amostra(uint16_t latencia, uint16_t processamento, uint8_t filaMotor, uint8_t filaCaptura, uint32_t filaSocket);
+
+        const std::vector<Raspberry::Byte>& getLote() const { return lote; }
+        void esvazia() { lote.clear(); }
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+
+// Índice da fila da thread atual, -1 para threads fora do pool
+static thread_local int indiceAtual = -1;
+
+// Pool compartilhado pelo processo
+static std::mutex mutexGlobal;
+static std::unique_ptr<ThreadPool> poolGlobal;
+
+/*
+ * Cria as threads, com cpus não vazio a thread i fica presa na cpu cpus[i % cpus.size()]. Se a afinidade falhar as
+ * threads já criadas são encerradas antes da exceção, senão o std::thread ainda joinable terminaria o processo
+ */
+ThreadPool::ThreadPool(unsigned numThreads, const std::vector<int>& cpus)
+{
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw std::runtime_error("ThreadPool: Erro cpu " + std::to_string(cpu) + " fora do conjunto!");
+        }
+    }
+
+    for (unsigned i = 0; i < numThreads; i++) {
+        filas.push_back(std::make_unique<Fila>());
+    }
+
+    for (unsigned i = 0; i < numThreads; i++) {
+        threads.emplace_back(&ThreadPool::executa, this, i);
+
+        if (!cpus.empty()) {
+            cpu_set_t conjunto;
+            CPU_ZERO(&conjunto);
+            CPU_SET(cpus[i % cpus.size()], &conjunto);
+
+            int erro = pthread_setaffinity_np(threads.back().native_handle(), sizeof(conjunto), &conjunto);
+            if (erro != 0) {
+                encerra();
+                throw std::runtime_error("ThreadPool: Erro ao definir a afinidade! Código de erro: " + std::to_string(erro));
+            }
+        }
+    }
+}
+
+/*
+ * Índice da thread do pool que está executando, -1 fora do pool
+ */
+int ThreadPool::getIndiceAtual()
+{
+    return indiceAtual;
+}
+
+/*
+ * Recria o pool global, deve ser chamado na inicialização antes de qualquer uso
+ */
+void ThreadPool::configuraGlobal(unsigned numThreads, const std::vector<int>& cpus)
+{
+    std::lock_guard<std::mutex> lock(mutexGlobal);
+    poolGlobal.reset();
+    poolGlobal = std::make_unique<ThreadPool>(numThreads, cpus);
+}
+
+/*
+ * Pool compartilhado pelo processo, criado com uma thread por núcleo caso não tenha sido configurado
+ */
+ThreadPool& ThreadPool::global()
+{
+    std::lock_guard<std::mutex> lock(mutexGlobal);
+    if (!poolGlobal) {
+        poolGlobal = std::make_unique<ThreadPool>();
+    }
+    return *poolGlobal;
+}
+
+ThreadPool::~ThreadPool()
+{
+    encerra();
+}
+
+/*
+ * Acorda as threads para saírem e espera todas terminarem
+ */
+void ThreadPool::encerra()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexEspera);
+        run = false;
+    }
+    cvEspera.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+/*
+ * Submete uma tarefa, de dentro do pool vai para a fila da própria thread, de fora é distribuída em rodízio
+ */
+void ThreadPool::submete(Tarefa tarefa)
+{
+    unsigned indice = indiceAtual >= 0 ? indiceAtual : proximaFila++ % filas.size();
+
+    {
+        std::lock_guard<std::mutex> lock(filas[indice]->mutex);
+        filas[indice]->tarefas.push_back(std::move(tarefa));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutexEspera);
+        pendentes++;
+    }
+    cvEspera.notify_one();
+}
+
+/*
+ * Divide o intervalo [0, n) em blocos executados no pool e retorna quando todos terminarem.
+ * Enquanto espera a thread chamadora também executa tarefas, então pode ser usado de dentro do próprio pool.
+ */
+void ThreadPool::paraleloPara(size_t n, size_t bloco, const std::function<void(size_t inicio, size_t fim)>& corpo)
+{
+    if (n == 0) {
+        return;
+    }
+
+    bloco = std::max<size_t>(bloco, 1);
+    size_t numBlocos = (n + bloco - 1) / bloco;
+
+    std::mutex mutexGrupo;
+    std::condition_variable cvGrupo;
+    size_t restantes = numBlocos;
+
+    // O último bloco a terminar avisa, a contagem é protegida para o grupo não ser destruído durante o aviso
+    auto termina = [&] {
+        std::lock_guard<std::mutex> lock(mutexGrupo);
+        if (--restantes == 0) {
+            cvGrupo.notify_all();
+        }
+    };
+
+    for (size_t b = 1; b < numBlocos; b++) {
+        submete([&, b] {
+            corpo(b*bloco, std::min(n, (b + 1)*bloco));
+            termina();
+        });
+    }
+
+    corpo(0, std::min(n, bloco));
+    termina();
+
+    unsigned indice = indiceAtual >= 0 ? indiceAtual : 0;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutexGrupo);
+            if (restantes == 0) {
+                return;
+            }
+        }
+
+        Tarefa tarefa;
+        if (obtem(indice, tarefa)) {
+            pendentes--;
+            tarefa();
+            continue;
+        }
+
+        // As tarefas restantes já estão rodando em outras threads
+        std::unique_lock<std::mutex> lock(mutexGrupo);
+        cvGrupo.wait(lock, [&] { return restantes == 0; });
+        return;
+    }
+}
+
+/*
+ * Obtém a próxima tarefa, primeiro da própria fila (LIFO), depois roubando das outras (FIFO)
+ */
+bool ThreadPool::obtem(unsigned indice, Tarefa& tarefa)
+{
+    {
+        std::lock_guard<std::mutex> lock(filas[indice]->mutex);
+        if (!filas[indice]->tarefas.empty()) {
+            tarefa = std::move(filas[indice]->tarefas.back());
+            filas[indice]->tarefas.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t k = 1; k < filas.size(); k++) {
+        Fila& vitima = *filas[(indice + k) % filas.size()];
+
+        std::lock_guard<std::mutex> lock(vitima.mutex);
+        if (!vitima.tarefas.empty()) {
+            tarefa = std::move(vitima.tarefas.front());
+            vitima.tarefas.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Laço de cada thread do pool
+ */
+void ThreadPool::executa(unsigned indice)
+{
+    indiceAtual = indice;
+
+    while (true) {
+        Tarefa tarefa;
+
+        if (obtem(indice, tarefa)) {
+            pendentes--;
+            tarefa();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutexEspera);
+        cvEspera.wait(lock, [this] { return pendentes > 0 || !run; });
+
+        if (!run && pendentes <= 0) {
+            break;
+        }
+    }
+}
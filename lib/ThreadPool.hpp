@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+
+/*
+ * Pool de threads com roubo de tarefas: cada thread tem a sua fila, executa as próprias tarefas
+ * da mais nova para a mais antiga e, quando fica sem, rouba a mais antiga das filas das outras
+ */
+class ThreadPool
+{
+    public:
+        using Tarefa = std::function<void()>;
+
+    private:
+        typedef struct
+        {
+            std::mutex mutex;
+            std::deque<Tarefa> tarefas;
+        } Fila;
+
+        std::vector<std::unique_ptr<Fila>> filas;
+        std::vector<std::thread> threads;
+
+        std::atomic<bool> run{true};
+        std::atomic<unsigned> proximaFila{0};
+        std::atomic<int64_t> pendentes{0};
+
+        std::mutex mutexEspera;
+        std::condition_variable cvEspera;
+
+        void executa(unsigned indice);
+        void encerra();
+        bool obtem(unsigned indice, Tarefa& tarefa);
+    public:
+        explicit ThreadPool(unsigned numThreads = std::thread::hardware_concurrency(), const std::vector<int>& cpus = {});
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void submete(Tarefa tarefa);
+        void paraleloPara(size_t n, size_t bloco, const std::function<void(size_t inicio, size_t fim)>& corpo);
+        unsigned getNumThreads() const { return threads.size(); }
+
+        static int getIndiceAtual();
+
+        static void configuraGlobal(unsigned numThreads, const std::vector<int>& cpus = {});
+        static ThreadPool& global();
+};
+
+#endif
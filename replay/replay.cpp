@@ -0,0 +1,315 @@
+/*
+ *  Replay: reproduz uma sequência de quadros pelo mesmo caminho do programa, sem a câmera e sem a rede, e mede o tempo
+ *  de cada quadro. Na Base: decodificação do JPEG, busca adaptativa com o modelo adaptativo, MNIST e o controle.
+ *  Na Pi: a compressão do quadro transmitido e a detecção em ponto fixo.
+ *  É a carga do treino do PGO (alvo pgo-treino do CMake) e a medida para comparar as configurações de compilação.
+ *  Os quadros vêm de uma gravação (vídeo ou sequência de imagens, ex: a do Base --grava) ou são sintéticos.
+ */
+
+/* -------- Includes -------- */
+#include "Raspberry.hpp"
+#include "ImageProcessing.hpp"
+#include "MNIST.hpp"
+#include "ControleAutomatico.hpp"
+#include "PontoFixo.hpp"
+#include "DetectorMovimento.hpp"
+#include "JpegParalelo.hpp"
+#include "Escalonador.hpp"
+#include "Configuracao.hpp"
+
+/* -------- Defines -------- */
+#define REPLAY_QUADROS          300     // Quadros sintéticos, dez segundos a 30 fps
+#define REPLAY_PERIODO_ALVO     150     // Quadros sintéticos: em cada período o alvo some durante o último quinto
+#define REPLAY_FPS              30.0    // Relógio virtual do controle
+#define REPLAY_SEMENTE          1234
+#define REPLAY_JPEG_QUALIDADE   80      // Mesma do Device::sendImageCompactada, com os reinícios a cada linha de MCUs
+
+/* -------- Quadros -------- */
+/*
+ * Quadros sintéticos: o modelo sobre um fundo fixo, indo e voltando na horizontal enquanto se aproxima, assim a busca
+ * passa por todas as escalas, pelos quadros sem o alvo e pela volta do modelo adaptativo ao original
+ */
+std::vector<Mat_<Raspberry::Cor>> getQuadrosSinteticos(const Mat_<Raspberry::Cor>& modelo, int numQuadros, Size tamanho)
+{
+    Mat_<Raspberry::Cor> fundo(tamanho);
+    setRNGSeed(REPLAY_SEMENTE);
+    randu(fundo, Scalar::all(0), Scalar::all(255));
+    GaussianBlur(fundo, fundo, Size(5, 5), 0);
+
+    std::vector<Mat_<Raspberry::Cor>> quadros;
+    const Rect tela(Point(0, 0), tamanho);
+    const double fator = Raspberry::getFatorEscala(tamanho.width);
+
+    for (auto i = 0; i < numQuadros; i++) {
+        Mat_<Raspberry::Cor> quadro = fundo.clone();
+        int fase = i % REPLAY_PERIODO_ALVO;
+
+        if (fase < REPLAY_PERIODO_ALVO*4/5) {
+            double t = double(fase) / REPLAY_PERIODO_ALVO;
+            double escala = fator*0.06*std::pow(ESCALA_MAX/0.06, t);
+
+            Mat_<Raspberry::Cor> alvo;
+            resize(modelo, alvo, Size(), escala, escala, INTER_AREA);
+
+            Point centro(tamanho.width/2 + 0.3*tamanho.width*std::sin(4.0*CV_PI*t), tamanho.height/2);
+            Rect janela(centro - Point(alvo.cols/2, alvo.rows/2), alvo.size());
+            Rect visivel = janela & tela;
+
+            alvo(Rect(visivel.tl() - janela.tl(), visivel.size())).copyTo(quadro(visivel));
+        }
+
+        quadros.push_back(quadro);
+    }
+
+    return quadros;
+}
+
+/*
+ * Lê todos os quadros da gravação, no tamanho pedido
+ */
+std::vector<Mat_<Raspberry::Cor>> getQuadrosGravados(const std::string& caminho, Size tamanho)
+{
+    VideoCapture gravacao(caminho);
+    if (!gravacao.isOpened()) {
+        Raspberry::erro("Replay: Erro ao abrir a gravação " + caminho);
+    }
+
+    std::vector<Mat_<Raspberry::Cor>> quadros;
+    Mat quadro;
+
+    while (gravacao.read(quadro)) {
+        Mat_<Raspberry::Cor> redimensionado;
+        resize(quadro, redimensionado, tamanho, 0, 0, INTER_AREA);
+        quadros.push_back(redimensionado);
+    }
+
+    if (quadros.empty()) {
+        Raspberry::erro("Replay: A gravação " + caminho + " não tem quadros");
+    }
+
+    return quadros;
+}
+
+/* -------- Caminho de cada programa -------- */
+#ifdef BASE
+/*
+ * Caminho de um quadro na Base, o mesmo do laço do main.cpp. Os quadros chegam como o JPEG recebido da Pi
+ */
+std::vector<double> executa(const std::vector<Mat_<Raspberry::Cor>>& quadros, const Mat_<Raspberry::Cor>& modeloCor, const std::string& arquivoRede, int voltas, uint64_t& quadrosAlvo, DetectorMovimento* movimento)
+{
+    std::vector<std::vector<Raspberry::Byte>> recebidos(quadros.size());
+    const std::vector<int> compressaoParam{IMWRITE_JPEG_QUALITY, REPLAY_JPEG_QUALIDADE, IMWRITE_JPEG_RST_INTERVAL, JpegParalelo::getIntervaloReinicio(quadros[0].cols)};
+    for (size_t i = 0; i < quadros.size(); i++) {
+        imencode(".jpeg", quadros[i], recebidos[i], compressaoParam);
+    }
+
+    torch::jit::script::Module module = torch::jit::load(arquivoRede, torch::Device(torch::kCPU));
+    module = torch::jit::optimize_for_inference(module);
+
+    // As escalas acompanham a resolução dos quadros, como na negociação com a Base
+    const float fator = Raspberry::getFatorEscala(quadros[0].cols);
+    float escalas[NUM_ESCALAS];
+    Raspberry::getEscalasGeometricas(escalas, NUM_ESCALAS, ESCALA_MIN*fator, ESCALA_MAX*fator);
+
+    Mat_<Raspberry::Flt> modelo;
+    ImageProcessing::Cor2Flt(modeloCor, modelo);
+    Mat_<Raspberry::Flt> modelosPreProcessados[NUM_ESCALAS];
+    ImageProcessing::TemplateMatching::getModeloPreProcessados(modelo, modelosPreProcessados, NUM_ESCALAS, escalas);
+    Raspberry::FindPos corrBuf[NUM_ESCALAS];
+
+    ImageProcessing::TemplateMatching::BuscaAdaptativa busca(modelo, NUM_ESCALAS, escalas, BUSCA_CONFIANCA, BUSCA_MARGEM);
+    ImageProcessing::TemplateMatching::ModeloAdaptativo modeloAdaptativo(modelo, NUM_ESCALAS, escalas, ADAPTA_TAXA, ADAPTA_PERDA_MAX, &busca);
+
+    // O controle anda no tempo dos quadros, não no tempo gasto para processá-los
+    double tempoVirtual = 0.0;
+    ControleAutomatico::Controlador controlador(ESCALA_DIST_MIN*fator, [&] { return tempoVirtual; }, false);
+    int velocidadesPWM[4] = {0, 0, 0, 0};
+    int numPredito = 0;
+    Raspberry::FindPos maxCorr{};
+    bool encontrado = false;
+
+    // Decodificação em fatias paralelas, como a Base faz com os quadros recebidos
+    JpegParalelo jpeg;
+    Mat_<Raspberry::Cor> frameBuf;
+    Mat_<Raspberry::Flt> frameBufFlt;
+    std::vector<double> tempos;
+
+    for (auto volta = 0; volta < voltas; volta++) {
+        for (const auto& recebido : recebidos) {
+            double inicio = Raspberry::timeSinceEpoch();
+
+            jpeg.decodifica(recebido, frameBuf);
+
+            // Com a cena parada a busca, a adaptação e a inferência do quadro anterior são reaproveitadas
+            if (movimento == nullptr || movimento->mudou(frameBuf)) {
+                ImageProcessing::Cor2Flt(frameBuf, frameBufFlt);
+
+                maxCorr = busca.busca(frameBufFlt, modelosPreProcessados, corrBuf);
+                encontrado = maxCorr.ponto.correlacao > THRESHOLD;
+                modeloAdaptativo.atualiza(frameBufFlt, encontrado ? &maxCorr : nullptr, modelosPreProcessados);
+
+                if (encontrado) {
+                    Mat_<Raspberry::Flt> numEncontrado = MNIST::getMNIST(frameBufFlt, maxCorr.ponto.posicao, maxCorr.escala*NUM_SIZE);
+                    numPredito = MNIST::inferencia(numEncontrado, module);
+                }
+            }
+
+            if (encontrado) {
+                quadrosAlvo++;
+            }
+
+            controlador.atualizaContinuo(encontrado ? &maxCorr : nullptr, frameBuf.cols, encontrado && maxCorr.escala > ESCALA_DIST_MIN*fator, numPredito, velocidadesPWM);
+
+            tempos.push_back(Raspberry::timeSinceEpoch() - inicio);
+            tempoVirtual += 1.0/REPLAY_FPS;
+        }
+    }
+
+    return tempos;
+}
+#endif // BASE
+
+#ifdef RASP
+/*
+ * Caminho de um quadro na Pi: a compressão do quadro transmitido e a detecção em ponto fixo do modo --deteccao
+ */
+std::vector<double> executa(const std::vector<Mat_<Raspberry::Cor>>& quadros, const Mat_<Raspberry::Cor>& modeloCor, const std::string&, int voltas, uint64_t& quadrosAlvo, DetectorMovimento* movimento)
+{
+    // As escalas acompanham a resolução dos quadros, como na negociação com a Base
+    const float fator = Raspberry::getFatorEscala(quadros[0].cols);
+    float escalas[NUM_ESCALAS];
+    Raspberry::getEscalasGeometricas(escalas, NUM_ESCALAS, ESCALA_MIN*fator, ESCALA_MAX*fator);
+
+    Mat_<PontoFixo::Pixel> modelo;
+    PontoFixo::getCinza(modeloCor, modelo);
+    PontoFixo::Modelo modelos[NUM_ESCALAS];
+    PontoFixo::getModelos(modelo, modelos, NUM_ESCALAS, escalas);
+    Raspberry::FindPos corrBuf[NUM_ESCALAS];
+
+    const std::vector<int> compressaoParam{IMWRITE_JPEG_QUALITY, REPLAY_JPEG_QUALIDADE, IMWRITE_JPEG_RST_INTERVAL, JpegParalelo::getIntervaloReinicio(quadros[0].cols)};
+    std::vector<Raspberry::Byte> imgBuf;
+    Mat_<PontoFixo::Pixel> frameBufCinza;
+    bool encontrado = false;
+    std::vector<double> tempos;
+
+    for (auto volta = 0; volta < voltas; volta++) {
+        for (const auto& frameBuf : quadros) {
+            double inicio = Raspberry::timeSinceEpoch();
+
+            imencode(".jpeg", frameBuf, imgBuf, compressaoParam);
+
+            // Com a cena parada a Pi reenvia a detecção anterior
+            if (movimento == nullptr || movimento->mudou(frameBuf)) {
+                PontoFixo::getCinza(frameBuf, frameBufCinza);
+                Raspberry::FindPos maxCorr = PontoFixo::getMaxCorrelacao(frameBufCinza, modelos, corrBuf, NUM_ESCALAS, escalas);
+
+                encontrado = maxCorr.ponto.correlacao > THRESHOLD;
+                if (encontrado) {
+                    PontoFixo::getRecorte(frameBufCinza, maxCorr.ponto.posicao, maxCorr.escala*NUM_SIZE);
+                }
+            }
+
+            if (encontrado) {
+                quadrosAlvo++;
+            }
+
+            tempos.push_back(Raspberry::timeSinceEpoch() - inicio);
+        }
+    }
+
+    return tempos;
+}
+#endif // RASP
+
+/* -------- Main -------- */
+void uso()
+{
+    Raspberry::erro("Uso: Replay [--modelo arquivo] [--rede arquivo] [--quadros gravacao] [--sintetico N] [--voltas N] [--threads N] [--movimento] [--resolucao LxA]");
+}
+
+int main(int argc, char *argv[])
+{
+    // Opções
+    std::string arquivoModelo = REPLAY_DIR "/Base/quadrado.png";
+    std::string arquivoRede = REPLAY_DIR "/Base/lenet5_model.pt";
+    std::string gravacao;
+    int numSinteticos = REPLAY_QUADROS;
+    int voltas = 1;
+    unsigned numThreads = 0;
+    bool movimento = false;
+    Raspberry::Formato formato{CAMERA_FRAME_WIDTH, CAMERA_FRAME_HEIGHT, 0};
+
+    for (auto i = 1; i < argc; i++) {
+        std::string opcao = argv[i];
+
+        if (opcao == "--modelo" && i + 1 < argc) {
+            arquivoModelo = argv[++i];
+        }
+        else if (opcao == "--rede" && i + 1 < argc) {
+            arquivoRede = argv[++i];
+        }
+        else if (opcao == "--quadros" && i + 1 < argc) {
+            gravacao = argv[++i];
+        }
+        else if (opcao == "--sintetico" && i + 1 < argc) {
+            numSinteticos = std::max(1, atoi(argv[++i]));
+        }
+        else if (opcao == "--voltas" && i + 1 < argc) {
+            voltas = std::max(1, atoi(argv[++i]));
+        }
+        else if (opcao == "--threads" && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (opcao == "--movimento") {
+            movimento = true;
+        }
+        else if (opcao == "--resolucao" && i + 1 < argc) {
+            if (!Raspberry::leResolucao(argv[++i], formato)) {
+                uso();
+            }
+        }
+        else {
+            uso();
+        }
+    }
+
+    Mat_<Raspberry::Cor> modeloCor = imread(arquivoModelo, 1);
+    if (modeloCor.empty()) {
+        Raspberry::erro("Replay: Erro ao abrir o modelo " + arquivoModelo);
+    }
+
+    const Size tamanho(formato.largura, formato.altura);
+    std::vector<Mat_<Raspberry::Cor>> quadros = gravacao.empty() ? getQuadrosSinteticos(modeloCor, numSinteticos, tamanho) : getQuadrosGravados(gravacao, tamanho);
+
+    std::vector<double> tempos;
+    uint64_t quadrosAlvo = 0;
+    DetectorMovimento detectorMovimento(MOVIMENTO_LIMIAR, MOVIMENTO_REUTILIZADOS_MAX);
+
+    try {
+        Escalonador::configura(numThreads);
+        tempos = executa(quadros, modeloCor, arquivoRede, voltas, quadrosAlvo, movimento ? &detectorMovimento : nullptr);
+    }
+    catch (const std::exception& e) {
+        Raspberry::erro(e.what());
+    }
+
+    double total = 0.0;
+    for (double tempo : tempos) {
+        total += tempo;
+    }
+
+    std::sort(tempos.begin(), tempos.end());
+    auto percentil = [&](double p) { return tempos[std::min(tempos.size() - 1, size_t(p*tempos.size()))]; };
+
+    std::ostringstream os;
+    os << "Quadros de " << formato.largura << "x" << formato.altura << ": " << tempos.size() << " (" << quadros.size() << " x " << voltas << "), com o alvo: " << 100.0*quadrosAlvo/tempos.size() << " %" << std::endl
+       << "Tempo por quadro [ms]: media " << 1e3*total/tempos.size() << ", p50 " << 1e3*percentil(0.5) << ", p95 " << 1e3*percentil(0.95)
+       << ", max " << 1e3*tempos.back() << std::endl
+       << "Vazao: " << tempos.size()/total << " quadros/s";
+    if (movimento) {
+        os << std::endl << detectorMovimento.getEstatisticas();
+    }
+    Raspberry::print(os.str());
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ *  Teste de estresse da Mailbox: um produtor publica sem parar enquanto o consumidor lê, como as threads de rede e
+ *  dos motores no AgendadorMotor. Falha se algum valor chegar fora de ordem, misturado entre duas publicações, ou se
+ *  lidos + sobrescritos não fecharem com os publicados
+ */
+
+/* -------- Includes -------- */
+#include "Mailbox.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+/* -------- Defines -------- */
+#define TESTE_PUBLICACOES   2000000
+#define TESTE_PALAVRAS      8       // Valor maior que uma palavra, uma leitura rasgada aparece como palavras diferentes
+#define TESTE_CEDE          256     // Publicações entre duas cessões da CPU, para o consumidor intercalar mesmo com um núcleo
+
+/* -------- Tipos -------- */
+typedef struct
+{
+    uint64_t palavras[TESTE_PALAVRAS];
+} Valor;
+
+/* -------- Main -------- */
+int main(int argc, char *argv[])
+{
+    const uint64_t publicacoes = argc > 1 ? strtoull(argv[1], nullptr, 10) : TESTE_PUBLICACOES;
+
+    Mailbox<Valor> caixa;
+    std::atomic<bool> terminou{false};
+
+    // O produtor escreve a própria sequência em todas as palavras do valor
+    std::thread produtor([&] {
+        for (uint64_t i = 1; i <= publicacoes; i++) {
+            Valor valor;
+            for (auto& palavra : valor.palavras) {
+                palavra = i;
+            }
+
+            if (caixa.publica(valor) != i) {
+                fprintf(stderr, "Sequência %llu devolvida fora de ordem pelo publica\n", (unsigned long long) i);
+                std::exit(1);
+            }
+
+            if (i % TESTE_CEDE == 0) {
+                std::this_thread::yield();
+            }
+        }
+        terminou = true;
+    });
+
+    uint64_t lidos = 0, anterior = 0, erros = 0;
+    Valor valor;
+    uint64_t sequencia;
+
+    // Depois do fim do produtor ainda pode haver o último valor na caixa
+    while (true) {
+        bool fim = terminou.load();
+
+        while (caixa.consome(valor, &sequencia)) {
+            lidos++;
+
+            if (sequencia <= anterior) {
+                fprintf(stderr, "Sequência %llu depois de %llu\n", (unsigned long long) sequencia, (unsigned long long) anterior);
+                erros++;
+            }
+            anterior = sequencia;
+
+            for (auto palavra : valor.palavras) {
+                if (palavra != sequencia) {
+                    fprintf(stderr, "Valor rasgado na sequência %llu\n", (unsigned long long) sequencia);
+                    erros++;
+                    break;
+                }
+            }
+        }
+
+        if (fim) {
+            break;
+        }
+    }
+
+    produtor.join();
+
+    if (anterior != publicacoes) {
+        fprintf(stderr, "Último valor lido %llu, o último publicado foi %llu\n", (unsigned long long) anterior, (unsigned long long) publicacoes);
+        erros++;
+    }
+
+    if (lidos + caixa.getSobrescritos() != publicacoes) {
+        fprintf(stderr, "Lidos %llu + sobrescritos %llu != publicados %llu\n", (unsigned long long) lidos,
+                (unsigned long long) caixa.getSobrescritos(), (unsigned long long) publicacoes);
+        erros++;
+    }
+
+    printf("Mailbox: %llu publicados, %llu lidos, %llu sobrescritos, %llu erros\n", (unsigned long long) publicacoes,
+           (unsigned long long) lidos, (unsigned long long) caixa.getSobrescritos(), (unsigned long long) erros);
+    return erros == 0 ? 0 : 1;
+}